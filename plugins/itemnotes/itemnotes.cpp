@@ -26,13 +26,13 @@
 #include "gui/iconfont.h"
 #include "gui/iconwidget.h"
 #include "gui/pixelratio.h"
+#include "item/textmatchhighlighter.h"
 
 #include <QBoxLayout>
 #include <QLabel>
 #include <QModelIndex>
 #include <QMouseEvent>
 #include <QPainter>
-#include <QTextCursor>
 #include <QTextDocument>
 #include <QTextEdit>
 #include <QTimer>
@@ -77,6 +77,7 @@ ItemNotes::ItemNotes(ItemWidget *childItem, const QString &text, const QByteArra
     : QWidget( childItem->widget()->parentWidget() )
     , ItemWidgetWrapper(childItem, this)
     , m_notes(new QTextEdit(this))
+    , m_notesHighlighter(new TextMatchHighlighter(m_notes))
     , m_icon(nullptr)
     , m_timerShowToolTip(nullptr)
     , m_toolTipText()
@@ -162,40 +163,7 @@ void ItemNotes::setCurrent(bool current)
 void ItemNotes::highlight(const QRegularExpression &re, const QFont &highlightFont, const QPalette &highlightPalette)
 {
     ItemWidgetWrapper::highlight(re, highlightFont, highlightPalette);
-
-    if (m_notes != nullptr) {
-        QList<QTextEdit::ExtraSelection> selections;
-
-        if ( re.isValid() && !re.pattern().isEmpty() ) {
-            QTextEdit::ExtraSelection selection;
-            selection.format.setBackground( highlightPalette.base() );
-            selection.format.setForeground( highlightPalette.text() );
-            selection.format.setFont(highlightFont);
-
-            QTextCursor cur = m_notes->document()->find(re);
-            int a = cur.position();
-            while ( !cur.isNull() ) {
-                if ( cur.hasSelection() ) {
-                    selection.cursor = cur;
-                    selections.append(selection);
-                } else {
-                    cur.movePosition(QTextCursor::NextCharacter);
-                }
-                cur = m_notes->document()->find(re, cur);
-                int b = cur.position();
-                if (a == b) {
-                    cur.movePosition(QTextCursor::NextCharacter);
-                    cur = m_notes->document()->find(re, cur);
-                    b = cur.position();
-                    if (a == b) break;
-                }
-                a = b;
-            }
-        }
-
-        m_notes->setExtraSelections(selections);
-    }
-
+    m_notesHighlighter->setHighlight(re, highlightFont, highlightPalette);
     update();
 }
 
@@ -313,8 +281,12 @@ ItemWidget *ItemNotesLoader::transform(ItemWidget *itemWidget, const QVariantMap
         m_settings["show_tooltip"].toBool() );
 }
 
-bool ItemNotesLoader::matches(const QModelIndex &index, const QRegularExpression &re) const
+QString ItemNotesLoader::searchText(const QVariantMap &data) const
+{
+    return getTextData(data, mimeItemNotes);
+}
+
+QStringList ItemNotesLoader::searchTextFormats() const
 {
-    const QString text = index.data(contentType::notes).toString();
-    return text.contains(re);
+    return QStringList() << mimeItemNotes;
 }
@@ -31,6 +31,7 @@ class ItemNotesSettings;
 
 class QTextEdit;
 class QTimer;
+class TextMatchHighlighter;
 
 enum NotesPosition {
     NotesAbove,
@@ -62,6 +63,7 @@ private:
     void showToolTip();
 
     QTextEdit *m_notes;
+    TextMatchHighlighter *m_notesHighlighter;
     QWidget *m_icon;
     QTimer *m_timerShowToolTip;
     QString m_toolTipText;
@@ -94,7 +96,9 @@ public:
 
     ItemWidget *transform(ItemWidget *itemWidget, const QVariantMap &data) override;
 
-    bool matches(const QModelIndex &index, const QRegularExpression &re) const override;
+    QString searchText(const QVariantMap &data) const override;
+
+    QStringList searchTextFormats() const override;
 
 private:
     QVariantMap m_settings;
@@ -176,6 +176,8 @@ ItemPinnedSaver::ItemPinnedSaver(QAbstractItemModel *model, QVariantMap &setting
              this, &ItemPinnedSaver::onRowsMoved );
     connect( model, &QAbstractItemModel::dataChanged,
              this, &ItemPinnedSaver::onDataChanged );
+    connect( model, &QAbstractItemModel::layoutChanged,
+             this, &ItemPinnedSaver::onLayoutChanged );
 
     updateLastPinned( 0, m_model->rowCount() );
 }
@@ -185,6 +187,16 @@ bool ItemPinnedSaver::saveItems(const QString &tabName, const QAbstractItemModel
     return m_saver->saveItems(tabName, model, file);
 }
 
+bool ItemPinnedSaver::canJournalItems()
+{
+    return m_saver->canJournalItems();
+}
+
+bool ItemPinnedSaver::canSaveItemsInBackground()
+{
+    return m_saver->canSaveItemsInBackground();
+}
+
 bool ItemPinnedSaver::canRemoveItems(const QList<QModelIndex> &indexList, QString *error)
 {
     if ( !containsPinnedItems(indexList) )
@@ -308,6 +320,15 @@ void ItemPinnedSaver::onRowsMoved(const QModelIndex &, int start, int end, const
              this, &ItemPinnedSaver::onRowsMoved );
 }
 
+void ItemPinnedSaver::onLayoutChanged()
+{
+    if (!m_model)
+        return;
+
+    m_lastPinned = -1;
+    updateLastPinned( 0, m_model->rowCount() - 1 );
+}
+
 void ItemPinnedSaver::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
 {
     if ( bottomRight.row() < m_lastPinned )
@@ -60,6 +60,10 @@ public:
 
     bool saveItems(const QString &tabName, const QAbstractItemModel &model, QIODevice *file) override;
 
+    bool canJournalItems() override;
+
+    bool canSaveItemsInBackground() override;
+
     bool canRemoveItems(const QList<QModelIndex> &indexList, QString *error) override;
 
     bool canDropItem(const QModelIndex &index) override;
@@ -77,6 +81,7 @@ private:
     void onRowsRemoved(const QModelIndex &parent, int start, int end);
     void onRowsMoved(const QModelIndex &, int start, int end, const QModelIndex &, int destinationRow);
     void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void onLayoutChanged();
 
     void moveRow(int from, int to);
     void updateLastPinned(int from, int to);
@@ -150,6 +150,25 @@ void ItemPinnedTests::pinToRow()
     RUN(read << "0" << "1" << "2", "a b d");
 }
 
+void ItemPinnedTests::sortAndReverse()
+{
+    const auto read = Args() << "separator" << " " << "read" << "0" << "1" << "2" << "3" << "4";
+
+    RUN("add" << "a" << "c" << "b" << "d" << "e", "");
+    RUN("-e" << "plugins.itempinned.pin(1, 3)", "");
+    RUN(read, "e d b c a");
+
+    // Pinned items stay in the same rows.
+    RUN("keys" << "CTRL+A" << "CTRL+SHIFT+S", "");
+    RUN(read, "a d b c e");
+
+    RUN("keys" << "CTRL+A" << "CTRL+SHIFT+R", "");
+    RUN(read, "e d b c a");
+
+    RUN("-e" << "plugins.itempinned.isPinned(1)", "true\n");
+    RUN("-e" << "plugins.itempinned.isPinned(3)", "true\n");
+}
+
 void ItemPinnedTests::fullTab()
 {
     RUN("config" << "maxitems" << "3", "3\n");
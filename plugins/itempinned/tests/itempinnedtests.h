@@ -46,6 +46,8 @@ private slots:
 
     void pinToRow();
 
+    void sortAndReverse();
+
     void fullTab();
 
 private:
@@ -745,11 +745,14 @@ ItemWidget *ItemSyncLoader::transform(ItemWidget *itemWidget, const QVariantMap
     return new ItemSync(baseName, icon, itemWidget);
 }
 
-bool ItemSyncLoader::matches(const QModelIndex &index, const QRegularExpression &re) const
+QString ItemSyncLoader::searchText(const QVariantMap &data) const
 {
-    const QVariantMap dataMap = index.data(contentType::data).toMap();
-    const QString text = dataMap.value(mimeBaseName).toString();
-    return text.contains(re);
+    return data.value(mimeBaseName).toString();
+}
+
+QStringList ItemSyncLoader::searchTextFormats() const
+{
+    return QStringList() << mimeBaseName;
 }
 
 QObject *ItemSyncLoader::tests(const TestInterfacePtr &test) const
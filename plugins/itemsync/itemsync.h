@@ -163,7 +163,9 @@ public:
 
     ItemWidget *transform(ItemWidget *itemWidget, const QVariantMap &data) override;
 
-    bool matches(const QModelIndex &index, const QRegularExpression &re) const override;
+    QString searchText(const QVariantMap &data) const override;
+
+    QStringList searchTextFormats() const override;
 
     QObject *tests(const TestInterfacePtr &test) const override;
 
@@ -652,12 +652,14 @@ ItemWidget *ItemTagsLoader::transform(ItemWidget *itemWidget, const QVariantMap
     return new ItemTags(itemWidget, tags);
 }
 
-bool ItemTagsLoader::matches(const QModelIndex &index, const QRegularExpression &re) const
+QString ItemTagsLoader::searchText(const QVariantMap &data) const
 {
-    const QByteArray tagsData =
-            index.data(contentType::data).toMap().value(mimeTags).toByteArray();
-    const auto tags = getTextData(tagsData);
-    return tags.contains(re);
+    return getTextData(data, mimeTags);
+}
+
+QStringList ItemTagsLoader::searchTextFormats() const
+{
+    return QStringList() << mimeTags;
 }
 
 QObject *ItemTagsLoader::tests(const TestInterfacePtr &test) const
@@ -23,6 +23,7 @@
 #include "common/mimetypes.h"
 #include "common/sanitize_text_document.h"
 #include "common/textdata.h"
+#include "item/textmatchhighlighter.h"
 
 #include <QAbstractTextDocumentLayout>
 #include <QCoreApplication>
@@ -113,6 +114,7 @@ ItemText::ItemText(const QString &text, const QString &richText, int maxLines, i
     : QTextEdit(parent)
     , ItemWidget(this)
     , m_textDocument()
+    , m_highlighter(new TextMatchHighlighter(this))
     , m_maximumHeight(maximumHeight)
 {
     m_textDocument.setDefaultFont(font());
@@ -173,37 +175,7 @@ ItemText::ItemText(const QString &text, const QString &richText, int maxLines, i
 
 void ItemText::highlight(const QRegularExpression &re, const QFont &highlightFont, const QPalette &highlightPalette)
 {
-    QList<QTextEdit::ExtraSelection> selections;
-
-    if ( re.isValid() && !re.pattern().isEmpty() ) {
-        QTextEdit::ExtraSelection selection;
-        selection.format.setBackground( highlightPalette.base() );
-        selection.format.setForeground( highlightPalette.text() );
-        selection.format.setFont(highlightFont);
-
-        QTextCursor cur = m_textDocument.find(re);
-        int a = cur.position();
-        while ( !cur.isNull() ) {
-            if ( cur.hasSelection() ) {
-                selection.cursor = cur;
-                selections.append(selection);
-            } else {
-                cur.movePosition(QTextCursor::NextCharacter);
-            }
-            cur = m_textDocument.find(re, cur);
-            int b = cur.position();
-            if (a == b) {
-                cur.movePosition(QTextCursor::NextCharacter);
-                cur = m_textDocument.find(re, cur);
-                b = cur.position();
-                if (a == b) break;
-            }
-            a = b;
-        }
-    }
-
-    setExtraSelections(selections);
-
+    m_highlighter->setHighlight(re, highlightFont, highlightPalette);
     update();
 }
 
@@ -33,6 +33,8 @@ namespace Ui {
 class ItemTextSettings;
 }
 
+class TextMatchHighlighter;
+
 class ItemText final : public QTextEdit, public ItemWidget
 {
     Q_OBJECT
@@ -55,6 +57,7 @@ private:
 
     QTextDocument m_textDocument;
     QTextDocumentFragment m_elidedFragment;
+    TextMatchHighlighter *m_highlighter;
     int m_ellipsisPosition = -1;
     int m_maximumHeight;
     bool m_isRichText = false;
@@ -27,6 +27,7 @@
 #include "common/log.h"
 #include "common/textdata.h"
 #include "platform/platformnativeinterface.h"
+#include "scriptable/nativecommand.h"
 #include "scriptable/scriptable.h"
 #include "scriptable/scriptableproxy.h"
 
@@ -133,9 +134,7 @@ void ClipboardClient::onConnectionFailed()
 
 void ClipboardClient::start(const QStringList &arguments)
 {
-    QScriptEngine engine;
     ScriptableProxy scriptableProxy(nullptr, nullptr);
-    Scriptable scriptable(&engine, &scriptableProxy);
 
     const auto serverName = clipboardServerName();
     ClientSocket socket(serverName);
@@ -155,21 +154,9 @@ void ClipboardClient::start(const QStringList &arguments)
     connect( this, &ClipboardClient::inputDialogFinished,
              &scriptableProxy, &ScriptableProxy::setInputDialogResult );
 
-    connect( &socket, &ClientSocket::disconnected,
-             &scriptable, &Scriptable::abort );
     connect( &socket, &ClientSocket::disconnected,
              &scriptableProxy, &ScriptableProxy::clientDisconnected );
 
-    connect( &scriptable, &Scriptable::finished,
-             &scriptableProxy, &ScriptableProxy::clientDisconnected );
-
-    connect( this, &ClipboardClient::dataReceived,
-             &scriptable, &Scriptable::dataReceived, Qt::QueuedConnection );
-    connect( &scriptable, &Scriptable::receiveData,
-             &socket, [&]() {
-                socket.sendMessage(QByteArray(), CommandReceiveData);
-             });
-
     bool hasActionId;
 #if QT_VERSION < QT_VERSION_CHECK(5,5,0)
     auto actionId = qgetenv("COPYQ_ACTION_ID").toInt(&hasActionId);
@@ -178,12 +165,37 @@ void ClipboardClient::start(const QStringList &arguments)
 #endif
     const auto actionName = getTextData( qgetenv("COPYQ_ACTION_NAME") );
 
-    if ( socket.start() ) {
-        if (hasActionId)
-            scriptable.setActionId(actionId);
-        scriptable.setActionName(actionName);
+    if ( !socket.start() )
+        return;
 
-        const int exitCode = scriptable.executeArguments(arguments);
+    // Avoid creating script engine for simple commands run outside actions.
+    int exitCode;
+    if ( !hasActionId && runNativeCommand(arguments, &scriptableProxy, &exitCode) ) {
+        scriptableProxy.flushQueuedFunctionCalls();
         exit(exitCode);
+        return;
     }
+
+    QScriptEngine engine;
+    Scriptable scriptable(&engine, &scriptableProxy);
+
+    connect( &socket, &ClientSocket::disconnected,
+             &scriptable, &Scriptable::abort );
+
+    connect( &scriptable, &Scriptable::finished,
+             &scriptableProxy, &ScriptableProxy::clientDisconnected );
+
+    connect( this, &ClipboardClient::dataReceived,
+             &scriptable, &Scriptable::dataReceived, Qt::QueuedConnection );
+    connect( &scriptable, &Scriptable::receiveData,
+             &socket, [&]() {
+                socket.sendMessage(QByteArray(), CommandReceiveData);
+             });
+
+    if (hasActionId)
+        scriptable.setActionId(actionId);
+    scriptable.setActionName(actionName);
+
+    exitCode = scriptable.executeArguments(arguments);
+    exit(exitCode);
 }
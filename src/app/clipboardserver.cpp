@@ -163,6 +163,8 @@ ClipboardServer::ClipboardServer(QApplication *app, const QString &sessionName)
              this, &ClipboardServer::onDisableClipboardStoringRequest );
     connect( m_wnd, &MainWindow::sendActionData,
              this, &ClipboardServer::sendActionData );
+    connect( m_sharedData->actions, &ActionHandler::sendActionData,
+             this, &ClipboardServer::sendActionData );
 
     // notify window if configuration changes
     connect( m_wnd, &MainWindow::configurationChanged,
@@ -537,6 +539,14 @@ void ClipboardServer::onClientMessageReceived(
         clientData.proxy->callFunction(message);
         break;
     }
+    case CommandFunctionCallBatch: {
+        const auto &clientData = m_clients.value(clientId);
+        if (!clientData.isValid())
+            return;
+
+        clientData.proxy->callFunctions(message);
+        break;
+    }
     case CommandReceiveData: {
         const auto &clientData = m_clients.value(clientId);
         if (!clientData.isValid())
@@ -702,6 +712,8 @@ void ClipboardServer::loadSettings()
     m_sharedData->saveDelayMsOnItemMoved = appConfig.option<Config::save_delay_ms_on_item_moved>();
     m_sharedData->saveDelayMsOnItemEdited = appConfig.option<Config::save_delay_ms_on_item_edited>();
 
+    setItemBlobMinSize( appConfig.option<Config::item_blob_min_size>() );
+
     m_wnd->loadSettings(settings, appConfig);
 
     m_textTabSize = appConfig.option<Config::text_tab_width>();
@@ -189,6 +189,8 @@ Action::Action(QObject *parent)
 
 Action::~Action()
 {
+    // Don't request terminating external command while being destroyed.
+    m_runningExternal = false;
     closeSubCommands();
 }
 
@@ -230,6 +232,8 @@ void Action::setInputWithFormat(const QVariantMap &data, const QString &inputFor
 
 void Action::start()
 {
+    // Run externally started action in a process instead.
+    m_runningExternal = false;
     closeSubCommands();
 
     if ( m_currentLine + 1 >= m_cmds.size() ) {
@@ -294,6 +298,28 @@ void Action::start()
     }
 }
 
+void Action::startExternal()
+{
+    closeSubCommands();
+    m_runningExternal = true;
+    emit actionStarted(this);
+}
+
+void Action::finishExternal(int exitCode, const QString &errorString)
+{
+    if (!m_runningExternal)
+        return;
+
+    m_runningExternal = false;
+    m_exitCode = exitCode;
+    if ( !errorString.isEmpty() ) {
+        m_errorString = errorString;
+        m_failed = true;
+    }
+
+    emit actionFinished(this);
+}
+
 bool Action::waitForFinished(int msecs)
 {
     if ( !isRunning() )
@@ -319,6 +345,9 @@ bool Action::waitForFinished(int msecs)
 
 bool Action::isRunning() const
 {
+    if (m_runningExternal)
+        return true;
+
     return !m_processes.empty() && m_processes.back()->state() != QProcess::NotRunning;
 }
 
@@ -412,6 +441,11 @@ void Action::onBytesWritten()
 
 void Action::terminate()
 {
+    if (m_runningExternal) {
+        emit terminateRequested(this);
+        return;
+    }
+
     if (m_processes.empty())
         return;
 
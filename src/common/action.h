@@ -76,6 +76,17 @@ public:
     /** Execute command. */
     void start();
 
+    /**
+     * Mark action as running without starting any process
+     * (command is executed elsewhere, e.g. in a script worker).
+     *
+     * Action is finished with finishExternal().
+     */
+    void startExternal();
+
+    /** Finish action started with startExternal(). */
+    void finishExternal(int exitCode, const QString &errorString = QString());
+
     bool waitForFinished(int msecs = -1);
 
     bool isRunning() const;
@@ -112,6 +123,9 @@ signals:
 
     void actionOutput(const QByteArray &output);
 
+    /** Emitted on terminate() if action was started with startExternal(). */
+    void terminateRequested(Action *act);
+
 private:
     void onSubProcessError(QProcess::ProcessError error);
     void onSubProcessStarted();
@@ -131,6 +145,7 @@ private:
     QByteArray m_errorOutput;
     bool m_failed;
     bool m_readOutput = false;
+    bool m_runningExternal = false;
     int m_currentLine;
     QString m_name;
     QVariantMap m_data;
@@ -146,6 +146,14 @@ struct filter_case_insensitive : Config<bool> {
     static Value defaultValue() { return true; }
 };
 
+struct filter_all_tabs : Config<bool> {
+    static QString name() { return "filter_all_tabs"; }
+};
+
+struct filter_fuzzy : Config<bool> {
+    static QString name() { return "filter_fuzzy"; }
+};
+
 struct always_on_top : Config<bool> {
     static QString name() { return "always_on_top"; }
 };
@@ -332,6 +340,30 @@ struct max_process_manager_rows : Config<uint> {
     static Value defaultValue() { return 1000; }
 };
 
+struct script_workers : Config<int> {
+    static QString name() { return "script_workers"; }
+    static Value defaultValue() { return 4; }
+    static Value value(Value v) { return qBound(0, v, 32); }
+};
+
+struct script_worker_max_jobs : Config<int> {
+    static QString name() { return "script_worker_max_jobs"; }
+    static Value defaultValue() { return 100; }
+    static Value value(Value v) { return qMax(1, v); }
+};
+
+struct menu_filter_jobs : Config<int> {
+    static QString name() { return "menu_filter_jobs"; }
+    static Value defaultValue() { return 4; }
+    static Value value(Value v) { return qBound(1, v, 32); }
+};
+
+struct menu_filter_cache_ms : Config<int> {
+    static QString name() { return "menu_filter_cache_ms"; }
+    static Value defaultValue() { return 5000; }
+    static Value value(Value v) { return qMax(0, v); }
+};
+
 struct save_delay_ms_on_item_added : Config<int> {
     static QString name() { return "save_delay_ms_on_item_added"; }
     static Value defaultValue() { return 5 * 60 * 1000; }
@@ -357,6 +389,11 @@ struct save_delay_ms_on_item_edited : Config<int> {
     static Value defaultValue() { return 1000; }
 };
 
+struct item_blob_min_size : Config<int> {
+    static QString name() { return "item_blob_min_size"; }
+    static Value defaultValue() { return 64 * 1024; }
+};
+
 struct save_on_app_deactivated : Config<bool> {
     static QString name() { return "save_on_app_deactivated"; }
     static Value defaultValue() { return true; }
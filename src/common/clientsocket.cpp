@@ -23,7 +23,23 @@
 #include "common/log.h"
 #include "common/sleeptimer.h"
 
-#include <QDataStream>
+#include <QFile>
+#include <QUuid>
+#include <QtEndian>
+
+#ifdef Q_OS_LINUX
+#   include <cerrno>
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/socket.h>
+#   include <unistd.h>
+#   ifdef MFD_ALLOW_SEALING
+#       define COPYQ_SHARED_MEMORY_MESSAGES
+#   endif
+#endif
+
+#include <cstring>
+#include <limits>
 
 #define SOCKET_LOG(text) \
     COPYQ_LOG_VERBOSE( QString("Socket %1: %2").arg(m_socketId).arg(text) )
@@ -36,69 +52,157 @@ ClientSocketId lastSocketId = 0;
 const quint32 protocolMagicNumber = 0x0C090701;
 const quint32 protocolVersion = 1;
 
-template <typename T>
-int doStreamDataSize(T value)
+/**
+ * Message code of protocol version 1 message in which client tells server
+ * that it understands the internal frames below.
+ *
+ * Older servers ignore the message. Peers never send the internal frames
+ * before they know the other side understands them (older peers would close
+ * the connection on unexpected message version).
+ */
+const qint32 sharedMemorySupportMessageCode = -0x0C09;
+const char sharedMemorySupportMessage[] = "shared-memory";
+
+// Other versions are internal frames for passing big messages in shared memory.
+// Message code of these frames is the file descriptor of the shared memory in sender.
+/// Check if peer can read shared memory (message contains token stored in the shared memory).
+const quint32 sharedMemoryProbeVersion = 2;
+/// Reply to probe (message is "1" only if peer can read shared memory).
+const quint32 sharedMemoryProbeReplyVersion = 3;
+/// Message data are passed in shared memory (message contains message code and size).
+const quint32 sharedMemoryMessageVersion = 4;
+/// Receiver no longer needs shared memory.
+const quint32 sharedMemoryReleaseVersion = 5;
+/// Receiver failed to read shared memory and requests message data.
+const quint32 sharedMemoryResendVersion = 6;
+/// Message data which receiver failed to read from shared memory.
+const quint32 sharedMemoryResentVersion = 7;
+
+const int sharedMemoryThreshold = 1024 * 1024;
+const int sharedMemoryMessageSize = 8;
+
+/// Message buffer allocated before receiving any data (grows as data arrive).
+const int initialMessageBufferSize = 1024 * 1024;
+
+// Header consists of magic number, version and message length
+// followed by message code (all big-endian as written by QDataStream).
+const int versionOffset = 4;
+const int messageLengthOffset = 8;
+const int messageCodeOffset = 12;
+const int messageCodeSize = 4;
+
+quint32 readUInt32(const char *data)
 {
-    QByteArray bytes;
-    {
-        QDataStream dataStream(&bytes, QIODevice::WriteOnly);
-        dataStream.setVersion(QDataStream::Qt_5_0);
-        dataStream << value;
-    }
-    return bytes.length();
+    quint32 value;
+    std::memcpy(&value, data, sizeof(value));
+    return qFromBigEndian(value);
 }
 
-template <typename T>
-int streamDataSize(T value)
+void writeUInt32(quint32 value, char *data)
 {
-    static int size = doStreamDataSize<T>(value);
-    return size;
+    const quint32 bigEndianValue = qToBigEndian(value);
+    std::memcpy(data, &bigEndianValue, sizeof(bigEndianValue));
 }
 
-int headerDataSize()
+bool writeMessage(
+        QLocalSocket *socket, const QByteArray &message, int messageCode,
+        quint32 version = protocolVersion)
 {
-    QByteArray bytes;
+    const auto length = static_cast<quint32>(messageCodeSize + message.length());
+    COPYQ_LOG_VERBOSE( QString("Write message (%1 bytes).").arg(length) );
+
+    if (message.size() > bigMessageThreshold)
+        COPYQ_LOG( QString("Sending big message: %1 MiB").arg(message.size() / 1024 / 1024) );
+
+    // Write header and message separately to avoid copying message data.
+    char header[ClientSocket::headerSize];
+    writeUInt32(protocolMagicNumber, header);
+    writeUInt32(version, header + versionOffset);
+    writeUInt32(length, header + messageLengthOffset);
+    writeUInt32(static_cast<quint32>(messageCode), header + messageCodeOffset);
+
+    if ( socket->write(header, ClientSocket::headerSize) != ClientSocket::headerSize
+         || socket->write(message) != message.size() )
     {
-        QDataStream dataStream(&bytes, QIODevice::WriteOnly);
-        dataStream.setVersion(QDataStream::Qt_5_0);
-        dataStream << protocolMagicNumber << protocolVersion;
+        COPYQ_LOG("Cannot write message!");
+        return false;
     }
-    return bytes.length();
+
+    COPYQ_LOG_VERBOSE("Message written.");
+    return true;
 }
 
-template <typename T>
-bool readValue(T *value, QByteArray *message)
+#ifdef COPYQ_SHARED_MEMORY_MESSAGES
+/// Return sealed memory file with given data or -1 on error.
+int createSharedMemory(const QByteArray &data)
 {
-    QDataStream stream(*message);
-    stream.setVersion(QDataStream::Qt_5_0);
-    stream >> *value;
-    message->remove(0, streamDataSize(*value));
-    return stream.status() == QDataStream::Ok;
+    const int fd = memfd_create("copyq-message", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1)
+        return -1;
+
+    const char *bytes = data.constData();
+    size_t remaining = static_cast<size_t>(data.size());
+    while (remaining > 0) {
+        const auto written = ::write(fd, bytes, remaining);
+        if (written == -1) {
+            if (errno == EINTR)
+                continue;
+            ::close(fd);
+            return -1;
+        }
+        bytes += written;
+        remaining -= static_cast<size_t>(written);
+    }
+
+    if ( fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1 ) {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
 }
 
-bool writeMessage(QLocalSocket *socket, const QByteArray &msg)
+/// Return ID of the peer process as seen from this process (0 on error).
+qint64 peerProcessId(QLocalSocket *socket)
 {
-    COPYQ_LOG_VERBOSE( QString("Write message (%1 bytes).").arg(msg.size()) );
-
-    if (msg.size() > bigMessageThreshold)
-        COPYQ_LOG( QString("Sending big message: %1 MiB").arg(msg.size() / 1024 / 1024) );
+    ucred credentials{};
+    socklen_t length = sizeof(credentials);
+    const int socketFd = static_cast<int>(socket->socketDescriptor());
+    if ( getsockopt(socketFd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == -1 )
+        return 0;
+    return credentials.pid;
+}
 
-    QDataStream out(socket);
-    out.setVersion(QDataStream::Qt_5_0);
-    // length is serialized as a quint32, followed by msg
-    const auto length = static_cast<quint32>(msg.length());
-    out << protocolMagicNumber << protocolVersion;
-    out.writeBytes( msg.constData(), length );
+/**
+ * Read memory file opened by the peer process.
+ *
+ * Local socket is read by Qt which would drop file descriptors passed with
+ * SCM_RIGHTS so the file is opened using the path in "/proc" instead.
+ * This fails if "/proc" is restricted.
+ */
+bool readSharedMemory(QLocalSocket *socket, int fd, int size, QByteArray *data)
+{
+    const qint64 pid = peerProcessId(socket);
+    if (pid <= 0)
+        return false;
 
-    if (out.status() != QDataStream::Ok) {
-        COPYQ_LOG("Cannot write message!");
+    QFile file( QString("/proc/%1/fd/%2").arg(pid).arg(fd) );
+    if ( !file.open(QIODevice::ReadOnly | QIODevice::Unbuffered) || file.size() != size )
         return false;
-    }
 
-    COPYQ_LOG_VERBOSE("Message written.");
-    return true;
+    data->resize(size);
+    return file.read(data->data(), size) == size;
 }
 
+QByteArray readOwnSharedMemory(int fd)
+{
+    QFile file;
+    if ( !file.open(fd, QIODevice::ReadOnly | QIODevice::Unbuffered) || !file.seek(0) )
+        return QByteArray();
+    return file.readAll();
+}
+#endif
+
 } //namespace
 
 LocalSocketGuard::LocalSocketGuard(QLocalSocket *socket)
@@ -129,6 +233,7 @@ ClientSocket::ClientSocket(const QString &serverName, QObject *parent)
     , m_socket(new QLocalSocket)
     , m_socketId(++lastSocketId)
     , m_closed(false)
+    , m_connectedToServer(true)
 {
     m_socket->connectToServer(serverName);
 
@@ -154,6 +259,7 @@ ClientSocket::~ClientSocket()
 {
     SOCKET_LOG("Destroying socket.");
     close();
+    releaseAllSharedMemory();
 }
 
 bool ClientSocket::start()
@@ -175,6 +281,10 @@ bool ClientSocket::start()
 
     onStateChanged(m_socket->state());
 
+    // Server probes shared memory only after client tells it's supported.
+    if (m_connectedToServer)
+        sendSharedMemorySupport();
+
     onReadyRead();
 
     return true;
@@ -188,13 +298,13 @@ void ClientSocket::sendMessage(const QByteArray &message, int messageCode)
         SOCKET_LOG("Cannot send message to client. Socket is already deleted.");
     } else if (m_closed) {
         SOCKET_LOG("Client disconnected!");
+    } else if ( m_peerReadsSharedMemory
+                && message.size() > sharedMemoryThreshold
+                && sendSharedMemoryMessage(message, messageCode) )
+    {
+        SOCKET_LOG("Message sent to client in shared memory.");
     } else {
-        QByteArray msg;
-        QDataStream out(&msg, QIODevice::WriteOnly);
-        out.setVersion(QDataStream::Qt_5_0);
-        out << static_cast<qint32>(messageCode);
-        out.writeRawData( message.constData(), message.length() );
-        if ( writeMessage(m_socket, msg) )
+        if ( writeMessage(m_socket, message, messageCode) )
             SOCKET_LOG("Message sent to client.");
         else
             SOCKET_LOG("Failed to send message to client!");
@@ -216,61 +326,284 @@ void ClientSocket::onReadyRead()
         return;
     }
 
-    const qint64 available = m_socket->bytesAvailable();
-    m_message.append( m_socket->read(available) );
-
-    while ( !m_message.isEmpty() ) {
+    // Data are read directly into header buffer and into preallocated message
+    // so message data are never copied or moved after being read from socket.
+    while (m_socket) {
         if (!m_hasMessageLength) {
-            const int preambleSize = headerDataSize() + streamDataSize(m_messageLength);
-            if ( m_message.length() < preambleSize )
-                break;
+            if ( !readToBuffer(m_header, headerSize, &m_headerBytesRead) )
+                return;
+
+            m_headerBytesRead = 0;
 
+            const auto magicNumber = readUInt32(m_header);
+            if (magicNumber != protocolMagicNumber) {
+                error("Unexpected message magic number from client!");
+                return;
+            }
+
+            m_messageVersion = readUInt32(m_header + versionOffset);
+            if (m_messageVersion < protocolVersion || m_messageVersion > sharedMemoryResentVersion) {
+                error("Unexpected message version from client!");
+                return;
+            }
+
+            m_messageLength = readUInt32(m_header + messageLengthOffset);
+            if ( m_messageLength < static_cast<quint32>(messageCodeSize)
+                 || m_messageLength > static_cast<quint32>(std::numeric_limits<int>::max()) )
             {
-                QDataStream stream(m_message);
-                stream.setVersion(QDataStream::Qt_5_0);
-                quint32 magicNumber;
-                quint32 version;
-                stream >> magicNumber >> version >> m_messageLength;
-                if ( stream.status() != QDataStream::Ok ) {
-                    error("Failed to read message length from client!");
-                    return;
-                }
-
-                if (magicNumber != protocolMagicNumber) {
-                    error("Unexpected message magic number from client!");
-                    return;
-                }
-
-                if (version != protocolVersion) {
-                    error("Unexpected message version from client!");
-                    return;
-                }
+                error("Unexpected message length from client!");
+                return;
             }
 
-            m_message.remove(0, preambleSize);
+            m_messageCode = static_cast<qint32>( readUInt32(m_header + messageCodeOffset) );
+
+            m_messageSize = static_cast<int>(m_messageLength) - messageCodeSize;
+            m_message.resize( qMin(m_messageSize, initialMessageBufferSize) );
+            m_messageBytesRead = 0;
             m_hasMessageLength = true;
 
             if (m_messageLength > bigMessageThreshold)
                 COPYQ_LOG( QString("Receiving big message: %1 MiB").arg(m_messageLength / 1024 / 1024) );
         }
 
-        const auto length = static_cast<int>(m_messageLength);
-        if ( m_message.length() < length )
+        if ( !readMessageData() )
+            return;
+
+        m_hasMessageLength = false;
+
+        switch (m_messageVersion) {
+        case sharedMemoryProbeVersion:
+            receiveSharedMemoryProbe();
+            if (m_connectedToServer)
+                sendSharedMemoryProbe();
+            break;
+        case sharedMemoryProbeReplyVersion:
+            m_peerReadsSharedMemory = m_message == "1";
+            releaseSharedMemory(m_messageCode);
+            break;
+        case sharedMemoryMessageVersion:
+            if ( !receiveSharedMemoryMessage() )
+                return;
+            break;
+        case sharedMemoryReleaseVersion:
+            releaseSharedMemory(m_messageCode);
             break;
+        case sharedMemoryResendVersion:
+            resendSharedMemoryMessage(m_messageCode);
+            break;
+        case sharedMemoryResentVersion:
+            receiveResentMessage();
+            break;
+        default:
+            if ( !m_connectedToServer
+                 && m_messageCode == sharedMemorySupportMessageCode
+                 && m_message == sharedMemorySupportMessage )
+            {
+                sendSharedMemoryProbe();
+                break;
+            }
+            m_receivedMessages.append( ReceivedMessage{QByteArray(), m_messageCode, -1} );
+            m_receivedMessages.last().message.swap(m_message);
+        }
 
-        QByteArray msg = m_message.mid(0, length);
-        qint32 messageCode;
+        emitReceivedMessages();
+    }
+}
 
-        if ( !readValue(&messageCode, &msg) ) {
-            error("Failed to read message code from client!");
-            return;
+void ClientSocket::emitReceivedMessages()
+{
+    // Keep order of messages while waiting for data of a message which
+    // could not be read from shared memory.
+    while ( !m_receivedMessages.isEmpty() && m_receivedMessages.first().sharedMemoryFd == -1 ) {
+        const ReceivedMessage received = m_receivedMessages.takeFirst();
+        emit messageReceived(received.message, received.messageCode, id());
+    }
+}
+
+bool ClientSocket::readMessageData()
+{
+    while ( readToBuffer(m_message.data(), m_message.size(), &m_messageBytesRead) ) {
+        if (m_messageBytesRead == m_messageSize)
+            return true;
+
+        // Avoid allocating memory for whole message from untrusted header.
+        const qint64 bufferSize = 2 * static_cast<qint64>(m_message.size());
+        m_message.resize( static_cast<int>(qMin<qint64>(m_messageSize, bufferSize)) );
+    }
+
+    return false;
+}
+
+bool ClientSocket::readToBuffer(char *buffer, int size, int *bytesRead)
+{
+    while (*bytesRead < size) {
+        const qint64 bytes = m_socket->read(buffer + *bytesRead, size - *bytesRead);
+        if (bytes < 0) {
+            error("Failed to read message from client!");
+            return false;
         }
 
-        m_hasMessageLength = false;
-        m_message = m_message.mid(length);
+        if (bytes == 0)
+            return false;
 
-        emit messageReceived(msg, messageCode, id());
+        *bytesRead += static_cast<int>(bytes);
     }
+
+    return true;
+}
+
+void ClientSocket::sendSharedMemorySupport()
+{
+#ifdef COPYQ_SHARED_MEMORY_MESSAGES
+    writeMessage( m_socket, QByteArray(sharedMemorySupportMessage),
+                  sharedMemorySupportMessageCode );
+#endif
+}
+
+void ClientSocket::sendSharedMemoryProbe()
+{
+#ifdef COPYQ_SHARED_MEMORY_MESSAGES
+    if (m_sharedMemoryProbeSent)
+        return;
+    m_sharedMemoryProbeSent = true;
+
+    const QByteArray token = QUuid::createUuid().toRfc4122();
+    const int fd = createSharedMemory(token);
+    if (fd == -1) {
+        SOCKET_LOG("Failed to create shared memory.");
+        return;
+    }
+
+    if ( !writeMessage(m_socket, token, fd, sharedMemoryProbeVersion) ) {
+        ::close(fd);
+        return;
+    }
+
+    m_sharedMemory.append(fd);
+#endif
+}
+
+void ClientSocket::receiveSharedMemoryProbe()
+{
+    bool canRead = false;
+#ifdef COPYQ_SHARED_MEMORY_MESSAGES
+    QByteArray token;
+    canRead = readSharedMemory(m_socket, m_messageCode, m_message.size(), &token)
+            && token == m_message;
+#endif
+
+    if (!canRead)
+        SOCKET_LOG("Cannot read shared memory of peer, big messages are sent through socket.");
+
+    writeMessage( m_socket, canRead ? QByteArray("1") : QByteArray(),
+                  m_messageCode, sharedMemoryProbeReplyVersion );
+}
+
+bool ClientSocket::sendSharedMemoryMessage(const QByteArray &message, int messageCode)
+{
+#ifdef COPYQ_SHARED_MEMORY_MESSAGES
+    const int fd = createSharedMemory(message);
+    if (fd == -1) {
+        SOCKET_LOG("Failed to create shared memory for message.");
+        return false;
+    }
+
+    QByteArray msg(sharedMemoryMessageSize, Qt::Uninitialized);
+    writeUInt32( static_cast<quint32>(messageCode), msg.data() );
+    writeUInt32( static_cast<quint32>(message.size()), msg.data() + 4 );
+    if ( !writeMessage(m_socket, msg, fd, sharedMemoryMessageVersion) ) {
+        ::close(fd);
+        return false;
+    }
+
+    // Keep the file open until receiver reads it.
+    m_sharedMemory.append(fd);
+    return true;
+#else
+    Q_UNUSED(message);
+    Q_UNUSED(messageCode);
+    return false;
+#endif
+}
+
+bool ClientSocket::receiveSharedMemoryMessage()
+{
+    if (m_message.size() != sharedMemoryMessageSize) {
+        error("Unexpected shared memory message from client!");
+        return false;
+    }
+
+    const int fd = m_messageCode;
+    const auto messageCode = static_cast<int>( readUInt32(m_message.constData()) );
+    const auto size = readUInt32(m_message.constData() + 4);
+
+    QByteArray msg;
+    bool ok = false;
+#ifdef COPYQ_SHARED_MEMORY_MESSAGES
+    ok = size <= static_cast<quint32>(std::numeric_limits<int>::max())
+            && readSharedMemory( m_socket, fd, static_cast<int>(size), &msg );
+#else
+    Q_UNUSED(size);
+#endif
+
+    if (ok) {
+        m_receivedMessages.append( ReceivedMessage{msg, messageCode, -1} );
+        writeMessage( m_socket, QByteArray(), fd, sharedMemoryReleaseVersion );
+    } else {
+        // Wait for the sender to resend the message data through socket.
+        SOCKET_LOG("Failed to read message from shared memory, requesting data through socket.");
+        m_receivedMessages.append( ReceivedMessage{QByteArray(), messageCode, fd} );
+        writeMessage( m_socket, QByteArray(), fd, sharedMemoryResendVersion );
+    }
+
+    return true;
+}
+
+void ClientSocket::resendSharedMemoryMessage(int fd)
+{
+    COPYQ_LOG("Peer failed to read shared memory, sending big messages through socket.");
+    m_peerReadsSharedMemory = false;
+
+    QByteArray message;
+#ifdef COPYQ_SHARED_MEMORY_MESSAGES
+    if ( m_sharedMemory.contains(fd) )
+        message = readOwnSharedMemory(fd);
+#endif
+
+    writeMessage(m_socket, message, fd, sharedMemoryResentVersion);
+    releaseSharedMemory(fd);
+}
+
+void ClientSocket::receiveResentMessage()
+{
+    for (auto &received : m_receivedMessages) {
+        if (received.sharedMemoryFd == m_messageCode) {
+            received.message.swap(m_message);
+            received.sharedMemoryFd = -1;
+            return;
+        }
+    }
+
+    SOCKET_LOG("Received unexpected message data.");
+}
+
+void ClientSocket::releaseSharedMemory(int fd)
+{
+#ifdef COPYQ_SHARED_MEMORY_MESSAGES
+    if ( m_sharedMemory.removeOne(fd) )
+        ::close(fd);
+#else
+    Q_UNUSED(fd);
+#endif
+}
+
+void ClientSocket::releaseAllSharedMemory()
+{
+#ifdef COPYQ_SHARED_MEMORY_MESSAGES
+    for (const int fd : m_sharedMemory)
+        ::close(fd);
+#endif
+    m_sharedMemory.clear();
 }
 
 void ClientSocket::onError(QLocalSocket::LocalSocketError error)
@@ -298,6 +631,8 @@ void ClientSocket::onStateChanged(QLocalSocket::LocalSocketState state)
             if (m_hasMessageLength)
                 log("ERROR: Socket disconnected before receiving message", LogError);
 
+            releaseAllSharedMemory();
+
             emit disconnected(id());
         }
     }
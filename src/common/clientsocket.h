@@ -23,6 +23,7 @@
 #include <QLocalSocket>
 #include <QObject>
 #include <QPointer>
+#include <QVector>
 
 using ClientSocketId = qulonglong;
 
@@ -48,6 +49,9 @@ class ClientSocket final : public QObject
 {
     Q_OBJECT
 public:
+    /// Size of message header (magic number, version, message length and code).
+    static constexpr int headerSize = 16;
+
     ClientSocket();
 
     explicit ClientSocket(const QString &serverName, QObject *parent = nullptr);
@@ -82,13 +86,67 @@ private:
 
     void error(const QString &errorMessage);
 
+    /// Read available message data, return true if whole message was received.
+    bool readMessageData();
+
+    /// Read available data until @a size bytes are in @a buffer.
+    bool readToBuffer(char *buffer, int size, int *bytesRead);
+
+    void emitReceivedMessages();
+
+    /**
+     * Tell server that this client understands shared memory frames (Linux only).
+     *
+     * Server sends the probe only after this so older clients never receive
+     * frames they cannot handle.
+     */
+    void sendSharedMemorySupport();
+
+    /// Check if peer can read shared memory of this process (Linux only).
+    void sendSharedMemoryProbe();
+    void receiveSharedMemoryProbe();
+
+    /**
+     * Send big message in shared memory (Linux only).
+     *
+     * @return false if shared memory is not available (message is not sent)
+     */
+    bool sendSharedMemoryMessage(const QByteArray &message, int messageCode);
+    bool receiveSharedMemoryMessage();
+    void resendSharedMemoryMessage(int fd);
+    void receiveResentMessage();
+    void releaseSharedMemory(int fd);
+    void releaseAllSharedMemory();
+
+    struct ReceivedMessage {
+        QByteArray message;
+        int messageCode;
+        /// Shared memory of the peer with message data still to be resent, or -1.
+        int sharedMemoryFd;
+    };
+
     LocalSocketGuard m_socket;
     ClientSocketId m_socketId;
     bool m_closed;
+    bool m_connectedToServer = false;
 
     bool m_hasMessageLength = false;
     quint32 m_messageLength = 0;
+    qint32 m_messageCode = 0;
+    quint32 m_messageVersion = 0;
+    char m_header[headerSize] = {};
+    int m_headerBytesRead = 0;
     QByteArray m_message;
+    int m_messageSize = 0;
+    int m_messageBytesRead = 0;
+
+    /// Received messages waiting to be emitted in order.
+    QVector<ReceivedMessage> m_receivedMessages;
+
+    /// Open shared memory files with sent messages.
+    QVector<int> m_sharedMemory;
+    bool m_sharedMemoryProbeSent = false;
+    bool m_peerReadsSharedMemory = false;
 };
 
 #endif // CLIENTSOCKET_H
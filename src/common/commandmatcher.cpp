@@ -0,0 +1,143 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "commandmatcher.h"
+
+#include "common/mimetypes.h"
+#include "common/textdata.h"
+
+#include <QStringList>
+
+namespace {
+
+/**
+ * Returns true if the pattern can be safely put into alternation with others.
+ *
+ * Back-references, subroutine calls and conditionals would refer to wrong
+ * groups and quoting ("\Q") could swallow rest of the combined pattern.
+ */
+bool canCombine(const QRegularExpression &re)
+{
+    static const QRegularExpression reUnsafe(R"(\\[1-9gkQ]|\(\?P[=>]|\(\?[-+]?[0-9]|\(\?[(R&]|\(\*)");
+    return re.isValid()
+        && re.patternOptions() == QRegularExpression::NoPatternOption
+        && !re.pattern().contains(reUnsafe);
+}
+
+} // namespace
+
+CommandMatcher::CommandMatcher(const QVector<Command> &commands)
+{
+    m_commands.reserve( commands.size() );
+
+    for (const auto &command : commands) {
+        CommandConditions conditions;
+        conditions.input = command.input;
+        conditions.output = command.output;
+        conditions.re.re = command.re;
+        conditions.wndre.re = command.wndre;
+        m_commands.append(conditions);
+
+        // Filter command must be run to find out whether the command matches.
+        if ( !command.matchCmd.isEmpty() ) {
+            m_commands.last().input = QString();
+            m_commands.last().re = Pattern();
+            m_commands.last().wndre = Pattern();
+        }
+    }
+
+    QVector<Pattern *> patterns;
+    for (auto &conditions : m_commands)
+        patterns.append(&conditions.re);
+    m_combinedRe = combine(patterns);
+
+    patterns.clear();
+    for (auto &conditions : m_commands)
+        patterns.append(&conditions.wndre);
+    m_combinedWndre = combine(patterns);
+}
+
+bool CommandMatcher::matchesAny(const QVariantMap &data) const
+{
+    if ( m_commands.isEmpty() )
+        return false;
+
+    const QString text = getTextData(data, mimeText);
+    const QString windowTitle = getTextData(data, mimeWindowTitle);
+
+    const bool combinedReMatches = m_combinedRe.pattern().isEmpty() || text.contains(m_combinedRe);
+    const bool combinedWndreMatches = m_combinedWndre.pattern().isEmpty() || windowTitle.contains(m_combinedWndre);
+
+    for (const auto &command : m_commands) {
+        // Same conditions as in Scriptable::canExecuteCommand().
+        if ( !command.input.isEmpty() ) {
+            if (command.input == mimeItems || command.input == "!OUTPUT") {
+                if ( data.contains(command.output) )
+                    continue;
+            } else if ( !data.contains(command.input) ) {
+                continue;
+            }
+        }
+
+        if ( matches(command.re, text, combinedReMatches)
+             && matches(command.wndre, windowTitle, combinedWndreMatches) )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+QRegularExpression CommandMatcher::combine(QVector<Pattern *> patterns)
+{
+    QStringList parts;
+    for (auto pattern : patterns) {
+        if ( !pattern->re.pattern().isEmpty() && canCombine(pattern->re) )
+            parts.append( pattern->re.pattern() );
+    }
+
+    if ( parts.isEmpty() )
+        return QRegularExpression();
+
+    parts.removeDuplicates();
+    QRegularExpression re( "(?:" + parts.join(")|(?:") + ")" );
+    if ( !re.isValid() )
+        return QRegularExpression();
+
+    re.optimize();
+
+    for (auto pattern : patterns) {
+        pattern->combined =
+                !pattern->re.pattern().isEmpty() && canCombine(pattern->re);
+    }
+
+    return re;
+}
+
+bool CommandMatcher::matches(const Pattern &pattern, const QString &text, bool combinedMatches)
+{
+    if ( pattern.re.pattern().isEmpty() )
+        return true;
+
+    if ( pattern.combined && !combinedMatches )
+        return false;
+
+    return text.contains(pattern.re);
+}
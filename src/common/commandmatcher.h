@@ -0,0 +1,71 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COMMANDMATCHER_H
+#define COMMANDMATCHER_H
+
+#include "common/command.h"
+
+#include <QRegularExpression>
+#include <QVariantMap>
+#include <QVector>
+
+/**
+ * Matches data against conditions of commands which can be checked
+ * without running anything (input format, text and window title regular
+ * expressions).
+ *
+ * Regular expressions of all commands are combined into a single one so that
+ * data not matching any command is rejected in a single pass over the text.
+ *
+ * Commands with filter command (Command::matchCmd) always match since
+ * the filter needs to be run.
+ */
+class CommandMatcher final {
+public:
+    CommandMatcher() = default;
+
+    explicit CommandMatcher(const QVector<Command> &commands);
+
+    /// Returns true if any command can be executed for the data.
+    bool matchesAny(const QVariantMap &data) const;
+
+private:
+    struct Pattern {
+        QRegularExpression re;
+        /// Part of combined pattern (so it cannot match if combined does not).
+        bool combined = false;
+    };
+
+    struct CommandConditions {
+        QString input;
+        QString output;
+        Pattern re;
+        Pattern wndre;
+    };
+
+    static QRegularExpression combine(QVector<Pattern *> patterns);
+    static bool matches(const Pattern &pattern, const QString &text, bool combinedMatches);
+
+    QVector<CommandConditions> m_commands;
+    QRegularExpression m_combinedRe;
+    QRegularExpression m_combinedWndre;
+};
+
+#endif // COMMANDMATCHER_H
@@ -44,6 +44,9 @@ enum CommandStatus {
     CommandData = 12,
 
     CommandReceiveData = 13,
+
+    /** Multiple function calls without return values. */
+    CommandFunctionCallBatch = 14,
 };
 
 #endif // COMMANDSTATUS_H
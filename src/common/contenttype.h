@@ -45,7 +45,7 @@ enum {
     removeFormats,
 
     /**
-     * Item hash
+     * Item hash (quint64)
      */
     hash,
 
@@ -59,7 +59,27 @@ enum {
     color,
 
     /// If true, hide content of item (not notes, tags etc.).
-    isHidden
+    isHidden,
+
+    /**
+     * Set or get data as MappedItemData (formats are read from tab file only when needed).
+     *
+     * Getting data is invalid if the item doesn't use mapped data.
+     */
+    mappedData,
+
+    /// Same as text but UTF-8 encoded (QByteArray).
+    textData,
+
+    /**
+     * Cached text for searching (text, notes, tags etc., see ItemFactory::searchText()).
+     *
+     * Invalid if the model cannot provide it.
+     */
+    searchText,
+
+    /// Same as searchText but case-folded (QString::toCaseFolded()).
+    foldedSearchText
 };
 
 }
@@ -0,0 +1,229 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "fuzzymatcher.h"
+
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+
+namespace {
+
+const int scoreMatch = 16;
+const int scoreGapStart = -3;
+const int scoreGapExtension = -1;
+const int bonusBoundary = 8;
+const int bonusConsecutive = 4;
+const int bonusFirstCharMultiplier = 2;
+
+const int maxRecencyBonus = 8;
+const int rowsPerRecencyPoint = 64;
+
+const int chunkSize = 1024;
+const int minRowsPerThread = 8 * chunkSize;
+
+int recencyBonus(int row)
+{
+    return qMax(0, maxRecencyBonus - row / rowsPerRecencyPoint);
+}
+
+/// Scores chunks of texts until all are processed (shared by threads).
+class ScoreJob final {
+public:
+    ScoreJob(const FuzzyMatcher &matcher, const QVector<QString> &texts, QVector<int> *scores)
+        : m_matcher(matcher)
+        , m_texts(texts)
+        , m_scores(scores->data())
+    {
+    }
+
+    void run()
+    {
+        for ( int start = m_nextChunk.fetchAndAddRelaxed(chunkSize);
+              start < m_texts.size();
+              start = m_nextChunk.fetchAndAddRelaxed(chunkSize) )
+        {
+            const int end = qMin(m_texts.size(), start + chunkSize);
+            for (int row = start; row < end; ++row)
+                m_scores[row] = m_matcher.score(m_texts[row], row);
+        }
+    }
+
+    QSemaphore &finished() { return m_finished; }
+
+private:
+    const FuzzyMatcher &m_matcher;
+    const QVector<QString> &m_texts;
+    int *m_scores;
+    QAtomicInt m_nextChunk;
+    QSemaphore m_finished;
+};
+
+class ScoreRunnable final : public QRunnable
+{
+public:
+    explicit ScoreRunnable(ScoreJob *job)
+        : m_job(job)
+    {
+    }
+
+    void run() override
+    {
+        m_job->run();
+        m_job->finished().release();
+    }
+
+private:
+    ScoreJob *m_job;
+};
+
+} // namespace
+
+FuzzyMatcher::FuzzyMatcher(const QString &pattern)
+{
+    for (const QChar c : pattern.toCaseFolded()) {
+        if ( !c.isSpace() )
+            m_pattern.append(c);
+    }
+}
+
+int FuzzyMatcher::score(const QString &text) const
+{
+    if ( m_pattern.isEmpty() )
+        return 1;
+
+    // Find the first occurrence (QString::indexOf(QChar) is vectorized in Qt).
+    int end = 0;
+    for (const QChar c : m_pattern) {
+        const int i = text.indexOf(c, end);
+        if (i == -1)
+            return 0;
+        end = i + 1;
+    }
+
+    // Find the shortest match ending at the last character.
+    const QChar *data = text.constData();
+    int start = end;
+    for (int p = m_pattern.size() - 1; p >= 0; ) {
+        --start;
+        if (data[start] == m_pattern[p])
+            --p;
+    }
+
+    int result = 0;
+    int p = 0;
+    bool inGap = false;
+    bool consecutive = false;
+    for (int i = start; i < end; ++i) {
+        if (data[i] != m_pattern[p]) {
+            result += inGap ? scoreGapExtension : scoreGapStart;
+            inGap = true;
+            consecutive = false;
+            continue;
+        }
+
+        int bonus = (i == 0 || !data[i - 1].isLetterOrNumber()) ? bonusBoundary : 0;
+        if (consecutive)
+            bonus = qMax(bonus, bonusConsecutive);
+        if (p == 0)
+            bonus *= bonusFirstCharMultiplier;
+
+        result += scoreMatch + bonus;
+        inGap = false;
+        consecutive = true;
+
+        if (++p == m_pattern.size())
+            break;
+    }
+
+    return qMax(1, result);
+}
+
+int FuzzyMatcher::score(const QString &text, int row) const
+{
+    const int result = score(text);
+    return result > 0 ? result + recencyBonus(row) : 0;
+}
+
+QVector<int> FuzzyMatcher::scores(const QVector<QString> &texts) const
+{
+    QVector<int> result( texts.size() );
+    ScoreJob job(*this, texts, &result);
+
+    // Current thread scores chunks too, so only idle threads are used.
+    const int threadCount = qMin(
+        QThread::idealThreadCount(), texts.size() / minRowsPerThread ) - 1;
+    int startedThreads = 0;
+    for (int i = 0; i < threadCount; ++i) {
+        auto runnable = new ScoreRunnable(&job);
+        if ( !QThreadPool::globalInstance()->tryStart(runnable) ) {
+            delete runnable;
+            break;
+        }
+        ++startedThreads;
+    }
+
+    job.run();
+    job.finished().acquire(startedThreads);
+
+    return result;
+}
+
+QVector<int> FuzzyMatcher::rank(const QVector<QString> &texts, int maxCount) const
+{
+    const QVector<int> rowScores = scores(texts);
+
+    QVector<int> rows;
+    for (int row = 0; row < rowScores.size(); ++row) {
+        if (rowScores[row] > 0)
+            rows.append(row);
+    }
+
+    const auto isBetter = [&rowScores](int lhs, int rhs) {
+        return rowScores[lhs] > rowScores[rhs]
+            || (rowScores[lhs] == rowScores[rhs] && lhs < rhs);
+    };
+
+    if (maxCount >= 0 && maxCount < rows.size()) {
+        std::partial_sort(rows.begin(), rows.begin() + maxCount, rows.end(), isBetter);
+        rows.resize(maxCount);
+    } else {
+        std::sort(rows.begin(), rows.end(), isBetter);
+    }
+
+    return rows;
+}
+
+QRegularExpression FuzzyMatcher::regularExpression() const
+{
+    QString pattern;
+    for (const QChar c : m_pattern) {
+        if ( !pattern.isEmpty() )
+            pattern.append(".*");
+        pattern.append( QRegularExpression::escape(c) );
+    }
+
+    return QRegularExpression(
+        pattern,
+        QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption );
+}
@@ -0,0 +1,70 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FUZZYMATCHER_H
+#define FUZZYMATCHER_H
+
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+/**
+ * Ranks texts containing all pattern characters in order
+ * (subsequence matching similar to fzf).
+ *
+ * Matches get bonus for characters at word boundaries, for consecutive
+ * characters and for recent items (rows at the top).
+ *
+ * All texts must be case-folded (QString::toCaseFolded()),
+ * white space in pattern is ignored.
+ */
+class FuzzyMatcher final {
+public:
+    explicit FuzzyMatcher(const QString &pattern);
+
+    bool isEmpty() const { return m_pattern.isEmpty(); }
+
+    /// Return positive score if text matches, otherwise zero.
+    int score(const QString &text) const;
+
+    /// Same as score() but includes bonus for recency of item in given @a row.
+    int score(const QString &text, int row) const;
+
+    /**
+     * Return scores for texts in row order including bonus for recency.
+     *
+     * Large number of texts is scored in multiple threads.
+     */
+    QVector<int> scores(const QVector<QString> &texts) const;
+
+    /**
+     * Return matching rows sorted by score (the best first).
+     *
+     * If @a maxCount is not negative, only given number of best rows is returned.
+     */
+    QVector<int> rank(const QVector<QString> &texts, int maxCount = -1) const;
+
+    /// Regular expression matching same texts (used for highlighting and new items).
+    QRegularExpression regularExpression() const;
+
+private:
+    QString m_pattern;
+};
+
+#endif // FUZZYMATCHER_H
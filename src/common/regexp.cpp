@@ -0,0 +1,206 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "regexp.h"
+
+#include "common/textdata.h"
+
+#include <QByteArray>
+#include <QStringList>
+
+namespace {
+
+bool isSpecialCharacter(QChar c)
+{
+    static const QString specialCharacters = QStringLiteral("\\^$.|?*+()[]{}");
+    return specialCharacters.contains(c);
+}
+
+bool isAscii(const QByteArray &bytes)
+{
+    for (const char c : bytes) {
+        if ( static_cast<unsigned char>(c) >= 0x80 )
+            return false;
+    }
+    return true;
+}
+
+/// Convert ASCII letters to lower case (written so that compilers can vectorize the loop).
+void toLowerAscii(const char *from, char *to, int size)
+{
+    for (int i = 0; i < size; ++i) {
+        const auto c = static_cast<unsigned char>(from[i]);
+        const bool isUpper = static_cast<unsigned char>(c - 'A') < 26;
+        to[i] = static_cast<char>( c | (isUpper << 5) );
+    }
+}
+
+} // namespace
+
+bool literalPatternParts(const QString &pattern, QStringList *parts)
+{
+    parts->clear();
+
+    QString part;
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern[i];
+        if (c == '\\') {
+            // Only escaped non-word characters are literal (e.g. not "\\d").
+            ++i;
+            if ( i == pattern.size() || (pattern[i].unicode() < 0x80 && pattern[i].isLetterOrNumber()) )
+                return false;
+            part.append(pattern[i]);
+        } else if ( c == '.' && i + 1 < pattern.size() && pattern[i + 1] == '*' ) {
+            ++i;
+            parts->append(part);
+            part.clear();
+        } else if ( isSpecialCharacter(c) ) {
+            return false;
+        } else {
+            part.append(c);
+        }
+    }
+
+    parts->append(part);
+    return true;
+}
+
+bool regExpNarrows(const QRegularExpression &re, const QRegularExpression &otherRe)
+{
+    if ( re.patternOptions() != otherRe.patternOptions() )
+        return false;
+
+    // Patterns with single '/' also match format names as whole.
+    if ( re.pattern().count('/') == 1 || otherRe.pattern().count('/') == 1 )
+        return false;
+
+    QStringList parts;
+    QStringList otherParts;
+    if ( !literalPatternParts(re.pattern(), &parts)
+         || !literalPatternParts(otherRe.pattern(), &otherParts)
+         || parts.size() < otherParts.size() )
+    {
+        return false;
+    }
+
+    // Each part of the other pattern must be found in the respective part.
+    for (int i = 0; i < otherParts.size(); ++i) {
+        if ( !parts[i].contains(otherParts[i]) )
+            return false;
+    }
+
+    return true;
+}
+
+LiteralMatcher::LiteralMatcher(const QRegularExpression &re)
+    : m_re(re)
+{
+    // Other options change meaning of the pattern.
+    const auto options = re.patternOptions();
+    const auto supportedOptions = QRegularExpression::CaseInsensitiveOption
+            | QRegularExpression::DotMatchesEverythingOption;
+    if ( options & ~supportedOptions )
+        return;
+
+    QStringList parts;
+    if ( !literalPatternParts(re.pattern(), &parts) )
+        return;
+
+    m_caseInsensitive = options.testFlag(QRegularExpression::CaseInsensitiveOption);
+    m_dotMatchesEverything = options.testFlag(QRegularExpression::DotMatchesEverythingOption);
+    m_literal = true;
+
+    for (const auto &part : parts) {
+        if ( !part.isEmpty() )
+            m_textParts.append( m_caseInsensitive ? part.toCaseFolded() : part );
+    }
+
+    for (const auto &part : parts) {
+        if ( part.isEmpty() )
+            continue;
+
+        QByteArray bytes = part.toUtf8();
+        if (m_caseInsensitive) {
+            // Case folding of non-ASCII characters would need decoding the text.
+            if ( !isAscii(bytes) )
+                return;
+            toLowerAscii( bytes.constData(), bytes.data(), bytes.size() );
+        }
+
+        m_parts.append( QByteArrayMatcher(bytes) );
+    }
+
+    m_valid = true;
+}
+
+LiteralMatcher::Result LiteralMatcher::match(const QByteArray &utf8Text) const
+{
+    if (!m_valid)
+        return Unknown;
+
+    const char *text = utf8Text.constData();
+    QByteArray lowerText;
+    if (m_caseInsensitive) {
+        lowerText.resize( utf8Text.size() );
+        toLowerAscii( text, lowerText.data(), utf8Text.size() );
+        text = lowerText.constData();
+    }
+
+    int from = 0;
+    for (const auto &part : m_parts) {
+        const int i = part.indexIn(text, utf8Text.size(), from);
+        if (i == -1)
+            return NoMatch;
+        from = i + part.pattern().size();
+    }
+
+    // Parts separated with ".*" must be on the same line.
+    if ( !m_dotMatchesEverything && m_parts.size() > 1 && (utf8Text.contains('\n') || utf8Text.contains('\r')) )
+        return Unknown;
+
+    return Match;
+}
+
+bool LiteralMatcher::matches(const QByteArray &utf8Text) const
+{
+    const Result result = match(utf8Text);
+    if (result == Unknown)
+        return getTextData(utf8Text).contains(m_re);
+    return result == Match;
+}
+
+bool LiteralMatcher::matchesSearchText(const QString &text) const
+{
+    if (!m_literal)
+        return text.contains(m_re);
+
+    int from = 0;
+    for (const auto &part : m_textParts) {
+        const int i = text.indexOf(part, from);
+        if (i == -1)
+            return false;
+        from = i + part.size();
+    }
+
+    // Parts separated with ".*" must be on the same line.
+    if ( !m_dotMatchesEverything && m_textParts.size() > 1 && (text.contains('\n') || text.contains('\r')) )
+        return text.contains(m_re);
+
+    return true;
+}
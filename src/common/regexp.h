@@ -1,9 +1,14 @@
 #ifndef REGEXP_H
 #define REGEXP_H
 
+#include <QByteArrayMatcher>
 #include <QRegularExpression>
+#include <QStringList>
+#include <QVector>
 
-static QRegularExpression anchoredRegExp(const QString &pattern)
+class QByteArray;
+
+inline QRegularExpression anchoredRegExp(const QString &pattern)
 {
 #if QT_VERSION >= QT_VERSION_CHECK(5,12,0)
     return QRegularExpression(QRegularExpression::anchoredPattern(pattern));
@@ -13,4 +18,69 @@ static QRegularExpression anchoredRegExp(const QString &pattern)
 #endif
 }
 
+/**
+ * Split pattern to literal parts which must be matched in order
+ * (parts are separated with ".*" as in patterns created by the search bar).
+ *
+ * @return false if the pattern contains any other special characters
+ */
+bool literalPatternParts(const QString &pattern, QStringList *parts);
+
+/**
+ * Return true only if any text matching @a re is known to also match @a otherRe.
+ *
+ * This can be determined only for patterns with literal parts (see literalPatternParts()).
+ */
+bool regExpNarrows(const QRegularExpression &re, const QRegularExpression &otherRe);
+
+/**
+ * Matches patterns with literal parts (see literalPatternParts())
+ * directly in UTF-8 encoded text without decoding it.
+ *
+ * Case-insensitive patterns are supported only if they contain ASCII characters.
+ */
+class LiteralMatcher final {
+public:
+    enum Result {
+        NoMatch,
+        Match,
+        /// Regular expression must be used to match the text.
+        Unknown
+    };
+
+    explicit LiteralMatcher(const QRegularExpression &re);
+
+    /// Return false if the pattern is not supported (all texts would be Unknown).
+    bool isValid() const { return m_valid; }
+
+    Result match(const QByteArray &utf8Text) const;
+
+    /// Return true if text matches, falls back to the regular expression.
+    bool matches(const QByteArray &utf8Text) const;
+
+    /// Return false if the pattern is not literal (matchesSearchText() cannot be used).
+    bool isLiteral() const { return m_literal; }
+
+    bool isCaseInsensitive() const { return m_caseInsensitive; }
+
+    /**
+     * Return true if text matches.
+     *
+     * Text must be case-folded (QString::toCaseFolded()) if the pattern is
+     * case-insensitive.
+     */
+    bool matchesSearchText(const QString &text) const;
+
+    const QRegularExpression &regularExpression() const { return m_re; }
+
+private:
+    QRegularExpression m_re;
+    QVector<QByteArrayMatcher> m_parts;
+    QStringList m_textParts;
+    bool m_caseInsensitive = false;
+    bool m_dotMatchesEverything = false;
+    bool m_literal = false;
+    bool m_valid = false;
+};
+
 #endif // REGEXP_H
@@ -0,0 +1,52 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "scriptjob.h"
+
+#include <QByteArray>
+#include <QDataStream>
+
+namespace {
+
+const quint32 serializedScriptJobMagicNumber = 0x5c417b01;
+
+} // namespace
+
+QByteArray serializeScriptJob(const ScriptJob &job)
+{
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << serializedScriptJobMagicNumber << job.actionId << job.actionName << job.arguments;
+    return bytes;
+}
+
+bool deserializeScriptJob(const QByteArray &bytes, ScriptJob *job)
+{
+    QDataStream stream(bytes);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magicNumber;
+    stream >> magicNumber;
+    if ( stream.status() != QDataStream::Ok || magicNumber != serializedScriptJobMagicNumber )
+        return false;
+
+    stream >> job->actionId >> job->actionName >> job->arguments;
+    return stream.status() == QDataStream::Ok && !job->arguments.isEmpty();
+}
@@ -0,0 +1,43 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCRIPTJOB_H
+#define SCRIPTJOB_H
+
+#include <QString>
+#include <QStringList>
+
+class QByteArray;
+
+/**
+ * Script passed from server to a script worker process instead of running it in new client.
+ */
+struct ScriptJob {
+    /// ID of action which runs the script.
+    int actionId = -1;
+    QString actionName;
+    /// Arguments for the client (without "copyq").
+    QStringList arguments;
+};
+
+QByteArray serializeScriptJob(const ScriptJob &job);
+
+bool deserializeScriptJob(const QByteArray &bytes, ScriptJob *job);
+
+#endif // SCRIPTJOB_H
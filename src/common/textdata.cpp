@@ -23,10 +23,110 @@
 
 #include <QLocale>
 #include <QString>
+#include <QtEndian>
 #include <Qt>
 
+#include <cstring>
+
 namespace {
 
+// XXH64 (https://github.com/Cyan4973/xxHash) processes four independent
+// 64-bit lanes so compilers can vectorize the main loop.
+const quint64 prime64_1 = 11400714785074694791ULL;
+const quint64 prime64_2 = 14029467366897019727ULL;
+const quint64 prime64_3 = 1609587929392839161ULL;
+const quint64 prime64_4 = 9650029242287828579ULL;
+const quint64 prime64_5 = 2870177450012600261ULL;
+
+quint64 rotateLeft(quint64 value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+quint64 read64(const uchar *data)
+{
+    quint64 value;
+    std::memcpy(&value, data, sizeof(value));
+    return qFromLittleEndian(value);
+}
+
+quint32 read32(const uchar *data)
+{
+    quint32 value;
+    std::memcpy(&value, data, sizeof(value));
+    return qFromLittleEndian(value);
+}
+
+quint64 xxh64Round(quint64 acc, quint64 input)
+{
+    acc += input * prime64_2;
+    acc = rotateLeft(acc, 31);
+    return acc * prime64_1;
+}
+
+quint64 xxh64MergeRound(quint64 acc, quint64 value)
+{
+    acc ^= xxh64Round(0, value);
+    return acc * prime64_1 + prime64_4;
+}
+
+quint64 xxh64(const void *input, size_t length, quint64 seed)
+{
+    auto data = static_cast<const uchar*>(input);
+    const uchar *end = data + length;
+    quint64 h64;
+
+    if (length >= 32) {
+        const uchar *limit = end - 32;
+        quint64 v1 = seed + prime64_1 + prime64_2;
+        quint64 v2 = seed + prime64_2;
+        quint64 v3 = seed;
+        quint64 v4 = seed - prime64_1;
+
+        do {
+            v1 = xxh64Round(v1, read64(data));
+            v2 = xxh64Round(v2, read64(data + 8));
+            v3 = xxh64Round(v3, read64(data + 16));
+            v4 = xxh64Round(v4, read64(data + 24));
+            data += 32;
+        } while (data <= limit);
+
+        h64 = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+        h64 = xxh64MergeRound(h64, v1);
+        h64 = xxh64MergeRound(h64, v2);
+        h64 = xxh64MergeRound(h64, v3);
+        h64 = xxh64MergeRound(h64, v4);
+    } else {
+        h64 = seed + prime64_5;
+    }
+
+    h64 += static_cast<quint64>(length);
+
+    for (; data + 8 <= end; data += 8) {
+        h64 ^= xxh64Round(0, read64(data));
+        h64 = rotateLeft(h64, 27) * prime64_1 + prime64_4;
+    }
+
+    if (data + 4 <= end) {
+        h64 ^= static_cast<quint64>(read32(data)) * prime64_1;
+        h64 = rotateLeft(h64, 23) * prime64_2 + prime64_3;
+        data += 4;
+    }
+
+    for (; data < end; ++data) {
+        h64 ^= (*data) * prime64_5;
+        h64 = rotateLeft(h64, 11) * prime64_1;
+    }
+
+    h64 ^= h64 >> 33;
+    h64 *= prime64_2;
+    h64 ^= h64 >> 29;
+    h64 *= prime64_3;
+    h64 ^= h64 >> 32;
+
+    return h64;
+}
+
 QString escapeHtmlSpaces(const QString &str)
 {
     QString str2 = str;
@@ -37,21 +137,30 @@ QString escapeHtmlSpaces(const QString &str)
 
 } // namespace
 
-uint hash(const QVariantMap &data)
+quint64 hashFormat(const QString &mime, const QByteArray &bytes)
 {
-    uint seed = 0;
-    QtPrivate::QHashCombine hash;
+    // Skip some special data.
+    if (mime == mimeWindowTitle || mime == mimeOwner || mime == mimeClipboardMode)
+        return 0;
 
-    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
-        const auto &mime = it.key();
+    const quint64 mimeHash = xxh64(mime.constData(), mime.size() * sizeof(QChar), 0);
+    return xxh64(bytes.constData(), bytes.size(), mimeHash);
+}
 
-        // Skip some special data.
-        if (mime == mimeWindowTitle || mime == mimeOwner || mime == mimeClipboardMode)
-            continue;
+quint64 combineHash(quint64 seed, quint64 formatHash)
+{
+    if (formatHash == 0)
+        return seed;
 
-        seed = hash(seed, mime);
-        seed = hash(seed, data[mime].toByteArray());
-    }
+    return seed ^ (formatHash + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+quint64 hash(const QVariantMap &data)
+{
+    quint64 seed = 0;
+
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it)
+        seed = combineHash( seed, hashFormat(it.key(), it.value().toByteArray()) );
 
     return seed;
 }
@@ -118,3 +227,45 @@ QVariantMap createDataMap(const QString &format, const QString &value)
 {
     return createDataMap( format, value.toUtf8() );
 }
+
+bool isInternalDataFormat(const QString &format)
+{
+    return format == mimeWindowTitle
+        || format == mimeItems
+        || format == mimeOwner
+        || format == mimeClipboardMode
+        || format == mimeCurrentTab
+        || format == mimeSelectedItems
+        || format == mimeCurrentItem
+        || format == mimeShortcut
+        || format == mimeOutputTab;
+}
+
+QVariantMap copyWithoutInternalData(const QVariantMap &data) {
+    QVariantMap newData;
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        const auto &format = it.key();
+        if ( !isInternalDataFormat(format) )
+            newData.insert(format, it.value());
+    }
+
+    return newData;
+}
+
+bool containsAnyData(const QVariantMap &data)
+{
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        const auto &format = it.key();
+        if ( isInternalDataFormat(format) )
+            continue;
+
+        auto bytes = it.value().toByteArray();
+        for (const auto &byte : bytes) {
+            const QChar c(byte);
+            if ( !c.isSpace() && !c.isNull() )
+                return true;
+        }
+    }
+
+    return false;
+}
@@ -25,7 +25,18 @@
 class QByteArray;
 class QString;
 
-uint hash(const QVariantMap &data);
+/**
+ * Return hash of item format (MIME type and data).
+ *
+ * Returns 0 for formats ignored when comparing items (window title etc.).
+ */
+quint64 hashFormat(const QString &mime, const QByteArray &bytes);
+
+/// Add format hash to item hash (formats must be added in order of MIME types).
+quint64 combineHash(quint64 seed, quint64 formatHash);
+
+/// Return hash of item data (used to find same items).
+quint64 hash(const QVariantMap &data);
 
 QString quoteString(const QString &str);
 
@@ -52,4 +63,12 @@ QVariantMap createDataMap(const QString &format, const QByteArray &value);
 
 QVariantMap createDataMap(const QString &format, const QString &value);
 
+/// Returns true for formats set by the application (window title, current tab etc.).
+bool isInternalDataFormat(const QString &format);
+
+QVariantMap copyWithoutInternalData(const QVariantMap &data);
+
+/// Returns true if any non-internal format contains non-whitespace characters.
+bool containsAnyData(const QVariantMap &data);
+
 #endif // TEXTDATA_H
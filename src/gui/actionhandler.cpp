@@ -22,11 +22,13 @@
 #include "common/appconfig.h"
 #include "common/action.h"
 #include "common/actiontablemodel.h"
+#include "common/commandstatus.h"
 #include "common/common.h"
 #include "common/contenttype.h"
 #include "common/display.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
+#include "common/scriptjob.h"
 #include "common/textdata.h"
 #include "gui/actionhandlerdialog.h"
 #include "gui/icons.h"
@@ -56,6 +58,25 @@ uint maxRowCount()
     return AppConfig().option<Config::max_process_manager_rows>();
 }
 
+const char scriptWorkerFunction[] = "scriptWorker";
+
+/// Return true if action runs only a script function without any input.
+bool canRunInScriptWorker(const Action &action)
+{
+    if ( !action.input().isEmpty() )
+        return false;
+
+    const auto &cmd = action.command();
+    if ( cmd.size() != 1 || cmd[0].size() != 1 )
+        return false;
+
+    const auto &args = cmd[0][0];
+    return args.size() >= 2
+        && args[0] == "copyq"
+        && !args[1].startsWith("-")
+        && args[1] != scriptWorkerFunction;
+}
+
 } // namespace
 
 ActionHandler::ActionHandler(NotificationDaemon *notificationDaemon, QObject *parent)
@@ -92,6 +113,9 @@ void ActionHandler::setActionData(int id, const QVariantMap &data)
 
 void ActionHandler::internalAction(Action *action)
 {
+    if ( canRunInScriptWorker(*action) && runInScriptWorker(action) )
+        return;
+
     this->action(action);
     if ( m_actions.contains(action->id()) )
         m_internalActions.insert(action->id());
@@ -103,6 +127,63 @@ bool ActionHandler::isInternalActionId(int id) const
 }
 
 void ActionHandler::action(Action *action)
+{
+    addAction(action);
+
+    COPYQ_LOG( QString("Executing: %1").arg(actionDescription(*action)) );
+    action->start();
+}
+
+void ActionHandler::terminateAction(int id)
+{
+    Action *action = m_actions.value(id);
+    if (action)
+        action->terminate();
+}
+
+void ActionHandler::scriptWorkerReady(
+        int workerActionId, int finishedJobActionId, int exitCode,
+        const QByteArray &output, const QByteArray &errorOutput)
+{
+    if ( !m_scriptWorkers.contains(workerActionId) )
+        return;
+
+    QPointer<Action> job;
+    {
+        auto &worker = m_scriptWorkers[workerActionId];
+        worker.ready = true;
+        job = worker.job;
+        worker.job.clear();
+    }
+
+    if ( finishedJobActionId != -1 && job && job->id() == finishedJobActionId ) {
+        job->appendOutput(output);
+        job->appendErrorOutput(errorOutput);
+        job->finishExternal(exitCode);
+    }
+
+    // Finishing the job could have started or removed other workers.
+    if ( !m_scriptWorkers.contains(workerActionId) )
+        return;
+
+    auto &worker = m_scriptWorkers[workerActionId];
+    if ( worker.jobCount >= AppConfig().option<Config::script_worker_max_jobs>() ) {
+        COPYQ_LOG( QString("Recycling script worker %1").arg(workerActionId) );
+        worker.retiring = true;
+        emit sendActionData(workerActionId, "ABORT");
+        return;
+    }
+
+    while ( !m_pendingScriptJobs.isEmpty() ) {
+        const auto pendingJob = m_pendingScriptJobs.takeFirst();
+        if (pendingJob) {
+            sendScriptJob(workerActionId, pendingJob);
+            break;
+        }
+    }
+}
+
+void ActionHandler::addAction(Action *action)
 {
     action->setParent(this);
 
@@ -114,16 +195,115 @@ void ActionHandler::action(Action *action)
     const int id = m_actionModel->actionAboutToStart(action);
     action->setId(id);
     m_actions.insert(id, action);
+}
 
-    COPYQ_LOG( QString("Executing: %1").arg(actionDescription(*action)) );
-    action->start();
+bool ActionHandler::runInScriptWorker(Action *action)
+{
+    int idleWorkerActionId = -1;
+    int startingWorkerCount = 0;
+    for (auto it = m_scriptWorkers.constBegin(); it != m_scriptWorkers.constEnd(); ++it) {
+        const auto &worker = it.value();
+        if (worker.retiring)
+            continue;
+
+        if (!worker.ready)
+            ++startingWorkerCount;
+        else if (!worker.job)
+            idleWorkerActionId = it.key();
+    }
+
+    // Long running scripts (e.g. menu filters) can keep workers busy,
+    // so don't wait for them and rather start new process.
+    if ( idleWorkerActionId == -1 && startingWorkerCount <= m_pendingScriptJobs.size() ) {
+        if ( m_scriptWorkers.size() >= AppConfig().option<Config::script_workers>() )
+            return false;
+        startScriptWorker();
+    }
+
+    addAction(action);
+    m_internalActions.insert(action->id());
+    connect( action, &Action::terminateRequested,
+             this, &ActionHandler::terminateScriptJob );
+
+    COPYQ_LOG( QString("Executing in script worker: %1").arg(actionDescription(*action)) );
+    action->startExternal();
+
+    if (idleWorkerActionId == -1)
+        m_pendingScriptJobs.append(action);
+    else
+        sendScriptJob(idleWorkerActionId, action);
+
+    return true;
 }
 
-void ActionHandler::terminateAction(int id)
+void ActionHandler::startScriptWorker()
 {
-    Action *action = m_actions.value(id);
-    if (action)
-        action->terminate();
+    auto worker = new Action();
+    worker->setCommand(QStringList() << "copyq" << scriptWorkerFunction);
+    addAction(worker);
+    m_internalActions.insert(worker->id());
+    m_scriptWorkers.insert(worker->id(), ScriptWorker());
+
+    COPYQ_LOG( QString("Starting script worker %1").arg(worker->id()) );
+    worker->start();
+}
+
+void ActionHandler::sendScriptJob(int workerActionId, Action *job)
+{
+    auto &worker = m_scriptWorkers[workerActionId];
+    worker.job = job;
+    ++worker.jobCount;
+
+    ScriptJob scriptJob;
+    scriptJob.actionId = job->id();
+    scriptJob.actionName = job->name();
+    scriptJob.arguments = job->command()[0][0].mid(1);
+    emit sendActionData(workerActionId, serializeScriptJob(scriptJob));
+}
+
+void ActionHandler::onScriptWorkerFinished(Action *worker)
+{
+    const auto scriptWorker = m_scriptWorkers.take(worker->id());
+    COPYQ_LOG( QString("Script worker %1 finished").arg(worker->id()) );
+
+    if (scriptWorker.job) {
+        const auto errorString = worker->actionFailed()
+                ? worker->errorString() : QString();
+        scriptWorker.job->finishExternal(worker->exitCode(), errorString);
+    }
+
+    // Run jobs waiting for workers which failed to start in new processes.
+    int startingWorkerCount = 0;
+    for (const auto &otherWorker : m_scriptWorkers) {
+        if (!otherWorker.ready && !otherWorker.retiring)
+            ++startingWorkerCount;
+    }
+
+    while ( m_pendingScriptJobs.size() > startingWorkerCount ) {
+        const auto job = m_pendingScriptJobs.takeLast();
+        if (job) {
+            COPYQ_LOG( QString("Executing: %1").arg(actionDescription(*job)) );
+            job->start();
+        }
+    }
+}
+
+void ActionHandler::terminateScriptJob(Action *job)
+{
+    if ( m_pendingScriptJobs.removeOne(job) ) {
+        job->finishExternal(CommandFinished);
+        return;
+    }
+
+    // Terminate the whole worker, job cannot be safely interrupted otherwise.
+    for (auto it = m_scriptWorkers.constBegin(); it != m_scriptWorkers.constEnd(); ++it) {
+        if (it.value().job == job) {
+            Action *worker = m_actions.value(it.key());
+            if (worker)
+                worker->terminate();
+            return;
+        }
+    }
 }
 
 void ActionHandler::closeAction(Action *action)
@@ -131,6 +311,9 @@ void ActionHandler::closeAction(Action *action)
     m_actions.remove(action->id());
     m_internalActions.remove(action->id());
 
+    if ( m_scriptWorkers.contains(action->id()) )
+        onScriptWorkerFinished(action);
+
     if ( action->actionFailed() ) {
         const auto msg = tr("Error: %1").arg(action->errorString());
         showActionErrors(action, msg, IconExclamationCircle);
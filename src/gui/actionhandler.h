@@ -20,7 +20,10 @@
 #ifndef ACTIONHANDLER_H
 #define ACTIONHANDLER_H
 
+#include <QHash>
+#include <QList>
 #include <QObject>
+#include <QPointer>
 #include <QSet>
 
 class Action;
@@ -42,6 +45,12 @@ public:
     QVariantMap actionData(int id) const;
     void setActionData(int id, const QVariantMap &data);
 
+    /**
+     * Execute internal action.
+     *
+     * Simple scripts ("copyq <function> ...") are passed to a script worker
+     * process if available (see scriptWorkerReady()).
+     */
     void internalAction(Action *action);
     bool isInternalActionId(int id) const;
 
@@ -50,7 +59,37 @@ public:
 
     void terminateAction(int id);
 
+    /**
+     * Called when script worker is ready for a job.
+     *
+     * Finishes previous job of the worker if @a finishedJobActionId is not -1.
+     */
+    void scriptWorkerReady(
+            int workerActionId, int finishedJobActionId, int exitCode,
+            const QByteArray &output, const QByteArray &errorOutput);
+
+signals:
+    /** Send data to a running client (jobs for script workers). */
+    void sendActionData(int actionId, const QByteArray &bytes);
+
 private:
+    struct ScriptWorker {
+        QPointer<Action> job;
+        int jobCount = 0;
+        bool ready = false;
+        /// Worker was asked to exit after running maximum number of jobs.
+        bool retiring = false;
+    };
+
+    void addAction(Action *action);
+
+    /// Return false if there is no script worker to run the action.
+    bool runInScriptWorker(Action *action);
+    void startScriptWorker();
+    void sendScriptJob(int workerActionId, Action *job);
+    void onScriptWorkerFinished(Action *worker);
+    void terminateScriptJob(Action *job);
+
     /** Delete finished action and its menu item. */
     void closeAction(Action *action);
 
@@ -61,6 +100,9 @@ private:
     QHash<int, Action*> m_actions;
     QSet<int> m_internalActions;
     int m_lastActionId = -1;
+
+    QHash<int, ScriptWorker> m_scriptWorkers;
+    QList<QPointer<Action>> m_pendingScriptJobs;
 };
 
 #endif // ACTIONHANDLER_H
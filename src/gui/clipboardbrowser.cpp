@@ -21,8 +21,10 @@
 
 #include "common/common.h"
 #include "common/contenttype.h"
+#include "common/fuzzymatcher.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
+#include "common/regexp.h"
 #include "common/temporaryfile.h"
 #include "common/textdata.h"
 #include "common/timer.h"
@@ -35,6 +37,7 @@
 #include "item/itemeditorwidget.h"
 #include "item/itemfactory.h"
 #include "item/itemstore.h"
+#include "item/serialize.h"
 #include "item/itemwidget.h"
 #include "item/persistentdisplayitem.h"
 
@@ -64,6 +67,12 @@ enum class MoveType {
     Relative
 };
 
+/// Number of top rows filtered immediately, other rows are filtered in background.
+const int rowsToFilterImmediately = 256;
+
+/// Number of recent filter results kept to refine search or to restore it.
+const int maxCachedFilterMatches = 8;
+
 /// Save drag'n'drop image data in temporary file (required by some applications).
 class TemporaryDragAndDropImage final : public QObject {
 public:
@@ -257,6 +266,7 @@ ClipboardBrowser::ClipboardBrowser(
     , m_maxItemCount(sharedData->maxItems)
     , m(this)
     , d(this, sharedData)
+    , m_journal(&m)
     , m_editor(nullptr)
     , m_sharedData(sharedData)
     , m_dragTargetRow(-1)
@@ -284,6 +294,21 @@ ClipboardBrowser::ClipboardBrowser(
     connect( &m_timerDragDropScroll, &QTimer::timeout,
              this, &ClipboardBrowser::dragDropScroll );
 
+    ItemFactory *itemFactory = m_sharedData->itemFactory;
+    m.setSearchTextFunction([itemFactory](const QVariantMap &data) {
+        return itemFactory->searchText(data);
+    }, itemFactory->searchTextFormats());
+    m_searchIndex.setModel(&m);
+    connect( &m_searchIndex, &ItemSearchIndex::syncedInBackground,
+             this, [this]() { m_searchIndexChanged = true; } );
+
+    connect( &m_itemMatcher, &ItemMatcher::matched,
+             this, &ClipboardBrowser::onItemsMatched );
+    connect( &m_itemMatcher, &ItemMatcher::scored,
+             this, &ClipboardBrowser::onItemsScored );
+    connect( &m_itemMatcher, &ItemMatcher::finished,
+             this, &ClipboardBrowser::onItemsMatchFinished );
+
     // ScrollPerItem doesn't work well with hidden items
     setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
 
@@ -303,7 +328,7 @@ ClipboardBrowser::~ClipboardBrowser()
     saveUnsavedItems();
 }
 
-bool ClipboardBrowser::moveToTop(uint itemHash)
+bool ClipboardBrowser::moveToTop(quint64 itemHash)
 {
     const int row = m.findItem(itemHash);
     if (row < 0)
@@ -313,6 +338,12 @@ bool ClipboardBrowser::moveToTop(uint itemHash)
     return true;
 }
 
+QModelIndex ClipboardBrowser::findItem(quint64 itemHash) const
+{
+    const int row = m.findItem(itemHash);
+    return row < 0 ? QModelIndex() : index(row);
+}
+
 void ClipboardBrowser::closeExternalEditor(QObject *editor, const QModelIndex &index)
 {
     editor->disconnect(this);
@@ -378,6 +409,12 @@ QVariantMap ClipboardBrowser::itemData(const QModelIndex &index) const
 bool ClipboardBrowser::hideFiltered(int row)
 {
     const bool hide = isFiltered(row);
+    setRowFiltered(row, hide);
+    return hide;
+}
+
+void ClipboardBrowser::setRowFiltered(int row, bool hide)
+{
     setRowHidden(row, hide);
 
     auto w = d.cacheOrNull(row);
@@ -387,10 +424,204 @@ bool ClipboardBrowser::hideFiltered(int row)
         else
             d.highlightMatches(w);
     }
+}
+
+bool ClipboardBrowser::hideFiltered(int row, const FilterMatches *previous)
+{
+    bool hide;
+
+    // Row not matching previous filter cannot match narrower filter.
+    if ( previous && (previous->re == d.searchExpression() || !previous->matches.testBit(row)) ) {
+        hide = row != m_filterRow && !previous->matches.testBit(row);
+        setRowFiltered(row, hide);
+    } else {
+        hide = hideFiltered(row);
+    }
+
+    if ( m_recordFilterMatches && !hide )
+        m_filterMatches.setBit(row);
 
     return hide;
 }
 
+const ClipboardBrowser::FilterMatches *ClipboardBrowser::findFilterMatches(const QRegularExpression &re) const
+{
+    for (const auto &filterMatches : m_filterMatchesCache) {
+        if (filterMatches.re == re)
+            return &filterMatches;
+    }
+
+    for (int i = m_filterMatchesCache.size() - 1; i >= 0; --i) {
+        const auto &filterMatches = m_filterMatchesCache[i];
+        if ( regExpNarrows(re, filterMatches.re) )
+            return &filterMatches;
+    }
+
+    return nullptr;
+}
+
+void ClipboardBrowser::finishFilterMatches()
+{
+    if (!m_recordFilterMatches)
+        return;
+
+    m_recordFilterMatches = false;
+
+    const auto re = d.searchExpression();
+    for (int i = 0; i < m_filterMatchesCache.size(); ++i) {
+        if (m_filterMatchesCache[i].re == re) {
+            m_filterMatchesCache.remove(i);
+            break;
+        }
+    }
+
+    if ( m_filterMatchesCache.size() >= maxCachedFilterMatches )
+        m_filterMatchesCache.removeFirst();
+
+    m_filterMatchesCache.append( FilterMatches{re, m_filterMatches} );
+}
+
+void ClipboardBrowser::invalidateFilterMatches()
+{
+    m_recordFilterMatches = false;
+    m_filterMatchesCache.clear();
+}
+
+void ClipboardBrowser::filterItemsInBackground(int firstRow, bool selectFirstMatch, const FilterMatches *previous)
+{
+    m_matchedRow = firstRow;
+    m_selectFirstMatch = selectFirstMatch;
+    m_pendingMatches.clear();
+
+    ItemDataSnapshot items = itemDataSnapshot(m, firstRow);
+
+    // Skip rows not matching previous filter.
+    if (previous) {
+        for (int i = 0; i < items.size(); ++i) {
+            if ( !previous->matches.testBit(firstRow + i) )
+                items[i] = QVariant();
+        }
+    }
+
+    const auto matcher = m_sharedData->itemFactory->dataMatcher( d.searchExpression() );
+    m_itemMatcher.start(items, firstRow, matcher);
+}
+
+void ClipboardBrowser::onItemsMatched(int firstRow, const QBitArray &matches)
+{
+    for (int i = 0; i < matches.size(); ++i) {
+        const int row = firstRow + i;
+        const bool hide = row != m_filterRow && !matches.testBit(i);
+        setRowFiltered(row, hide);
+        if ( m_recordFilterMatches && !hide )
+            m_filterMatches.setBit(row);
+    }
+
+    if (!m_selectFirstMatch)
+        return;
+
+    // Select the first match only after all rows above are matched.
+    m_pendingMatches.insert(firstRow, matches);
+    for ( auto it = m_pendingMatches.begin();
+          it != m_pendingMatches.end() && it.key() == m_matchedRow;
+          it = m_pendingMatches.erase(it) )
+    {
+        for (int i = 0; i < it.value().size(); ++i) {
+            if ( !isRowHidden(m_matchedRow + i) ) {
+                m_selectFirstMatch = false;
+                m_pendingMatches.clear();
+                setCurrent(m_matchedRow + i);
+                return;
+            }
+        }
+        m_matchedRow += it.value().size();
+    }
+}
+
+void ClipboardBrowser::onItemsScored(int firstRow, const QVector<int> &scores)
+{
+    const int lastRow = qMin( m_fuzzyScores.size(), firstRow + scores.size() );
+    for (int row = firstRow; row < lastRow; ++row) {
+        const int score = scores[row - firstRow];
+        m_fuzzyScores[row] = score;
+        setRowFiltered(row, score == 0);
+    }
+}
+
+void ClipboardBrowser::onItemsMatchFinished()
+{
+    if ( !m_fuzzyPattern.isEmpty() ) {
+        finishFuzzyRanking();
+        return;
+    }
+
+    finishFilterMatches();
+
+    if (m_selectFirstMatch) {
+        m_selectFirstMatch = false;
+        m_pendingMatches.clear();
+        setCurrent( length() );
+    }
+}
+
+void ClipboardBrowser::finishFuzzyRanking()
+{
+    QVector<int> rows;
+    for (int row = 0; row < m_fuzzyScores.size(); ++row) {
+        if (m_fuzzyScores[row] > 0)
+            rows.append(row);
+    }
+
+    // Rows with same score keep history order.
+    std::stable_sort( rows.begin(), rows.end(), [this](int lhs, int rhs) {
+        return m_fuzzyScores[lhs] > m_fuzzyScores[rhs];
+    } );
+    m_fuzzyRankedRows = rows;
+
+    if (m_selectFirstMatch) {
+        m_selectFirstMatch = false;
+        if ( !m_fuzzyRankedRows.isEmpty() )
+            setCurrent( m_fuzzyRankedRows.first() );
+    }
+}
+
+void ClipboardBrowser::clearFuzzyRanking()
+{
+    m_fuzzyPattern.clear();
+    m_fuzzyScores.clear();
+    m_fuzzyRankedRows.clear();
+}
+
+bool ClipboardBrowser::moveCurrentInRankedRows(int direction)
+{
+    if ( m_fuzzyRankedRows.isEmpty() )
+        return false;
+
+    const int i = m_fuzzyRankedRows.indexOf( currentIndex().row() );
+    const int j = i == -1 ? 0 : qBound(0, i + direction, m_fuzzyRankedRows.size() - 1);
+    setCurrent( m_fuzzyRankedRows[j] );
+    return true;
+}
+
+void ClipboardBrowser::restartFilterItemsInBackground()
+{
+    invalidateFilterMatches();
+
+    // Rank rows again without changing current item.
+    if ( !m_fuzzyPattern.isEmpty() ) {
+        m_selectFirstMatch = false;
+        m_fuzzyScores = QVector<int>( length() );
+        m_fuzzyRankedRows.clear();
+        m_itemMatcher.startScoring(
+            itemDataSnapshot(m), 0, m_fuzzyPattern,
+            m_sharedData->itemFactory->searchTextFunction() );
+        return;
+    }
+
+    if ( m_itemMatcher.isRunning() )
+        filterItemsInBackground(0, false, nullptr);
+}
+
 bool ClipboardBrowser::hideFiltered(const QModelIndex &index)
 {
     return hideFiltered(index.row());
@@ -548,12 +779,30 @@ void ClipboardBrowser::connectModelAndDelegate()
              &d, &ItemDelegate::rowsRemoved );
     connect( &m, &QAbstractItemModel::rowsAboutToBeMoved,
              &d, &ItemDelegate::rowsMoved );
+    connect( &m, &QAbstractItemModel::layoutAboutToBeChanged,
+             &d, &ItemDelegate::layoutAboutToBeChanged );
+    connect( &m, &QAbstractItemModel::layoutChanged,
+             &d, &ItemDelegate::layoutChanged );
     connect( &m, &QAbstractItemModel::dataChanged,
              &d, &ItemDelegate::dataChanged );
 
     connect( &m, &QAbstractItemModel::rowsInserted,
              this, &ClipboardBrowser::onRowsInserted);
 
+    // Rows matched in background would be outdated.
+    connect( &m, &QAbstractItemModel::rowsInserted,
+             this, &ClipboardBrowser::restartFilterItemsInBackground );
+    connect( &m, &QAbstractItemModel::rowsRemoved,
+             this, &ClipboardBrowser::restartFilterItemsInBackground );
+    connect( &m, &QAbstractItemModel::rowsMoved,
+             this, &ClipboardBrowser::restartFilterItemsInBackground );
+    connect( &m, &QAbstractItemModel::layoutChanged,
+             this, &ClipboardBrowser::restartFilterItemsInBackground );
+    connect( &m, &QAbstractItemModel::dataChanged,
+             this, &ClipboardBrowser::invalidateFilterMatches );
+    connect( &m, &QAbstractItemModel::modelReset,
+             this, &ClipboardBrowser::invalidateFilterMatches );
+
     // Item count change
     connect( &m, &QAbstractItemModel::rowsInserted,
              this, &ClipboardBrowser::onItemCountChanged );
@@ -567,6 +816,8 @@ void ClipboardBrowser::connectModelAndDelegate()
              this, [this]() { delayedSaveItems(m_sharedData->saveDelayMsOnItemRemoved); } );
     connect( &m, &QAbstractItemModel::rowsMoved,
              this, [this]() { delayedSaveItems(m_sharedData->saveDelayMsOnItemMoved); } );
+    connect( &m, &QAbstractItemModel::layoutChanged,
+             this, [this]() { delayedSaveItems(m_sharedData->saveDelayMsOnItemMoved); } );
     connect( &m, &QAbstractItemModel::dataChanged,
              this, [this]() { delayedSaveItems(m_sharedData->saveDelayMsOnItemModified); } );
 
@@ -1313,6 +1564,9 @@ void ClipboardBrowser::filterItems(const QRegularExpression &re)
         return;
 
     d.setSearch(re);
+    m_itemMatcher.cancel();
+    m_recordFilterMatches = false;
+    clearFuzzyRanking();
 
     // If search string is a number, highlight item in that row.
     bool filterByRowNumber = !m_sharedData->numberSearch;
@@ -1329,18 +1583,97 @@ void ClipboardBrowser::filterItems(const QRegularExpression &re)
 
         scrollTo(currentIndex(), PositionAtCenter);
     } else {
-        for ( ; row < length() && hideFiltered(row); ++row ) {}
+        const bool canMatch = re.isValid() && m_itemSaver && m_sharedData->itemFactory;
 
-        setCurrent(row);
+        // Reuse results of the same filter or a filter that matched more rows.
+        const FilterMatches *previous = canMatch ? findFilterMatches(re) : nullptr;
+        if ( previous && previous->matches.size() != length() )
+            previous = nullptr;
 
-        for ( ; row < length(); ++row )
-            hideFiltered(row);
+        m_recordFilterMatches = canMatch;
+        if (m_recordFilterMatches)
+            m_filterMatches = QBitArray( length() );
+
+        // Filter top rows immediately, others in background.
+        const bool filterInBackground = canMatch
+                && length() > rowsToFilterImmediately
+                && (!previous || previous->re != re);
+        const int lastRow = filterInBackground ? rowsToFilterImmediately : length();
+
+        for ( ; row < lastRow && hideFiltered(row, previous); ++row ) {}
+
+        const bool found = row < lastRow;
+        if (found || !filterInBackground)
+            setCurrent(row);
+
+        for ( ; row < lastRow; ++row )
+            hideFiltered(row, previous);
+
+        const bool selectRowNumber =
+            filterByRowNumber && m_filterRow >= 0 && m_filterRow < m.rowCount();
+
+        if (filterInBackground)
+            filterItemsInBackground(lastRow, !found && !selectRowNumber, previous);
+        else
+            finishFilterMatches();
 
-        if ( filterByRowNumber && m_filterRow >= 0 && m_filterRow < m.rowCount() )
+        if (selectRowNumber)
             setCurrent(m_filterRow);
     }
 }
 
+void ClipboardBrowser::filterItemsFuzzy(const QString &pattern)
+{
+    const FuzzyMatcher matcher(pattern);
+    const auto re = matcher.regularExpression();
+
+    if ( matcher.isEmpty() || isInternalEditorOpen() || !m_itemSaver || !m_sharedData->itemFactory ) {
+        filterItems(re);
+        return;
+    }
+
+    if ( d.searchExpression() == re && !m_fuzzyPattern.isEmpty() )
+        return;
+
+    // The regular expression is used to filter new items and to highlight matches.
+    d.setSearch(re);
+    m_itemMatcher.cancel();
+    m_recordFilterMatches = false;
+    m_pendingMatches.clear();
+    m_filterRow = -1;
+    m_fuzzyPattern = pattern;
+    m_fuzzyScores = QVector<int>( length() );
+    m_fuzzyRankedRows.clear();
+
+    // Score top rows immediately using cached search text, others in background.
+    const int lastRow = qMin( length(), rowsToFilterImmediately );
+    QVector<int> scores;
+    scores.reserve(lastRow);
+    for (int row = 0; row < lastRow; ++row) {
+        const auto text = m.index(row).data(contentType::foldedSearchText).toString();
+        scores.append( matcher.score(text, row) );
+    }
+    onItemsScored(0, scores);
+
+    // Select the best of top rows now and the best of all rows after ranking.
+    int bestRow = -1;
+    for (int row = 0; row < lastRow; ++row) {
+        if ( scores[row] > 0 && (bestRow == -1 || scores[row] > scores[bestRow]) )
+            bestRow = row;
+    }
+    if (bestRow != -1)
+        setCurrent(bestRow);
+    m_selectFirstMatch = true;
+
+    if (lastRow < length()) {
+        m_itemMatcher.startScoring(
+            itemDataSnapshot(m, lastRow), lastRow, m_fuzzyPattern,
+            m_sharedData->itemFactory->searchTextFunction() );
+    } else {
+        finishFuzzyRanking();
+    }
+}
+
 void ClipboardBrowser::moveToClipboard(const QModelIndex &ind)
 {
     if ( ind.isValid() )
@@ -1397,6 +1730,15 @@ void ClipboardBrowser::keyPressEvent(QKeyEvent *event)
     case Qt::Key_PageUp:
     case Qt::Key_Home:
     case Qt::Key_End: {
+        // Move through items matching fuzzy filter from the best one.
+        if ( (key == Qt::Key_Up || key == Qt::Key_Down)
+             && (mods & ~Qt::KeypadModifier) == Qt::NoModifier
+             && moveCurrentInRankedRows(key == Qt::Key_Down ? 1 : -1) )
+        {
+            event->accept();
+            break;
+        }
+
         const auto current = currentIndex();
         int row = current.row();
         const int h = viewport()->contentsRect().height();
@@ -1556,12 +1898,20 @@ void ClipboardBrowser::remove()
 
 void ClipboardBrowser::sortItems(const QModelIndexList &indexes)
 {
-    m.sortItems(indexes, &alphaSort);
+    m.sortItems(indexes, &alphaSort, isItemFixedFunction());
 }
 
 void ClipboardBrowser::reverseItems(const QModelIndexList &indexes)
 {
-    m.sortItems(indexes, &reverseSort);
+    m.sortItems(indexes, &reverseSort, isItemFixedFunction());
+}
+
+ClipboardModel::IsItemFixed ClipboardBrowser::isItemFixedFunction()
+{
+    // Items which plugins don't allow to move (e.g. pinned) keep their rows.
+    return [this](const QModelIndex &index) {
+        return m_itemSaver && !m_itemSaver->canMoveItems(QList<QModelIndex>() << index);
+    };
 }
 
 bool ClipboardBrowser::allocateSpaceForNewItems(int newItemCount)
@@ -1684,12 +2034,23 @@ bool ClipboardBrowser::loadItems()
     m_timerSave.stop();
 
     m.blockSignals(true);
-    m_itemSaver = ::loadItems(m_tabName, m, m_sharedData->itemFactory, m_maxItemCount);
+    m_itemSaver = ::loadItems(m_tabName, m, m_sharedData->itemFactory, m_maxItemCount, &m_journal);
     m.blockSignals(false);
 
     if ( !isLoaded() )
         return false;
 
+    // Changes applied from damaged journal are saved with all items and
+    // the journal is dropped (it's closed so nothing is appended to it).
+    if ( m_journal.needsFullSave() )
+        delayedSaveItems(0);
+
+    // Reuse saved texts, changed items are indexed in background and the
+    // index file is saved later.
+    if ( !::loadItemSearchIndex(m_tabName, &m_searchIndex) )
+        m_searchIndexChanged = true;
+    m_searchIndex.syncInBackground( m_sharedData->itemFactory->searchTextFunction() );
+
     d.rowsInserted(QModelIndex(), 0, m.rowCount());
     if ( hasFocus() )
         setCurrent(0);
@@ -1708,7 +2069,26 @@ bool ClipboardBrowser::saveItems()
     if (!m_storeItems)
         return true;
 
-    return ::saveItems(m_tabName, m, m_itemSaver);
+    bool appendedToJournal = false;
+    if ( !::saveItems(m_tabName, m, m_itemSaver, &m_journal, &appendedToJournal) )
+        return false;
+
+    // Rewriting whole search index would be as slow as saving all items.
+    if (appendedToJournal)
+        m_searchIndexChanged = true;
+    else
+        saveSearchIndex();
+
+    return true;
+}
+
+void ClipboardBrowser::saveSearchIndex()
+{
+    m_searchIndexChanged = false;
+
+    // Don't store plain text of items from tabs with custom storage (e.g. encrypted).
+    if ( m_itemSaver->canSaveItemsInBackground() )
+        ::saveItemSearchIndex(m_tabName, m_searchIndex);
 }
 
 void ClipboardBrowser::moveToClipboard()
@@ -1758,6 +2138,9 @@ void ClipboardBrowser::saveUnsavedItems()
 {
     if ( m_timerSave.isActive() )
         saveItems();
+
+    if ( m_searchIndexChanged && isLoaded() && m_storeItems && !m_tabName.isEmpty() )
+        saveSearchIndex();
 }
 
 const QString ClipboardBrowser::selectedText() const
@@ -1776,7 +2159,9 @@ bool ClipboardBrowser::setTabName(const QString &tabName)
     const QString oldTabName = m_tabName;
 
     m_tabName = tabName;
-    if ( saveItems() )
+
+    // Caller removes tab file with the old name, so wait for items to be saved.
+    if ( saveItems() && waitForSavedItems(m_tabName) )
         return true;
 
     m_tabName = oldTabName;
@@ -1825,7 +2210,8 @@ QWidget *ClipboardBrowser::currentItemPreview(QWidget *parent)
 
     const QModelIndex index = currentIndex();
     const auto data = itemData(index);
-    return d.createPreview(data, parent);
+    const auto itemHash = index.data(contentType::hash).toULongLong();
+    return d.createPreview(data, itemHash, parent);
 }
 
 void ClipboardBrowser::findNext()
@@ -26,10 +26,16 @@
 #include "gui/theme.h"
 #include "item/clipboardmodel.h"
 #include "item/itemdelegate.h"
+#include "item/itemjournal.h"
+#include "item/itemmatcher.h"
+#include "item/itemsearchindex.h"
 #include "item/itemwidget.h"
 
+#include <QBitArray>
 #include <QListView>
+#include <QMap>
 #include <QPointer>
+#include <QRegularExpression>
 #include <QTimer>
 #include <QVariantMap>
 #include <QVector>
@@ -61,7 +67,7 @@ class ClipboardBrowser final : public QListView
          *
          * @return true only if item exists
          */
-        bool moveToTop(uint itemHash);
+        bool moveToTop(quint64 itemHash);
 
         /** Sort selected items. */
         void sortItems(const QModelIndexList &indexes);
@@ -72,6 +78,9 @@ class ClipboardBrowser final : public QListView
         /** Index of item in given row. */
         QModelIndex index(int i) const { return m.index(i,0); }
 
+        /** Index of item with given @a hash (invalid if the item doesn't exist). */
+        QModelIndex findItem(quint64 itemHash) const;
+
         /** Returns concatenation of selected items. */
         const QString selectedText() const;
 
@@ -155,6 +164,15 @@ class ClipboardBrowser final : public QListView
         void moveToClipboard(const QModelIndexList &indexes);
         /** Show only items matching the regular expression. */
         void filterItems(const QRegularExpression &re);
+        /**
+         * Show only items matching fuzzy pattern (see FuzzyMatcher).
+         *
+         * Item with the best score becomes current and up/down keys move
+         * through matching items in ranked order.
+         *
+         * Top rows are scored immediately, others in background.
+         */
+        void filterItemsFuzzy(const QString &pattern);
         /** Open editor. */
         bool openEditor(const QByteArray &textData, bool changeClipboard = false);
         /** Open editor for an item. */
@@ -164,7 +182,7 @@ class ClipboardBrowser final : public QListView
         void setCurrent(int row, bool keepSelection = false, bool setCurrentOnly = false);
 
         /**
-         * Save items to configuration if needed.
+         * Save items and search index to configuration if needed.
          */
         void saveUnsavedItems();
 
@@ -205,6 +223,9 @@ class ClipboardBrowser final : public QListView
 
         bool isLoaded() const;
 
+        /** Return search index of items (updated on each change). */
+        const ItemSearchIndex &searchIndex() const { return m_searchIndex; }
+
         /**
          * Save items to configuration.
          * @see setID, loadItems
@@ -305,6 +326,9 @@ class ClipboardBrowser final : public QListView
 
         void onEditorInvalidate();
 
+        /** Return function to check if item can be moved by sorting. */
+        ClipboardModel::IsItemFixed isItemFixedFunction();
+
         void setClipboardFromEditor();
 
         /**
@@ -312,6 +336,14 @@ class ClipboardBrowser final : public QListView
          */
         void delayedSaveItems(int ms);
 
+        /**
+         * Save search index beside configuration file (see ItemSearchIndex).
+         *
+         * This is done only after saving all items or on unloading the tab,
+         * not after each change appended to journal.
+         */
+        void saveSearchIndex();
+
         /**
          * Update item and editor sizes.
          */
@@ -326,6 +358,55 @@ class ClipboardBrowser final : public QListView
         bool hideFiltered(int row);
         bool hideFiltered(const QModelIndex &index);
 
+        /// Hide or show row and its widget.
+        void setRowFiltered(int row, bool hide);
+
+        /// Matching rows of a filter.
+        struct FilterMatches {
+            QRegularExpression re;
+            QBitArray matches;
+        };
+
+        /**
+         * Same as hideFiltered() but reuses matches of the same or less
+         * restrictive filter (if not null).
+         */
+        bool hideFiltered(int row, const FilterMatches *previous);
+
+        /// Return matches of the same or less restrictive filter, or nullptr.
+        const FilterMatches *findFilterMatches(const QRegularExpression &re) const;
+
+        /// Cache matches of current filter after all rows are filtered.
+        void finishFilterMatches();
+
+        void invalidateFilterMatches();
+
+        /**
+         * Filter rows starting at given row in background.
+         *
+         * If @a selectFirstMatch is true, first matching row becomes current.
+         */
+        void filterItemsInBackground(int firstRow, bool selectFirstMatch, const FilterMatches *previous);
+        void onItemsMatched(int firstRow, const QBitArray &matches);
+        void onItemsScored(int firstRow, const QVector<int> &scores);
+        void onItemsMatchFinished();
+
+        /// Rank rows after all are scored by fuzzy filter.
+        void finishFuzzyRanking();
+
+        /// Stop ranking rows (filter is not fuzzy).
+        void clearFuzzyRanking();
+
+        /**
+         * Move current item to next or previous row ranked by fuzzy filter.
+         *
+         * @return false if rows are not ranked
+         */
+        bool moveCurrentInRankedRows(int direction);
+
+        /// Filter all rows again if rows change while filtering in background.
+        void restartFilterItemsInBackground();
+
         /**
          * Connects signals and starts external editor.
          */
@@ -387,6 +468,9 @@ class ClipboardBrowser final : public QListView
 
         ClipboardModel m;
         ItemDelegate d;
+        ItemJournal m_journal;
+        ItemSearchIndex m_searchIndex;
+        bool m_searchIndexChanged = false;
         QTimer m_timerSave;
         QTimer m_timerEmitItemCount;
         QTimer m_timerUpdateSizes;
@@ -406,6 +490,26 @@ class ClipboardBrowser final : public QListView
         QPoint m_dragStartPosition;
 
         int m_filterRow = -1;
+
+        ItemMatcher m_itemMatcher;
+        /// Rows in background filter before this row are matched already.
+        int m_matchedRow = 0;
+        bool m_selectFirstMatch = false;
+        /// Results of background filter after m_matchedRow (only if m_selectFirstMatch).
+        QMap<int, QBitArray> m_pendingMatches;
+
+        /// Pattern of fuzzy filter (empty if rows are not ranked).
+        QString m_fuzzyPattern;
+        /// Fuzzy filter scores of rows (zero if not matching or not scored yet).
+        QVector<int> m_fuzzyScores;
+        /// Rows matching fuzzy filter, the best first (empty until all rows are scored).
+        QVector<int> m_fuzzyRankedRows;
+
+        /// Recent filter results (the latest is last).
+        QVector<FilterMatches> m_filterMatchesCache;
+        /// Matches of current filter (if m_recordFilterMatches).
+        QBitArray m_filterMatches;
+        bool m_recordFilterMatches = false;
 };
 
 #endif // CLIPBOARDBROWSER_H
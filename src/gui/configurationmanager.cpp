@@ -324,9 +324,14 @@ void ConfigurationManager::initOptions()
 
     bind<Config::hide_main_window_in_task_bar>();
     bind<Config::max_process_manager_rows>();
+    bind<Config::script_workers>();
+    bind<Config::script_worker_max_jobs>();
+    bind<Config::menu_filter_jobs>();
+    bind<Config::menu_filter_cache_ms>();
     bind<Config::show_advanced_command_settings>();
     bind<Config::text_tab_width>();
 
+    bind<Config::item_blob_min_size>();
     bind<Config::save_delay_ms_on_item_added>();
     bind<Config::save_delay_ms_on_item_modified>();
     bind<Config::save_delay_ms_on_item_removed>();
@@ -337,6 +342,8 @@ void ConfigurationManager::initOptions()
 
     bind<Config::filter_regular_expression>();
     bind<Config::filter_case_insensitive>();
+    bind<Config::filter_all_tabs>();
+    bind<Config::filter_fuzzy>();
 
     bind<Config::native_menu_bar>();
 }
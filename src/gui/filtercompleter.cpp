@@ -19,11 +19,14 @@
 
 #include "filtercompleter.h"
 
+#include "common/fuzzymatcher.h"
+
 #include <QAbstractListModel>
 #include <QApplication>
 #include <QAction>
 #include <QLineEdit>
 #include <QMoveEvent>
+#include <QVector>
 
 namespace {
 
@@ -39,13 +42,15 @@ public:
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const override
     {
-        return parent.isValid() ? 0 : m_items.size();
+        if ( parent.isValid() )
+            return 0;
+        return m_ranked ? m_rankedRows.size() : m_items.size();
     }
 
     QVariant data(const QModelIndex &index, int role) const override
     {
         if (index.isValid() && (role == Qt::EditRole || role == Qt::DisplayRole))
-            return m_items[index.row()];
+            return m_items[ m_ranked ? m_rankedRows[index.row()] : index.row() ];
 
         return QVariant();
     }
@@ -53,6 +58,7 @@ public:
     bool setData(const QModelIndex &index, const QVariant &value, int role) override
     {
         if (!index.isValid() && role == Qt::EditRole) {
+            setFuzzyPattern(QString());
             const QString text = value.toString();
             removeAll(text);
             crop(maxCompletionItems - 1);
@@ -64,6 +70,8 @@ public:
 
     bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override
     {
+        setFuzzyPattern(QString());
+
         const auto end = row + count;
         if ( parent.isValid() || row < 0 || end > rowCount() )
             return false;
@@ -75,6 +83,27 @@ public:
         return true;
     }
 
+    const QStringList &items() const { return m_items; }
+
+    /// Show only items matching non-empty pattern, the best match first.
+    void setFuzzyPattern(const QString &pattern)
+    {
+        if ( pattern.isEmpty() && !m_ranked )
+            return;
+
+        beginResetModel();
+        m_ranked = !pattern.isEmpty();
+        m_rankedRows.clear();
+        if (m_ranked) {
+            QVector<QString> texts;
+            texts.reserve( m_items.size() );
+            for (const auto &item : m_items)
+                texts.append( item.toCaseFolded() );
+            m_rankedRows = FuzzyMatcher(pattern).rank(texts);
+        }
+        endResetModel();
+    }
+
 private:
     void prepend(const QString &text)
     {
@@ -101,8 +130,15 @@ private:
     }
 
     QStringList m_items;
+    QVector<int> m_rankedRows;
+    bool m_ranked = false;
 };
 
+CompletionModel *completionModel(const QCompleter *completer)
+{
+    return static_cast<CompletionModel*>( completer->model() );
+}
+
 } // namespace
 
 void FilterCompleter::installCompleter(QLineEdit *lineEdit)
@@ -118,14 +154,7 @@ void FilterCompleter::removeCompleter(QLineEdit *lineEdit)
 
 QStringList FilterCompleter::history() const
 {
-    QStringList history;
-
-    for (int i = 0; i < model()->rowCount(); ++i) {
-        const QModelIndex index = model()->index(i, 0);
-        history.append( index.data(Qt::EditRole).toString() );
-    }
-
-    return history;
+    return completionModel(this)->items();
 }
 
 void FilterCompleter::setHistory(const QStringList &history)
@@ -135,14 +164,26 @@ void FilterCompleter::setHistory(const QStringList &history)
         prependItem(history[i]);
 }
 
+void FilterCompleter::setFuzzy(bool fuzzy)
+{
+    m_fuzzy = fuzzy;
+    completionModel(this)->setFuzzyPattern(QString());
+    setUnfiltered(false);
+}
+
 void FilterCompleter::onTextEdited(const QString &text)
 {
     m_lastText = text;
-    setUnfiltered(false);
+
+    // Completion model contains only ranked matches in fuzzy mode.
+    const bool rank = m_fuzzy && !text.isEmpty();
+    completionModel(this)->setFuzzyPattern(rank ? text : QString());
+    setUnfiltered(rank);
 }
 
 void FilterCompleter::onEditingFinished()
 {
+    completionModel(this)->setFuzzyPattern(QString());
     prependItem(m_lastText);
     m_lastText.clear();
 
@@ -152,6 +193,7 @@ void FilterCompleter::onEditingFinished()
 void FilterCompleter::onComplete()
 {
     if (m_lineEdit->text().isEmpty()) {
+        completionModel(this)->setFuzzyPattern(QString());
         setUnfiltered(true);
         const QModelIndex firstIndex = model()->index(0, 0);
         const QString text = model()->data(firstIndex, Qt::EditRole).toString();
@@ -29,6 +29,7 @@ class FilterCompleter final : public QCompleter
 {
     Q_OBJECT
     Q_PROPERTY(QStringList history READ history WRITE setHistory)
+    Q_PROPERTY(bool fuzzy READ isFuzzy WRITE setFuzzy)
 public:
     static void installCompleter(QLineEdit *lineEdit);
     static void removeCompleter(QLineEdit *lineEdit);
@@ -36,6 +37,10 @@ public:
     QStringList history() const;
     void setHistory(const QStringList &history);
 
+    bool isFuzzy() const { return m_fuzzy; }
+    /// Show completions matching text (see FuzzyMatcher) ranked by score.
+    void setFuzzy(bool fuzzy);
+
 private:
     void onTextEdited(const QString &text);
     void onEditingFinished();
@@ -47,6 +52,7 @@ private:
 
     QLineEdit *m_lineEdit;
     QString m_lastText;
+    bool m_fuzzy = false;
 };
 
 #endif // FILTERCOMPLETER_H
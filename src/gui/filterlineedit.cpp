@@ -31,6 +31,7 @@
 
 #include "common/appconfig.h"
 #include "common/config.h"
+#include "common/fuzzymatcher.h"
 #include "gui/iconfactory.h"
 #include "gui/icons.h"
 #include "gui/filtercompleter.h"
@@ -120,10 +121,19 @@ FilterLineEdit::FilterLineEdit(QWidget *parent)
 
     m_actionCaseInsensitive = menu->addAction(tr("Case Insensitive"));
     m_actionCaseInsensitive->setCheckable(true);
+
+    m_actionAllTabs = menu->addAction(tr("Search All Tabs"));
+    m_actionAllTabs->setCheckable(true);
+
+    m_actionFuzzy = menu->addAction(tr("Fuzzy Search"));
+    m_actionFuzzy->setCheckable(true);
 }
 
 QRegularExpression FilterLineEdit::filter() const
 {
+    if ( m_actionFuzzy->isChecked() )
+        return FuzzyMatcher( text() ).regularExpression();
+
     static const QRegularExpression reWhiteSpace("\\s+");
 
     const auto sensitivity =
@@ -145,6 +155,16 @@ QRegularExpression FilterLineEdit::filter() const
     return QRegularExpression(pattern, sensitivity);
 }
 
+bool FilterLineEdit::searchAllTabs() const
+{
+    return m_actionAllTabs->isChecked();
+}
+
+bool FilterLineEdit::fuzzySearch() const
+{
+    return m_actionFuzzy->isChecked();
+}
+
 void FilterLineEdit::loadSettings()
 {
     AppConfig appConfig;
@@ -155,6 +175,9 @@ void FilterLineEdit::loadSettings()
     const bool filterCaseSensitive = appConfig.option<Config::filter_case_insensitive>();
     m_actionCaseInsensitive->setChecked(filterCaseSensitive);
 
+    m_actionAllTabs->setChecked( appConfig.option<Config::filter_all_tabs>() );
+    m_actionFuzzy->setChecked( appConfig.option<Config::filter_fuzzy>() );
+
     // KDE has custom icons for this. Notice that icon namings are counter intuitive.
     // If these icons are not available we use the freedesktop standard name before
     // falling back to a bundled resource.
@@ -172,6 +195,7 @@ void FilterLineEdit::loadSettings()
             restoreOldFilterHistory();
             completer()->setProperty( "history", FilterHistory().history() );
         }
+        completer()->setProperty( "fuzzy", m_actionFuzzy->isChecked() );
     } else {
         FilterCompleter::removeCompleter(this);
         FilterHistory().setHistory(QStringList());
@@ -228,6 +252,11 @@ void FilterLineEdit::onMenuAction()
     AppConfig appConfig;
     appConfig.setOption("filter_regular_expression", m_actionRe->isChecked());
     appConfig.setOption("filter_case_insensitive", m_actionCaseInsensitive->isChecked());
+    appConfig.setOption("filter_all_tabs", m_actionAllTabs->isChecked());
+    appConfig.setOption("filter_fuzzy", m_actionFuzzy->isChecked());
+
+    if ( completer() )
+        completer()->setProperty( "fuzzy", m_actionFuzzy->isChecked() );
 
     const QRegularExpression re = filter();
     if ( re.isValid() && !re.pattern().isEmpty() )
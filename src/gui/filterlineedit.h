@@ -46,6 +46,12 @@ public:
 
     void loadSettings();
 
+    /// Return true if items in all tabs should be searched.
+    bool searchAllTabs() const;
+
+    /// Return true if items should be ranked by fuzzy matching (see FuzzyMatcher).
+    bool fuzzySearch() const;
+
 signals:
     void filterChanged(const QRegularExpression &);
 
@@ -64,6 +70,8 @@ private:
     QTimer *m_timerSearch;
     QAction *m_actionRe;
     QAction *m_actionCaseInsensitive;
+    QAction *m_actionAllTabs;
+    QAction *m_actionFuzzy;
 };
 
 } // namespace Utils
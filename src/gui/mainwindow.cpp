@@ -29,8 +29,10 @@
 #include "common/config.h"
 #include "common/contenttype.h"
 #include "common/display.h"
+#include "common/fuzzymatcher.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
+#include "common/regexp.h"
 #include "common/shortcuts.h"
 #include "common/tabs.h"
 #include "common/textdata.h"
@@ -61,6 +63,8 @@
 #include "gui/traymenu.h"
 #include "gui/windowgeometryguard.h"
 #include "item/itemfactory.h"
+#include "item/itemsearchindex.h"
+#include "item/itemstore.h"
 #include "item/serialize.h"
 #include "platform/platformclipboard.h"
 #include "platform/platformnativeinterface.h"
@@ -82,6 +86,7 @@
 #include <QMimeData>
 #include <QModelIndex>
 #include <QPushButton>
+#include <QRegularExpression>
 #include <QTemporaryFile>
 #include <QTimer>
 #include <QToolBar>
@@ -102,8 +107,16 @@ const QIcon iconTabNew() { return getIconFromResources("tab_new"); }
 const QIcon iconTabRemove() { return getIconFromResources("tab_remove"); }
 const QIcon iconTabRename() { return getIconFromResources("tab_rename"); }
 
+/// Maximum number of items sent at once to display command script.
+const int maxDisplayItemBatchSize = 64;
+/// Display data cache is cleared if it grows over the limit.
+const int maxDisplayDataCacheSize = 10000;
+
 const char propertyWidgetSizeGuarded[] = "CopyQ_widget_size_guarded";
 
+/// Hash of item found in other tab using search index (see MainWindow::addSearchResultMenuItems()).
+const char mimeSearchResultHash[] = COPYQ_MIME_PREFIX "search-result-hash";
+
 const char propertyActionFilterCommandFailed[] = "CopyQ_action_filter_command_failed";
 
 /// Omit size changes of a widget.
@@ -564,8 +577,14 @@ MainWindow::MainWindow(const ClipboardBrowserSharedPtr &sharedData, QWidget *par
     initSingleShotTimer( &m_timerTrayAvailable, 1000, this, [this]() { setTrayEnabled(); } );
     initSingleShotTimer( &m_timerSaveTabPositions, 1000, this, &MainWindow::doSaveTabPositions );
     initSingleShotTimer( &m_timerRaiseLastWindowAfterMenuClosed, 50, this, &MainWindow::raiseLastWindowAfterMenuClosed);
+    initSingleShotTimer( &m_timerApplyCachedDisplayData, 0, this, &MainWindow::applyCachedDisplayData );
     enableHideWindowOnUnfocus();
 
+    connect( &m_tabMatchCounter, &ItemMatcher::counted,
+             this, &MainWindow::onTabMatchCounted );
+    connect( &m_tabMatchCounter, &ItemMatcher::finished,
+             this, &MainWindow::onTabMatchCountFinished );
+
     m_trayMenu->setObjectName("TrayMenu");
     m_menu->setObjectName("Menu");
 
@@ -1181,6 +1200,13 @@ void MainWindow::onItemWidgetCreated(const PersistentDisplayItem &item)
     if ( m_displayCommands.isEmpty() )
         return;
 
+    // Display data is applied later since the item widget is still being created.
+    if ( item.itemHash() != 0 && m_displayDataCache.contains(displayDataKey(item)) ) {
+        m_cachedDisplayItems.append(item);
+        m_timerApplyCachedDisplayData.start();
+        return;
+    }
+
     m_displayItemList.append(item);
     runDisplayCommands();
 }
@@ -1213,20 +1239,54 @@ void MainWindow::onSearchShowRequest(const QString &text)
     ui->searchBar->end(false);
 }
 
+MainWindow::DisplayDataKey MainWindow::displayDataKey(const PersistentDisplayItem &item) const
+{
+    // Display commands get current tab name with item data.
+    const auto tabName = item.data().value(mimeCurrentTab).toString();
+    return DisplayDataKey{item.itemHash(), tabName, m_displayCommandsVersion};
+}
+
 void MainWindow::runDisplayCommands()
 {
     if ( m_displayItemList.isEmpty() )
         return;
 
     if ( !isInternalActionId(m_displayActionId) ) {
-        m_currentDisplayItem = m_displayItemList.takeFirst();
-        const auto action = runScript("runDisplayCommands()", m_currentDisplayItem.data());
+        // Previous display script could have been terminated while processing items.
+        requeueCurrentDisplayItems(0);
+        const auto action = runScript("runDisplayCommands()");
         m_displayActionId = action->id();
     }
 
     emit sendActionData(m_displayActionId, QByteArray());
 }
 
+void MainWindow::applyCachedDisplayData()
+{
+    const auto items = m_cachedDisplayItems;
+    m_cachedDisplayItems.clear();
+
+    for (auto item : items) {
+        const auto it = m_displayDataCache.constFind( displayDataKey(item) );
+        if ( it == m_displayDataCache.constEnd() )
+            m_displayItemList.append(item);
+        else
+            item.setData(it.value());
+    }
+
+    runDisplayCommands();
+}
+
+void MainWindow::requeueCurrentDisplayItems(int from)
+{
+    for (int i = m_currentDisplayItems.size() - 1; i >= from; --i) {
+        auto item = m_currentDisplayItems[i];
+        if ( item.isValid() )
+            m_displayItemList.prepend(item);
+    }
+    m_currentDisplayItems.clear();
+}
+
 void MainWindow::clearHiddenDisplayData()
 {
     for (int i = m_displayItemList.size() - 1; i >= 0; --i) {
@@ -1312,6 +1372,63 @@ ClipboardBrowserPlaceholder *MainWindow::getPlaceholder() const
     return qobject_cast<ClipboardBrowserPlaceholder*>( ui->tabWidget->currentWidget() );
 }
 
+const ItemSearchIndex *MainWindow::searchIndex(int tabIndex)
+{
+    ClipboardBrowserPlaceholder *placeholder = getPlaceholder(tabIndex);
+    if (!placeholder)
+        return nullptr;
+
+    const ClipboardBrowser *c = placeholder->browser();
+    if (c)
+        return &c->searchIndex();
+
+    const QString tabName = placeholder->tabName();
+    auto &index = m_searchIndexes[tabName];
+    if (!index)
+        index = std::make_shared<ItemSearchIndex>();
+
+    if ( !loadItemSearchIndex(tabName, index.get()) ) {
+        m_searchIndexes.remove(tabName);
+        return nullptr;
+    }
+
+    return index.get();
+}
+
+void MainWindow::updateTabMatchCounts(const QRegularExpression &re)
+{
+    m_tabMatchCounter.cancel();
+    m_tabMatchCountTabs.clear();
+    m_tabMatchCounts.clear();
+
+    QVector<ItemSearchIndex::Data> indexes;
+    if ( !re.pattern().isEmpty() && ui->searchBar->searchAllTabs() ) {
+        for ( int i = 0; i < ui->tabWidget->count(); ++i ) {
+            const ItemSearchIndex *index = searchIndex(i);
+            if (index) {
+                m_tabMatchCountTabs.append( ui->tabWidget->tabName(i) );
+                indexes.append( index->data() );
+            }
+        }
+    }
+
+    // Previous counts are shown until all tabs are searched.
+    if ( indexes.isEmpty() )
+        ui->tabWidget->setTabMatchCounts(m_tabMatchCounts);
+    else
+        m_tabMatchCounter.startCounting(indexes, re);
+}
+
+void MainWindow::onTabMatchCounted(int index, int count)
+{
+    m_tabMatchCounts[ m_tabMatchCountTabs.value(index) ] = count;
+}
+
+void MainWindow::onTabMatchCountFinished()
+{
+    ui->tabWidget->setTabMatchCounts(m_tabMatchCounts);
+}
+
 void MainWindow::delayedUpdateForeignFocusWindows()
 {
     if ( isActiveWindow() || m_trayMenu->isActiveWindow() || m_menu->isActiveWindow() )
@@ -1726,21 +1843,88 @@ void MainWindow::addMenuItems(TrayMenu *menu, ClipboardBrowserPlaceholder *place
         return;
 
     int itemCount = 0;
-    for ( int i = 0; i < c->length() && itemCount < maxItemCount; ++i ) {
-        const QModelIndex index = c->model()->index(i, 0);
-        if ( !searchText.isEmpty() ) {
-            const QString itemText = index.data(contentType::text).toString().toLower();
-            if ( !itemText.contains(searchText.toLower()) )
+    QRegularExpression re;
+
+    if ( !searchText.isEmpty() && ui->searchBar->fuzzySearch() ) {
+        const FuzzyMatcher fuzzyMatcher(searchText);
+        re = fuzzyMatcher.regularExpression();
+
+        QVector<QString> texts;
+        texts.reserve( c->length() );
+        for ( int i = 0; i < c->length(); ++i ) {
+            const QModelIndex index = c->model()->index(i, 0);
+            texts.append( index.data(contentType::foldedSearchText).toString() );
+        }
+
+        for ( const int row : fuzzyMatcher.rank(texts, maxItemCount) ) {
+            const QModelIndex index = c->model()->index(row, 0);
+            const QVariantMap data = index.data(contentType::data).toMap();
+            menu->addClipboardItemAction(data, m_options.trayImages);
+            ++itemCount;
+        }
+    } else {
+        re = QRegularExpression(
+                QRegularExpression::escape(searchText), QRegularExpression::CaseInsensitiveOption);
+        const LiteralMatcher textMatcher(re);
+
+        for ( int i = 0; i < c->length() && itemCount < maxItemCount; ++i ) {
+            const QModelIndex index = c->model()->index(i, 0);
+            if ( !searchText.isEmpty() && !textMatcher.matches(index.data(contentType::textData).toByteArray()) )
                 continue;
+            const QVariantMap data = index.data(contentType::data).toMap();
+            menu->addClipboardItemAction(data, m_options.trayImages);
+            ++itemCount;
+        }
+    }
+
+    if ( !searchText.isEmpty() && ui->searchBar->searchAllTabs() )
+        addSearchResultMenuItems(menu, placeholder, maxItemCount, &itemCount, re);
+}
+
+void MainWindow::addSearchResultMenuItems(
+        TrayMenu *menu, ClipboardBrowserPlaceholder *placeholder, int maxItemCount, int *itemCount,
+        const QRegularExpression &re)
+{
+    for ( int i = 0; i < ui->tabWidget->count() && *itemCount < maxItemCount; ++i ) {
+        if ( getPlaceholder(i) == placeholder )
+            continue;
+
+        const ItemSearchIndex *index = searchIndex(i);
+        if (!index)
+            continue;
+
+        const QString tabName = ui->tabWidget->tabName(i);
+        for ( const int row : index->search(re) ) {
+            if (*itemCount >= maxItemCount)
+                break;
+
+            // Only searchable text is available, item data are loaded from the tab on activation.
+            const ItemSearchIndex::Entry entry = index->entry(row);
+            QVariantMap data = createDataMap(mimeText, entry.text);
+            data.insert( mimeCurrentTab, tabName.toUtf8() );
+            data.insert( mimeSearchResultHash, QByteArray::number(entry.hash) );
+            menu->addClipboardItemAction(data, m_options.trayImages);
+            ++*itemCount;
         }
-        const QVariantMap data = index.data(contentType::data).toMap();
-        menu->addClipboardItemAction(data, m_options.trayImages);
-        ++itemCount;
     }
 }
 
-void MainWindow::activateMenuItem(ClipboardBrowserPlaceholder *placeholder, const QVariantMap &data, bool omitPaste)
+void MainWindow::activateMenuItem(ClipboardBrowserPlaceholder *placeholder, const QVariantMap &menuItemData, bool omitPaste)
 {
+    QVariantMap data = menuItemData;
+
+    // Load item found in other tab.
+    if ( data.contains(mimeSearchResultHash) ) {
+        const quint64 itemHash = data.value(mimeSearchResultHash).toULongLong();
+        placeholder = getPlaceholder( getTextData(data, mimeCurrentTab) );
+        data = createDataMap( mimeText, data.value(mimeText) );
+
+        const ClipboardBrowser *c = placeholder ? placeholder->createBrowser() : nullptr;
+        const QModelIndex index = c ? c->findItem(itemHash) : QModelIndex();
+        if ( index.isValid() )
+            data = index.data(contentType::data).toMap();
+    }
+
     if ( m_sharedData->moveItemOnReturnKey ) {
         const auto itemHash = ::hash(data);
         if (placeholder) {
@@ -2178,6 +2362,8 @@ void MainWindow::updateEnabledCommands()
 
 void MainWindow::updateCommands(QVector<Command> allCommands, bool forceSave)
 {
+    const auto oldScriptCommands = m_scriptCommands;
+
     m_automaticCommands.clear();
     m_menuCommands.clear();
     m_scriptCommands.clear();
@@ -2214,8 +2400,20 @@ void MainWindow::updateCommands(QVector<Command> allCommands, bool forceSave)
             m_scriptCommands.append(command);
     }
 
+    m_automaticCommandMatcher = CommandMatcher(m_automaticCommands);
+
+    // Clients cache script commands until version changes.
+    if (m_scriptCommands != oldScriptCommands)
+        ++m_scriptCommandsVersion;
+
     if (m_displayCommands != displayCommands) {
         m_displayItemList.clear();
+        m_currentDisplayItems.clear();
+        m_cachedDisplayItems.clear();
+        m_displayDataCache.clear();
+        ++m_displayCommandsVersion;
+        // Results of the running display script would be cached with new version.
+        terminateAction(&m_displayActionId);
         m_displayCommands = displayCommands;
         reloadBrowsers();
     }
@@ -2802,7 +3000,7 @@ void MainWindow::tabChanged(int current, int)
         // update item menu (necessary for keyboard shortcuts to work)
         auto c = browserOrNull();
         if (c) {
-            c->filterItems( browseMode() ? QRegularExpression() : ui->searchBar->filter() );
+            filterItems(c);
 
             if ( current >= 0 ) {
                 if( !c->currentIndex().isValid() && isVisible() ) {
@@ -2935,6 +3133,14 @@ void MainWindow::setActionData(int id, const QVariantMap &data)
     m_sharedData->actions->setActionData(id, data);
 }
 
+void MainWindow::scriptWorkerReady(
+        int workerActionId, int finishedJobActionId, int exitCode,
+        const QByteArray &output, const QByteArray &errorOutput)
+{
+    m_sharedData->actions->scriptWorkerReady(
+                workerActionId, finishedJobActionId, exitCode, output, errorOutput);
+}
+
 void MainWindow::setCommands(const QVector<Command> &commands)
 {
     if ( !maybeCloseCommandDialog() )
@@ -3031,21 +3237,56 @@ bool MainWindow::setMenuItemEnabled(int actionId, int currentRun, int menuItemMa
     return true;
 }
 
-QVariantMap MainWindow::setDisplayData(int actionId, const QVariantMap &data)
+QVector<QVariantMap> MainWindow::setDisplayData(int actionId, const QVector<QVariantMap> &dataList)
 {
     if (m_displayActionId != actionId)
-        return QVariantMap();
+        return QVector<QVariantMap>();
+
+    for ( int i = 0; i < dataList.size() && i < m_currentDisplayItems.size(); ++i ) {
+        auto &item = m_currentDisplayItems[i];
+        const auto &data = dataList[i];
+        if ( data.isEmpty() )
+            continue;
+
+        if (item.itemHash() != 0) {
+            if ( m_displayDataCache.size() >= maxDisplayDataCacheSize )
+                m_displayDataCache.clear();
+            m_displayDataCache.insert( displayDataKey(item), data );
+        }
+
+        item.setData(data);
+    }
 
-    m_currentDisplayItem.setData(data);
+    // Display script was interrupted before processing all items.
+    requeueCurrentDisplayItems( dataList.size() );
 
     clearHiddenDisplayData();
 
     if ( m_displayItemList.isEmpty() )
-        return QVariantMap();
+        return QVector<QVariantMap>();
+
+    QVector<QVariantMap> nextDataList;
+    while ( !m_displayItemList.isEmpty() && nextDataList.size() < maxDisplayItemBatchSize ) {
+        const auto item = m_displayItemList.takeFirst();
+
+        // Items with same data could have been processed in previous batch.
+        const auto it = item.itemHash() == 0
+                ? m_displayDataCache.constEnd()
+                : m_displayDataCache.constFind( displayDataKey(item) );
+        if ( it != m_displayDataCache.constEnd() ) {
+            m_cachedDisplayItems.append(item);
+            m_timerApplyCachedDisplayData.start();
+            continue;
+        }
+
+        m_currentDisplayItems.append(item);
+        nextDataList.append( item.data() );
+    }
+
+    if ( !nextDataList.isEmpty() )
+        m_sharedData->actions->setActionData(actionId, nextDataList.first());
 
-    m_currentDisplayItem = m_displayItemList.takeFirst();
-    m_sharedData->actions->setActionData(actionId, m_currentDisplayItem.data());
-    return m_currentDisplayItem.data();
+    return nextDataList;
 }
 
 void MainWindow::nextTab()
@@ -3209,7 +3450,8 @@ void MainWindow::onFilterChanged(const QRegularExpression &re)
 
     auto c = browser();
     if (c)
-        c->filterItems(re);
+        filterItems(c);
+    updateTabMatchCounts(re);
     updateItemPreviewAfterMs(2 * itemPreviewUpdateIntervalMsec);
 }
 
@@ -3287,7 +3529,7 @@ void MainWindow::enterSearchMode()
         auto c = browserOrNull();
         if (c) {
             const int currentRow = c->currentIndex().row();
-            c->filterItems( ui->searchBar->filter() );
+            filterItems(c);
             c->setCurrent(currentRow);
         }
     }
@@ -3307,6 +3549,16 @@ void MainWindow::enterSearchMode(const QString &txt)
 
     auto c = browser();
     if (c)
+        filterItems(c);
+}
+
+void MainWindow::filterItems(ClipboardBrowser *c)
+{
+    if ( browseMode() )
+        c->filterItems(QRegularExpression());
+    else if ( ui->searchBar->fuzzySearch() )
+        c->filterItemsFuzzy( ui->searchBar->text() );
+    else
         c->filterItems( ui->searchBar->filter() );
 }
 
@@ -3603,6 +3855,10 @@ void MainWindow::saveTabs()
         if (c)
             c->saveUnsavedItems();
     }
+
+    // Tabs are saved in parallel in background.
+    waitForSavedItems();
+
     ui->tabWidget->saveTabInfo();
 }
 
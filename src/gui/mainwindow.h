@@ -22,19 +22,24 @@
 
 #include "common/clipboardmode.h"
 #include "common/command.h"
+#include "common/commandmatcher.h"
 #include "gui/clipboardbrowsershared.h"
 #include "gui/menuitems.h"
+#include "item/itemmatcher.h"
 #include "item/persistentdisplayitem.h"
 
 #include "platform/platformnativeinterface.h"
 
 #include <QMainWindow>
+#include <QHash>
 #include <QModelIndex>
 #include <QPointer>
 #include <QSystemTrayIcon>
 #include <QTimer>
 #include <QVector>
 
+#include <memory>
+
 class Action;
 class ActionDialog;
 class AppConfig;
@@ -43,6 +48,7 @@ class ClipboardBrowserPlaceholder;
 class CommandAction;
 class CommandDialog;
 class ConfigurationManager;
+class ItemSearchIndex;
 class Notification;
 class QAction;
 class QMimeData;
@@ -260,6 +266,10 @@ public:
     QVariantMap actionData(int id) const;
     void setActionData(int id, const QVariantMap &data);
 
+    void scriptWorkerReady(
+            int workerActionId, int finishedJobActionId, int exitCode,
+            const QByteArray &output, const QByteArray &errorOutput);
+
     void setCommands(const QVector<Command> &commands);
 
     void setSessionIconColor(QColor color);
@@ -278,11 +288,20 @@ public:
 
     bool setMenuItemEnabled(int actionId, int currentRun, int menuItemMatchCommandIndex, const QVariantMap &menuItem);
 
-    QVariantMap setDisplayData(int actionId, const QVariantMap &data);
+    /**
+     * Sets display data for items sent to display command script
+     * and returns data for next items to display.
+     */
+    QVector<QVariantMap> setDisplayData(int actionId, const QVector<QVariantMap> &dataList);
 
     QVector<Command> automaticCommands() const { return m_automaticCommands; }
+
+    /// Returns true if any automatic command can match the data (without running filter commands).
+    bool canMatchAutomaticCommands(const QVariantMap &data) const { return m_automaticCommandMatcher.matchesAny(data); }
+
     QVector<Command> displayCommands() const { return m_displayCommands; }
     QVector<Command> scriptCommands() const { return m_scriptCommands; }
+    int scriptCommandsVersion() const { return m_scriptCommandsVersion; }
 
     /** Close main window and exit the application. */
     void exit();
@@ -537,8 +556,35 @@ private:
         QMenu *menu = nullptr;
     };
 
+    /// Key for display data cache.
+    struct DisplayDataKey {
+        quint64 itemHash;
+        QString tabName;
+        int displayCommandsVersion;
+
+        bool operator==(const DisplayDataKey &other) const
+        {
+            return itemHash == other.itemHash
+                && displayCommandsVersion == other.displayCommandsVersion
+                && tabName == other.tabName;
+        }
+    };
+
+    friend uint qHash(const DisplayDataKey &key, uint seed)
+    {
+        return qHash(key.itemHash, seed) ^ qHash(key.tabName, seed);
+    }
+
+    /// Return key for display data cache (item hash is 0 if data cannot be cached).
+    DisplayDataKey displayDataKey(const PersistentDisplayItem &item) const;
+
     void runDisplayCommands();
 
+    void applyCachedDisplayData();
+
+    /// Display items sent to display script, starting at index @a from, again later.
+    void requeueCurrentDisplayItems(int from);
+
     void clearHiddenDisplayData();
 
     void reloadBrowsers();
@@ -571,6 +617,26 @@ private:
     /** Return browser widget in current tab. */
     ClipboardBrowserPlaceholder *getPlaceholder() const;
 
+    /**
+     * Return search index for items in given tab.
+     *
+     * Unloaded tabs are not loaded, their index is read from file instead.
+     * Returns nullptr if the index is not available.
+     */
+    const ItemSearchIndex *searchIndex(int tabIndex);
+
+    /**
+     * Show number of matching items in tabs if searching in all tabs.
+     *
+     * Items are counted in background.
+     */
+    void updateTabMatchCounts(const QRegularExpression &re);
+    void onTabMatchCounted(int index, int count);
+    void onTabMatchCountFinished();
+
+    /** Filter items in browser using search bar (show all items in browse mode). */
+    void filterItems(ClipboardBrowser *c);
+
     /** Call updateFocusWindows() after a small delay if main window or menu is not active. */
     void delayedUpdateForeignFocusWindows();
 
@@ -622,7 +688,11 @@ private:
     QAction *actionForMenuItem(int id, QWidget *parent, Qt::ShortcutContext context);
 
     void addMenuItems(TrayMenu *menu, ClipboardBrowserPlaceholder *placeholder, int maxItemCount, const QString &searchText);
-    void activateMenuItem(ClipboardBrowserPlaceholder *placeholder, const QVariantMap &data, bool omitPaste);
+    /** Add items from other tabs than @a placeholder found using search index. */
+    void addSearchResultMenuItems(
+            TrayMenu *menu, ClipboardBrowserPlaceholder *placeholder, int maxItemCount, int *itemCount,
+            const QRegularExpression &re);
+    void activateMenuItem(ClipboardBrowserPlaceholder *placeholder, const QVariantMap &menuItemData, bool omitPaste);
     bool toggleMenu(TrayMenu *menu, QPoint pos);
     bool toggleMenu(TrayMenu *menu);
 
@@ -657,10 +727,12 @@ private:
     ClipboardBrowserSharedPtr m_sharedData;
 
     QVector<Command> m_automaticCommands;
+    CommandMatcher m_automaticCommandMatcher;
     QVector<Command> m_displayCommands;
     QVector<Command> m_menuCommands;
     QVector<Command> m_trayMenuCommands;
     QVector<Command> m_scriptCommands;
+    int m_scriptCommandsVersion = 0;
 
     PlatformWindowPtr m_lastWindow;
 
@@ -691,12 +763,26 @@ private:
     MenuItems m_menuItems;
 
     QList<PersistentDisplayItem> m_displayItemList;
-    PersistentDisplayItem m_currentDisplayItem;
+    QList<PersistentDisplayItem> m_currentDisplayItems;
     int m_displayActionId = -1;
+    /// Display data for item hash (cleared when display commands change).
+    QHash<DisplayDataKey, QVariantMap> m_displayDataCache;
+    /// Incremented when display commands change.
+    int m_displayCommandsVersion = 0;
+    QList<PersistentDisplayItem> m_cachedDisplayItems;
+    QTimer m_timerApplyCachedDisplayData;
 
     MenuMatchCommands m_trayMenuMatchCommands;
     MenuMatchCommands m_itemMenuMatchCommands;
 
+    /// Search indexes loaded for unloaded tabs.
+    QHash< QString, std::shared_ptr<ItemSearchIndex> > m_searchIndexes;
+
+    ItemMatcher m_tabMatchCounter;
+    /// Tabs passed to m_tabMatchCounter.
+    QStringList m_tabMatchCountTabs;
+    QMap<QString, int> m_tabMatchCounts;
+
     PlatformClipboardPtr m_clipboard;
 
     bool m_isActiveWindow = false;
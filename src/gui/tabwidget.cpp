@@ -130,6 +130,8 @@ void TabWidget::setTabName(int tabIndex, const QString &tabName)
     const QString oldTabName = this->tabName(tabIndex);
     if ( m_tabItemCounters.contains(oldTabName) )
         m_tabItemCounters.insert( tabName, m_tabItemCounters.take(oldTabName) );
+    if ( m_tabMatchCounters.contains(oldTabName) )
+        m_tabMatchCounters.insert( tabName, m_tabMatchCounters.take(oldTabName) );
 
     m_tabs->setTabName(tabIndex, tabName);
 
@@ -172,6 +174,7 @@ void TabWidget::removeTab(int tabIndex)
 
     const QString tabName = this->tabName(tabIndex);
     m_tabItemCounters.remove(tabName);
+    m_tabMatchCounters.remove(tabName);
 
     // Item count must be updated If tab is removed but tab group remains.
     m_tabs->setTabItemCount(tabName, QString());
@@ -338,6 +341,16 @@ void TabWidget::setTabItemCount(const QString &tabName, int itemCount)
     updateTabItemCount(tabName);
 }
 
+void TabWidget::setTabMatchCounts(const QMap<QString, int> &matchCounts)
+{
+    if (m_tabMatchCounters.isEmpty() && matchCounts.isEmpty())
+        return;
+
+    m_tabMatchCounters = matchCounts;
+    for (int i = 0; i < count(); ++i)
+        updateTabItemCount( tabName(i) );
+}
+
 bool TabWidget::eventFilter(QObject *, QEvent *event)
 {
     if (event->type() == QEvent::Move)
@@ -484,6 +497,11 @@ void TabWidget::updateTabItemCount(const QString &name)
 
 QString TabWidget::itemCountLabel(const QString &name)
 {
+    if ( !m_tabMatchCounters.isEmpty() ) {
+        const int count = m_tabMatchCounters.value(name, -1);
+        return count > 0 ? QString::number(count) : count == 0 ? QString() : QString("?");
+    }
+
     if (!m_showTabItemCount)
         return QString();
 
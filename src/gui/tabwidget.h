@@ -96,6 +96,12 @@ public:
     void setTreeModeEnabled(bool enabled);
     void setTabItemCount(const QString &tabName, int itemCount);
 
+    /**
+     * Show number of matching items instead of item count in tabs
+     * (empty map restores item counts).
+     */
+    void setTabMatchCounts(const QMap<QString, int> &matchCounts);
+
 signals:
     /// Tabs moved in tab bar.
     void tabMoved(int from, int to);
@@ -133,6 +139,7 @@ private:
 
     QStringList m_collapsedTabs;
     QMap<QString, int> m_tabItemCounters;
+    QMap<QString, int> m_tabMatchCounters;
 
     bool m_showTabItemCount;
 
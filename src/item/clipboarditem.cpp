@@ -32,11 +32,13 @@
 
 namespace {
 
-void clearDataExceptInternal(QVariantMap *data)
+void clearDataExceptInternal(QVariantMap *data, QHash<QString, quint64> *formatHashes)
 {
     for ( const auto &format : data->keys() ) {
-        if ( !format.startsWith(COPYQ_MIME_PREFIX) )
+        if ( !format.startsWith(COPYQ_MIME_PREFIX) ) {
             data->remove(format);
+            formatHashes->remove(format);
+        }
     }
 }
 
@@ -61,33 +63,50 @@ bool ClipboardItem::operator ==(const ClipboardItem &item) const
 
 void ClipboardItem::setText(const QString &text)
 {
+    copyMappedData();
+
     for ( const auto &format : m_data.keys() ) {
-        if ( format.startsWith("text/") )
+        if ( format.startsWith("text/") ) {
             m_data.remove(format);
+            invalidateFormatHash(format);
+        }
     }
 
     setTextData(&m_data, text);
-
-    invalidateDataHash();
+    invalidateFormatHash(mimeText);
 }
 
 bool ClipboardItem::setData(const QVariantMap &data)
 {
+    copyMappedData();
+
     if (m_data == data)
         return false;
 
     m_data = data;
+    m_formatHashes.clear();
     invalidateDataHash();
     return true;
 }
 
+void ClipboardItem::setMappedData(const MappedItemData &data)
+{
+    m_data.clear();
+    m_mappedData = data;
+    m_mappedDataCache.clear();
+    m_formatHashes.clear();
+    invalidateDataHash();
+}
+
 bool ClipboardItem::updateData(const QVariantMap &data)
 {
+    copyMappedData();
+
     const int oldSize = m_data.size();
     for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
         const auto &format = it.key();
         if ( !format.startsWith(COPYQ_MIME_PREFIX) ) {
-            clearDataExceptInternal(&m_data);
+            clearDataExceptInternal(&m_data, &m_formatHashes);
             break;
         }
     }
@@ -99,9 +118,11 @@ bool ClipboardItem::updateData(const QVariantMap &data)
         const auto &value = it.value();
         if ( !value.isValid() ) {
             m_data.remove(format);
+            invalidateFormatHash(format);
             changed = true;
         } else if ( m_data.value(format) != value ) {
             m_data.insert(format, value);
+            invalidateFormatHash(format);
             changed = true;
         }
     }
@@ -113,31 +134,33 @@ bool ClipboardItem::updateData(const QVariantMap &data)
 
 void ClipboardItem::removeData(const QString &mimeType)
 {
+    copyMappedData();
     m_data.remove(mimeType);
-    invalidateDataHash();
+    invalidateFormatHash(mimeType);
 }
 
 bool ClipboardItem::removeData(const QStringList &mimeTypeList)
 {
+    copyMappedData();
+
     bool removed = false;
 
     for (const auto &mimeType : mimeTypeList) {
         if ( m_data.contains(mimeType) ) {
             m_data.remove(mimeType);
+            invalidateFormatHash(mimeType);
             removed = true;
         }
     }
 
-    if (removed)
-        invalidateDataHash();
-
     return removed;
 }
 
 void ClipboardItem::setData(const QString &mimeType, const QByteArray &data)
 {
+    copyMappedData();
     m_data.insert(mimeType, data);
-    invalidateDataHash();
+    invalidateFormatHash(mimeType);
 }
 
 QVariant ClipboardItem::data(int role) const
@@ -145,44 +168,152 @@ QVariant ClipboardItem::data(int role) const
     switch(role) {
     case Qt::DisplayRole:
     case Qt::EditRole:
-        if ( m_data.contains(mimeText) )
-            return getTextData(m_data);
-        if ( m_data.contains(mimeUriList) )
-            return getTextData(m_data, mimeUriList);
+        if ( hasFormat(mimeText) )
+            return getTextData( data(mimeText) );
+        if ( hasFormat(mimeUriList) )
+            return getTextData( data(mimeUriList) );
         break;
 
     case contentType::data:
+        if ( !m_mappedData.isEmpty() ) {
+            // Keep the copy since the data are usually requested repeatedly.
+            if ( m_mappedDataCache.isEmpty() )
+                m_mappedDataCache = m_mappedData.toMap();
+            return m_mappedDataCache;
+        }
         return m_data; // copy-on-write, so this should be fast
+    case contentType::mappedData:
+        if ( !m_mappedData.isEmpty() )
+            return QVariant::fromValue(m_mappedData);
+        break;
     case contentType::hash:
         return dataHash();
     case contentType::hasText:
-        return m_data.contains(mimeText) || m_data.contains(mimeUriList);
+        return hasFormat(mimeText) || hasFormat(mimeUriList);
     case contentType::hasHtml:
-        return m_data.contains(mimeHtml);
+        return hasFormat(mimeHtml);
     case contentType::text:
-        return getTextData(m_data);
+        if ( hasFormat(mimeText) )
+            return getTextData( data(mimeText) );
+        return getTextData( data(mimeUriList) );
+    case contentType::textData:
+        if ( hasFormat(mimeText) )
+            return data(mimeText);
+        return data(mimeUriList);
     case contentType::html:
-        return getTextData(m_data, mimeHtml);
+        return getTextData( data(mimeHtml) );
     case contentType::notes:
-        return getTextData(m_data, mimeItemNotes);
+        return getTextData( data(mimeItemNotes) );
     case contentType::color:
-        return getTextData(m_data, mimeColor);
+        return getTextData( data(mimeColor) );
     case contentType::isHidden:
-        return m_data.contains(mimeHidden);
+        return hasFormat(mimeHidden);
     }
 
     return QVariant();
 }
 
-unsigned int ClipboardItem::dataHash() const
+QByteArray ClipboardItem::data(const QString &format) const
 {
-    if (m_hash == 0)
-        m_hash = hash(m_data);
+    if ( !m_mappedData.isEmpty() ) {
+        if ( !m_mappedDataCache.isEmpty() )
+            return m_mappedDataCache.value(format).toByteArray();
+        return m_mappedData.data(format);
+    }
+    return m_data.value(format).toByteArray();
+}
+
+quint64 ClipboardItem::dataHash() const
+{
+    if (m_hash == 0) {
+        // Avoid copying mapped data.
+        const QVariantMap data = m_mappedData.isEmpty() ? m_data : m_mappedData.toRawMap();
+
+        // Same as hash(data) but rehash only changed formats.
+        quint64 seed = 0;
+        for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+            const auto &format = it.key();
+            auto formatHash = m_formatHashes.constFind(format);
+            if ( formatHash == m_formatHashes.constEnd() )
+                formatHash = m_formatHashes.insert( format, hashFormat(format, it.value().toByteArray()) );
+            seed = combineHash(seed, formatHash.value());
+        }
+        m_hash = seed;
+    }
 
     return m_hash;
 }
 
+QString ClipboardItem::searchText(const ItemSearchTextFunction &createSearchText, const QStringList &formats) const
+{
+    if (!m_hasSearchText) {
+        // Avoid caching mapped data of all items while searching.
+        m_searchText = createSearchText( searchTextData(formats) );
+        m_hasSearchText = true;
+    }
+
+    return m_searchText;
+}
+
+QString ClipboardItem::foldedSearchText(const ItemSearchTextFunction &createSearchText, const QStringList &formats) const
+{
+    if (!m_hasFoldedSearchText) {
+        m_foldedSearchText = searchText(createSearchText, formats).toCaseFolded();
+        m_hasFoldedSearchText = true;
+    }
+
+    return m_foldedSearchText;
+}
+
+void ClipboardItem::clearSearchText()
+{
+    m_searchText.clear();
+    m_foldedSearchText.clear();
+    m_hasSearchText = false;
+    m_hasFoldedSearchText = false;
+}
+
 void ClipboardItem::invalidateDataHash()
 {
     m_hash = 0;
+    clearSearchText();
+}
+
+void ClipboardItem::invalidateFormatHash(const QString &format)
+{
+    m_formatHashes.remove(format);
+    invalidateDataHash();
+}
+
+bool ClipboardItem::hasFormat(const QString &format) const
+{
+    if ( !m_mappedData.isEmpty() )
+        return m_mappedData.contains(format);
+    return m_data.contains(format);
+}
+
+void ClipboardItem::copyMappedData()
+{
+    if ( m_mappedData.isEmpty() )
+        return;
+
+    m_data = m_mappedDataCache.isEmpty() ? m_mappedData.toMap() : m_mappedDataCache;
+    m_mappedData = MappedItemData();
+    m_mappedDataCache.clear();
+}
+
+QVariantMap ClipboardItem::searchTextData(const QStringList &formats) const
+{
+    if ( m_mappedData.isEmpty() )
+        return m_data;
+    if ( !m_mappedDataCache.isEmpty() )
+        return m_mappedDataCache;
+
+    // Don't decode other formats (e.g. images).
+    QVariantMap data;
+    for (const auto &format : formats) {
+        if ( m_mappedData.contains(format) )
+            data.insert( format, m_mappedData.data(format) );
+    }
+    return data;
 }
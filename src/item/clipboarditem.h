@@ -20,10 +20,18 @@
 #ifndef CLIPBOARDITEM_H
 #define CLIPBOARDITEM_H
 
+#include "item/serialize.h"
+
+#include <QHash>
+#include <QString>
 #include <QVariant>
 
+#include <functional>
+
 class QByteArray;
-class QString;
+
+/// Returns text for searching in item data.
+using ItemSearchTextFunction = std::function<QString(const QVariantMap &data)>;
 
 /**
  * Class for clipboard items in ClipboardModel.
@@ -55,6 +63,12 @@ public:
      */
     bool setData(const QVariantMap &data);
 
+    /**
+     * Set formats stored in a tab file.
+     * Data are copied from the file only when requested or modified.
+     */
+    void setMappedData(const MappedItemData &data);
+
     /**
      * Update current data.
      * Clears non-internal data if passed data map contains non-internal data.
@@ -72,16 +86,51 @@ public:
     QVariant data(int role) const;
 
     /** Return data for format. */
-    QByteArray data(const QString &format) const { return m_data.value(format).toByteArray(); }
+    QByteArray data(const QString &format) const;
 
     /** Return hash for item's data. */
-    unsigned int dataHash() const;
+    quint64 dataHash() const;
+
+    /**
+     * Return text for searching created with @a createSearchText.
+     *
+     * Only given @a formats are read from items loaded lazily from tab file.
+     *
+     * The text is cached until item data change.
+     */
+    QString searchText(const ItemSearchTextFunction &createSearchText, const QStringList &formats) const;
+
+    /** Same as searchText() but case-folded. */
+    QString foldedSearchText(const ItemSearchTextFunction &createSearchText, const QStringList &formats) const;
+
+    /** Clear cached search text. */
+    void clearSearchText();
 
 private:
     void invalidateDataHash();
 
+    void invalidateFormatHash(const QString &format);
+
+    bool hasFormat(const QString &format) const;
+
+    /** Copy mapped data so these can be modified. */
+    void copyMappedData();
+
+    /// Return given formats for search text (mapped data are copied and not cached).
+    QVariantMap searchTextData(const QStringList &formats) const;
+
     QVariantMap m_data;
-    mutable unsigned int m_hash;
+    MappedItemData m_mappedData;
+    /// Mapped data copied on first request for all formats (e.g. displayed items).
+    mutable QVariantMap m_mappedDataCache;
+    mutable quint64 m_hash;
+    /// Cached hash for each format so only changed formats are hashed again.
+    mutable QHash<QString, quint64> m_formatHashes;
+
+    mutable QString m_searchText;
+    mutable QString m_foldedSearchText;
+    mutable bool m_hasSearchText = false;
+    mutable bool m_hasFoldedSearchText = false;
 };
 
 #endif // CLIPBOARDITEM_H
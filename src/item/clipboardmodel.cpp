@@ -26,6 +26,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <iterator>
 
 namespace {
 
@@ -52,20 +53,119 @@ int topMostRow(const QList<QPersistentModelIndex> &indexList)
     return row;
 }
 
+/// Chunk is split when it grows over this size.
+const int maxChunkSize = 512;
+
 } // namespace
 
-void ClipboardItemList::move(int from, int count, int to)
+void ClipboardItemList::insert(int row, const ClipboardItem &item)
+{
+    if ( m_chunks.empty() ) {
+        m_chunks.emplace_back();
+        m_chunkStarts.push_back(0);
+    }
+
+    const int index = chunkIndex(row);
+    Chunk &chunk = m_chunks[index];
+    chunk.insert( chunk.begin() + (row - m_chunkStarts[index]), item );
+    ++m_size;
+
+    if ( static_cast<int>(chunk.size()) > maxChunkSize )
+        splitChunk(index);
+
+    updateChunkStarts(index + 1);
+}
+
+void ClipboardItemList::remove(int row, int count)
 {
-    if (to < from) {
-        std::swap(from, to);
-        to += count;
-        count = to - from - count;
+    if (count <= 0)
+        return;
+
+    const int firstChunk = chunkIndex(row);
+    int index = firstChunk;
+    int offset = row - m_chunkStarts[index];
+    for (int remaining = count; remaining > 0; ++index) {
+        Chunk &chunk = m_chunks[index];
+        const int removeCount = qMin( remaining, static_cast<int>(chunk.size()) - offset );
+        chunk.erase( chunk.begin() + offset, chunk.begin() + offset + removeCount );
+        remaining -= removeCount;
+        offset = 0;
+    }
+    m_size -= count;
+
+    // Drop chunks that became empty (whole chunks are removed at once).
+    for (int i = index - 1; i >= firstChunk; --i) {
+        if ( m_chunks[i].empty() ) {
+            m_chunks.erase(m_chunks.begin() + i);
+            m_chunkStarts.erase(m_chunkStarts.begin() + i);
+        }
     }
 
-    const auto start1 = std::begin(m_items) + from;
-    const auto start2 = start1 + count;
-    const auto end2 = std::begin(m_items) + to;
-    std::rotate(start1, start2, end2);
+    mergeChunks(firstChunk);
+    mergeChunks(firstChunk - 1);
+    updateChunkStarts(firstChunk - 1);
+}
+
+void ClipboardItemList::move(int from, int to)
+{
+    if (from == to)
+        return;
+
+    const ClipboardItem item = (*this)[from];
+    remove(from, 1);
+    insert(to, item);
+}
+
+void ClipboardItemList::move(int from, int count, int to)
+{
+    std::vector<ClipboardItem> items;
+    items.reserve(count);
+    for (int i = from; i < from + count; ++i)
+        items.push_back( (*this)[i] );
+
+    remove(from, count);
+
+    // Destination row is given as if the items were not removed yet.
+    int row = to > from ? to - count : to;
+    for (const auto &item : items)
+        insert(row++, item);
+}
+
+void ClipboardItemList::splitChunk(int index)
+{
+    Chunk &chunk = m_chunks[index];
+    const auto middle = chunk.begin() + chunk.size() / 2;
+    Chunk newChunk( std::make_move_iterator(middle), std::make_move_iterator(chunk.end()) );
+    chunk.erase( middle, chunk.end() );
+
+    m_chunks.insert( m_chunks.begin() + index + 1, std::move(newChunk) );
+    m_chunkStarts.insert( m_chunkStarts.begin() + index + 1, 0 );
+}
+
+void ClipboardItemList::mergeChunks(int index)
+{
+    // Merge small neighbor chunks so the number of chunks stays low.
+    if ( index < 0 || index + 1 >= static_cast<int>(m_chunks.size()) )
+        return;
+
+    Chunk &chunk = m_chunks[index];
+    Chunk &nextChunk = m_chunks[index + 1];
+    if ( static_cast<int>(chunk.size() + nextChunk.size()) > maxChunkSize / 2 )
+        return;
+
+    chunk.insert( chunk.end(),
+                  std::make_move_iterator(nextChunk.begin()),
+                  std::make_move_iterator(nextChunk.end()) );
+    m_chunks.erase(m_chunks.begin() + index + 1);
+    m_chunkStarts.erase(m_chunkStarts.begin() + index + 1);
+}
+
+void ClipboardItemList::updateChunkStarts(int firstChunk)
+{
+    for (int i = qMax(0, firstChunk); i < static_cast<int>(m_chunks.size()); ++i) {
+        m_chunkStarts[i] = i == 0
+                ? 0 : m_chunkStarts[i - 1] + static_cast<int>(m_chunks[i - 1].size());
+    }
 }
 
 ClipboardModel::ClipboardModel(QObject *parent)
@@ -83,7 +183,15 @@ QVariant ClipboardModel::data(const QModelIndex &index, int role) const
     if (!index.isValid() || index.row() >= m_clipboardList.size())
         return QVariant();
 
-    return m_clipboardList[index.row()].data(role);
+    const ClipboardItem &item = m_clipboardList[index.row()];
+
+    if (role == contentType::searchText)
+        return m_createSearchText ? item.searchText(m_createSearchText, m_searchTextFormats) : QVariant();
+
+    if (role == contentType::foldedSearchText)
+        return m_createSearchText ? item.foldedSearchText(m_createSearchText, m_searchTextFormats) : QVariant();
+
+    return item.data(role);
 }
 
 Qt::ItemFlags ClipboardModel::flags(const QModelIndex &index) const
@@ -99,35 +207,18 @@ bool ClipboardModel::setData(const QModelIndex &index, const QVariant &value, in
     if ( !index.isValid() )
         return false;
 
-    int row = index.row();
+    const int row = index.row();
 
-    if (role == Qt::EditRole) {
-        m_clipboardList[row].setText(value.toString());
-    } else if (role == contentType::notes) {
-        const QString notes = value.toString();
-        if ( notes.isEmpty() )
-            m_clipboardList[row].removeData(mimeItemNotes);
-        else
-            m_clipboardList[row].setData( mimeItemNotes, notes.toUtf8() );
-    } else if (role == contentType::updateData) {
-        if ( !m_clipboardList[row].updateData(value.toMap()) )
-            return false;
-    } else if (role == contentType::data) {
-        ClipboardItem &item = m_clipboardList[row];
-        const QVariantMap dataMap = value.toMap();
-        // Emit dataChanged() only if really changed.
-        if ( !item.setData(dataMap) )
-            return true;
-    } else if (role >= contentType::removeFormats) {
-        if ( !m_clipboardList[row].removeData(value.toStringList()) )
-            return false;
-    } else {
-        return false;
-    }
+    // Item hash can change.
+    removeFromHashIndex(row, row);
+    bool changed = false;
+    const bool result = setItemData(&m_clipboardList[row], value, role, &changed);
+    addToHashIndex(row, row);
 
-    emit dataChanged(index, index);
+    if (changed)
+        emit dataChanged(index, index);
 
-    return true;
+    return result;
 }
 
 void ClipboardModel::insertItem(const QVariantMap &data, int row)
@@ -138,6 +229,7 @@ void ClipboardModel::insertItem(const QVariantMap &data, int row)
     beginInsertRows(QModelIndex(), row, row);
 
     m_clipboardList.insert(row, item);
+    updateHashIndexForInsertedRows(row, 1);
 
     endInsertRows();
 }
@@ -148,7 +240,6 @@ void ClipboardModel::insertItems(const QList<QVariantMap> &dataList, int row)
         return;
 
     int targetRow = row;
-    m_clipboardList.reserve( m_clipboardList.size() + dataList.size() );
 
     beginInsertRows(QModelIndex(), row, row + dataList.size() - 1);
 
@@ -156,6 +247,7 @@ void ClipboardModel::insertItems(const QList<QVariantMap> &dataList, int row)
         m_clipboardList.insert(targetRow, ClipboardItem(*it));
         ++targetRow;
     }
+    updateHashIndexForInsertedRows(row, dataList.size());
 
     endInsertRows();
 }
@@ -169,6 +261,7 @@ bool ClipboardModel::insertRows(int position, int rows, const QModelIndex&)
 
     for (int row = 0; row < rows; ++row)
         m_clipboardList.insert(position, ClipboardItem());
+    updateHashIndexForInsertedRows(position, rows);
 
     endInsertRows();
 
@@ -184,7 +277,9 @@ bool ClipboardModel::removeRows(int position, int rows, const QModelIndex&)
 
     beginRemoveRows(QModelIndex(), position, last);
 
+    removeFromHashIndex(position, last);
     m_clipboardList.remove(position, last - position + 1);
+    updateHashIndexForRemovedRows(position, last - position + 1);
 
     endRemoveRows();
 
@@ -208,46 +303,229 @@ bool ClipboardModel::moveRows(
     if (sourceRow <= destinationRow && destinationRow <= last + 1)
         return false;
 
+    // Only rows between source and destination change.
+    const int first = qMin(sourceRow, destinationRow);
+    const int lastChanged = qMax(last, destinationRow - 1);
+
     beginMoveRows(sourceParent, sourceRow, last, destinationParent, destinationRow);
+    removeFromHashIndex(first, lastChanged);
     m_clipboardList.move(sourceRow, rows, destinationRow);
+    addToHashIndex(first, lastChanged);
     endMoveRows();
 
     return true;
 }
 
-void ClipboardModel::sortItems(const QModelIndexList &indexList, CompareItems *compare)
+void ClipboardModel::sortItems(const QModelIndexList &indexList, CompareItems *compare, const IsItemFixed &isFixed)
 {
     QList<QPersistentModelIndex> list = validIndeces(indexList);
+    if (isFixed) {
+        list.erase( std::remove_if(list.begin(), list.end(), [&](const QPersistentModelIndex &index) {
+            return isFixed(index);
+        }), list.end() );
+    }
+    if ( list.isEmpty() )
+        return;
+
     std::sort( list.begin(), list.end(), compare );
 
-    int targetRow = topMostRow(list);
+    // Sorted items are placed from the top-most of them, followed by other
+    // items in original order. Fixed items are skipped.
+    const int firstRow = topMostRow(list);
+    const int rowCount = m_clipboardList.size();
+    std::vector<bool> isSorted(rowCount, false);
+    std::vector<int> targetRows;
+    targetRows.reserve(rowCount - firstRow);
+    for (int row = firstRow; row < rowCount; ++row) {
+        if ( !isFixed || !isFixed(index(row)) )
+            targetRows.push_back(row);
+    }
 
-    for (const auto &ind : list) {
-        if (ind.isValid()) {
-            const int sourceRow = ind.row();
+    std::vector<int> oldRows;
+    oldRows.reserve( targetRows.size() );
+    for (const auto &index : list) {
+        const int row = index.row();
+        if ( !isSorted[row] ) {
+            isSorted[row] = true;
+            oldRows.push_back(row);
+        }
+    }
+    for (const int row : targetRows) {
+        if ( !isSorted[row] )
+            oldRows.push_back(row);
+    }
 
-            if (targetRow != sourceRow) {
-                beginMoveRows(QModelIndex(), sourceRow, sourceRow, QModelIndex(), targetRow);
-                m_clipboardList.move(sourceRow, targetRow);
-                endMoveRows();
+    std::vector<int> newRows(rowCount);
+    bool changed = false;
+    for (int row = 0; row < rowCount; ++row)
+        newRows[row] = row;
+    for (int i = 0; i < static_cast<int>(oldRows.size()); ++i) {
+        const int newRow = targetRows[i];
+        newRows[ oldRows[i] ] = newRow;
+        changed = changed || newRow != oldRows[i];
+    }
 
-                // If the moved item was removed or moved further (as reaction on moving the item),
-                // stop sorting.
-                if (!ind.isValid() || ind.row() != targetRow)
-                    break;
-            }
+    if (!changed)
+        return;
 
-            ++targetRow;
-        }
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+    const QModelIndexList oldIndexes = persistentIndexList();
+    QModelIndexList newIndexes;
+    newIndexes.reserve( oldIndexes.size() );
+    for (const auto &index : oldIndexes)
+        newIndexes.append( this->index(newRows[index.row()]) );
+    changePersistentIndexList(oldIndexes, newIndexes);
+
+    removeFromHashIndex(firstRow, rowCount - 1);
+
+    std::vector<ClipboardItem> items;
+    items.reserve( oldRows.size() );
+    for (const int row : oldRows)
+        items.push_back( m_clipboardList[row] );
+    for (int i = 0; i < static_cast<int>(items.size()); ++i)
+        m_clipboardList[ targetRows[i] ] = items[i];
+
+    addToHashIndex(firstRow, rowCount - 1);
+
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+void ClipboardModel::setSearchTextFunction(const ItemSearchTextFunction &createSearchText, const QStringList &formats)
+{
+    m_createSearchText = createSearchText;
+    m_searchTextFormats = formats;
+    for (int row = 0; row < m_clipboardList.size(); ++row)
+        m_clipboardList[row].clearSearchText();
+}
+
+int ClipboardModel::findItem(quint64 itemHash) const
+{
+    buildHashIndex();
+
+    // Return top-most row if there are more items with the same hash.
+    int row = -1;
+    const int lastRow = m_clipboardList.size() - 1;
+    for ( auto it = m_hashIndex.constFind(itemHash);
+          it != m_hashIndex.constEnd() && it.key() == itemHash; ++it )
+    {
+        const int itemRow = lastRow - (it.value() - m_hashIndexOffset);
+        if (row == -1 || itemRow < row)
+            row = itemRow;
     }
+
+    return row;
 }
 
-int ClipboardModel::findItem(uint itemHash) const
+bool ClipboardModel::setItemData(ClipboardItem *item, const QVariant &value, int role, bool *changed)
 {
-    for (int i = 0; i < m_clipboardList.size(); ++i) {
-        if ( m_clipboardList[i].dataHash() == itemHash )
-            return i;
+    if (role == Qt::EditRole) {
+        item->setText(value.toString());
+    } else if (role == contentType::notes) {
+        const QString notes = value.toString();
+        if ( notes.isEmpty() )
+            item->removeData(mimeItemNotes);
+        else
+            item->setData( mimeItemNotes, notes.toUtf8() );
+    } else if (role == contentType::updateData) {
+        if ( !item->updateData(value.toMap()) )
+            return false;
+    } else if (role == contentType::data) {
+        const QVariantMap dataMap = value.toMap();
+        // Emit dataChanged() only if really changed.
+        if ( !item->setData(dataMap) )
+            return true;
+    } else if (role == contentType::mappedData) {
+        if ( !value.canConvert<MappedItemData>() )
+            return false;
+        item->setMappedData( value.value<MappedItemData>() );
+    } else if (role >= contentType::removeFormats) {
+        if ( !item->removeData(value.toStringList()) )
+            return false;
+    } else {
+        return false;
     }
 
-    return -1;
+    *changed = true;
+    return true;
+}
+
+void ClipboardModel::buildHashIndex() const
+{
+    if (m_hashIndexValid)
+        return;
+
+    m_hashIndex.clear();
+    m_hashIndex.reserve( m_clipboardList.size() );
+    m_hashIndexOffset = 0;
+    for (int row = 0; row < m_clipboardList.size(); ++row)
+        m_hashIndex.insert( m_clipboardList[row].dataHash(), hashIndexKey(row) );
+
+    m_hashIndexValid = true;
+}
+
+int ClipboardModel::hashIndexKey(int row) const
+{
+    return m_clipboardList.size() - 1 - row + m_hashIndexOffset;
+}
+
+void ClipboardModel::addToHashIndex(int first, int last)
+{
+    if (!m_hashIndexValid)
+        return;
+
+    for (int row = first; row <= last; ++row)
+        m_hashIndex.insert( m_clipboardList[row].dataHash(), hashIndexKey(row) );
+}
+
+void ClipboardModel::removeFromHashIndex(int first, int last)
+{
+    if (!m_hashIndexValid)
+        return;
+
+    for (int row = first; row <= last; ++row)
+        m_hashIndex.remove( m_clipboardList[row].dataHash(), hashIndexKey(row) );
+}
+
+void ClipboardModel::rekeyHashIndex(int first, int last, int oldKeyDelta)
+{
+    if (!m_hashIndexValid)
+        return;
+
+    // Remove all old keys first since these can be same as new keys of other items.
+    for (int row = first; row <= last; ++row)
+        m_hashIndex.remove( m_clipboardList[row].dataHash(), hashIndexKey(row) + oldKeyDelta );
+    addToHashIndex(first, last);
+}
+
+void ClipboardModel::updateHashIndexForInsertedRows(int row, int count)
+{
+    if (!m_hashIndexValid)
+        return;
+
+    // Update keys of items above or below inserted rows, whichever is fewer.
+    const int size = m_clipboardList.size();
+    if ( row <= size - row - count ) {
+        rekeyHashIndex(0, row - 1, -count);
+    } else {
+        m_hashIndexOffset -= count;
+        rekeyHashIndex(row + count, size - 1, count);
+    }
+
+    addToHashIndex(row, row + count - 1);
+}
+
+void ClipboardModel::updateHashIndexForRemovedRows(int row, int count)
+{
+    if (!m_hashIndexValid)
+        return;
+
+    // Update keys of items above or below removed rows, whichever is fewer.
+    const int size = m_clipboardList.size();
+    if ( row <= size - row ) {
+        rekeyHashIndex(0, row - 1, count);
+    } else {
+        m_hashIndexOffset += count;
+        rekeyHashIndex(row, size - 1, -count);
+    }
 }
@@ -24,66 +24,64 @@
 
 #include <QAbstractListModel>
 #include <QList>
+#include <QMultiHash>
+#include <QStringList>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
 
 /**
  * Container with clipboard items.
  *
- * Item prepending is optimized.
+ * Items are stored in chunks of limited size so inserting, removing or
+ * moving an item shifts only items in a single chunk and chunk offsets
+ * instead of all items.
  */
 class ClipboardItemList final {
 public:
     ClipboardItem &operator [](int i)
     {
-        return m_items[i];
+        const int chunk = chunkIndex(i);
+        return m_chunks[chunk][i - m_chunkStarts[chunk]];
     }
 
     const ClipboardItem &operator [](int i) const
     {
-        return m_items[i];
+        const int chunk = chunkIndex(i);
+        return m_chunks[chunk][i - m_chunkStarts[chunk]];
     }
 
-    void insert(int row, const ClipboardItem &item)
-    {
-        m_items.insert(row, item);
-    }
+    void insert(int row, const ClipboardItem &item);
 
-    void remove(int row, int count)
-    {
-        const QList<ClipboardItem>::iterator from = m_items.begin() + row;
-        const QList<ClipboardItem>::iterator to = from + count;
-        m_items.erase(from, to);
-    }
+    void remove(int row, int count);
 
     int size() const
     {
-        return m_items.size();
+        return m_size;
     }
 
-    void move(int from, int to)
-    {
-        const ClipboardItem item = m_items[from];
-        m_items.removeAt(from);
-        m_items.insert(to, item);
-    }
+    void move(int from, int to);
 
     void move(int from, int count, int to);
 
-    void reserve(int maxItems)
-    {
-        m_items.reserve(maxItems);
-    }
+private:
+    using Chunk = std::vector<ClipboardItem>;
 
-    void resize(int size)
+    /// Return index of chunk containing given row (or last chunk for row after the last item).
+    int chunkIndex(int row) const
     {
-        if (size < this->size())
-            remove(size, this->size());
-
-        while (size > this->size())
-            m_items.append(ClipboardItem());
+        const auto it = std::upper_bound(m_chunkStarts.begin(), m_chunkStarts.end(), row);
+        return static_cast<int>(it - m_chunkStarts.begin()) - 1;
     }
 
-private:
-    QList<ClipboardItem> m_items;
+    void splitChunk(int chunk);
+    void mergeChunks(int chunk);
+    void updateChunkStarts(int firstChunk);
+
+    std::vector<Chunk> m_chunks;
+    std::vector<int> m_chunkStarts;
+    int m_size = 0;
 };
 
 /**
@@ -100,6 +98,9 @@ public:
     /** Return true if @a lhs is less than @a rhs. */
     using CompareItems = bool (const QModelIndex &, const QModelIndex &);
 
+    /** Return true if item cannot be moved (e.g. pinned item). */
+    using IsItemFixed = std::function<bool (const QModelIndex &)>;
+
     explicit ClipboardModel(QObject *parent = nullptr);
 
     /** Return number of items in model. */
@@ -127,17 +128,55 @@ public:
 
     /**
      * Sort items in ascending order.
+     *
+     * Fixed items are not sorted and stay in the same rows, other items are
+     * placed around them.
      */
-    void sortItems(const QModelIndexList &indexList, CompareItems *compare);
+    void sortItems(const QModelIndexList &indexList, CompareItems *compare,
+                   const IsItemFixed &isFixed = IsItemFixed());
 
     /**
      * Find item with given @a hash.
      * @return Row number with found item or -1 if no item was found.
      */
-    int findItem(uint itemHash) const;
+    int findItem(quint64 itemHash) const;
+
+    /**
+     * Set function which creates text for contentType::searchText role.
+     *
+     * The function gets only the given @a formats of items loaded lazily
+     * from tab file.
+     *
+     * Clears texts cached in items.
+     */
+    void setSearchTextFunction(const ItemSearchTextFunction &createSearchText, const QStringList &formats);
 
 private:
+    bool setItemData(ClipboardItem *item, const QVariant &value, int role, bool *changed);
+
+    void buildHashIndex() const;
+    int hashIndexKey(int row) const;
+    void addToHashIndex(int first, int last);
+    void removeFromHashIndex(int first, int last);
+    void rekeyHashIndex(int first, int last, int oldKeyDelta);
+    void updateHashIndexForInsertedRows(int row, int count);
+    void updateHashIndexForRemovedRows(int row, int count);
+
     ClipboardItemList m_clipboardList;
+
+    /**
+     * Item rows by item hash (built when needed).
+     *
+     * Rows are stored as distance from the last row plus m_hashIndexOffset
+     * so adding items to the top or removing items from the bottom does not
+     * change rows of other items.
+     */
+    mutable QMultiHash<quint64, int> m_hashIndex;
+    mutable int m_hashIndexOffset = 0;
+    mutable bool m_hashIndexValid = false;
+
+    ItemSearchTextFunction m_createSearchText;
+    QStringList m_searchTextFormats;
 };
 
 #endif // CLIPBOARDMODEL_H
@@ -130,6 +130,27 @@ void ItemDelegate::rowsMoved(const QModelIndex &, int sourceStart, int sourceEnd
     std::rotate(start1, start2, end2);
 }
 
+void ItemDelegate::layoutAboutToBeChanged()
+{
+    m_layoutCache.clear();
+    for ( size_t row = 0; row < m_cache.size(); ++row ) {
+        auto &w = m_cache[row];
+        if (w)
+            m_layoutCache.emplace_back( m_view->index(static_cast<int>(row)), std::move(w) );
+    }
+}
+
+void ItemDelegate::layoutChanged()
+{
+    m_cache.assign( m_cache.size(), nullptr );
+    for (auto &indexWidget : m_layoutCache) {
+        const int row = indexWidget.first.row();
+        if ( row >= 0 && static_cast<size_t>(row) < m_cache.size() )
+            m_cache[row] = std::move(indexWidget.second);
+    }
+    m_layoutCache.clear();
+}
+
 bool ItemDelegate::showAt(const QModelIndex &index, QPoint pos)
 {
     auto w = cache(index);
@@ -149,7 +170,7 @@ bool ItemDelegate::showAt(const QModelIndex &index, QPoint pos)
     return true;
 }
 
-QWidget *ItemDelegate::createPreview(const QVariantMap &data, QWidget *parent)
+QWidget *ItemDelegate::createPreview(const QVariantMap &data, quint64 itemHash, QWidget *parent)
 {
     const bool antialiasing = m_sharedData->theme.isAntialiasingEnabled();
     ItemWidget *itemWidget =
@@ -164,7 +185,7 @@ QWidget *ItemDelegate::createPreview(const QVariantMap &data, QWidget *parent)
 
     parent->setFocusProxy( itemWidget->widget() );
 
-    emit itemWidgetCreated(PersistentDisplayItem(this, data, itemWidget->widget()));
+    emit itemWidgetCreated(PersistentDisplayItem(this, data, itemWidget->widget(), itemHash));
 
     return itemWidget->widget();
 }
@@ -187,7 +208,8 @@ ItemWidget *ItemDelegate::cache(const QModelIndex &index)
         auto data = m_view->itemData(index);
         data.insert(mimeCurrentTab, m_view->tabName());
         w = updateCache(index, data);
-        emit itemWidgetCreated(PersistentDisplayItem(this, data, w->widget()));
+        const auto itemHash = index.data(contentType::hash).toULongLong();
+        emit itemWidgetCreated(PersistentDisplayItem(this, data, w->widget(), itemHash));
     }
 
     return w;
@@ -206,7 +228,7 @@ void ItemDelegate::updateCache(QObject *widget, const QVariantMap &data)
         if (!scrollArea)
             return;
 
-        auto newPreview = createPreview(data, scrollArea);
+        auto newPreview = createPreview(data, 0, scrollArea);
         scrollArea->setWidget(newPreview);
         newPreview->show();
         return;
@@ -23,9 +23,11 @@
 #include "gui/clipboardbrowsershared.h"
 
 #include <QItemDelegate>
+#include <QPersistentModelIndex>
 #include <QRegularExpression>
 
 #include <memory>
+#include <utility>
 #include <vector>
 
 class Item;
@@ -115,10 +117,17 @@ class ItemDelegate final : public QItemDelegate
         void rowsInserted(const QModelIndex &parent, int start, int end);
         void rowsMoved(const QModelIndex &parent, int sourceStart, int sourceEnd,
                        const QModelIndex &destination, int destinationRow);
+        void layoutAboutToBeChanged();
+        void layoutChanged();
 
         bool showAt(const QModelIndex &index, QPoint pos);
 
-        QWidget *createPreview(const QVariantMap &data, QWidget *parent);
+        /**
+         * Create preview widget for item data.
+         *
+         * @a itemHash is contentType::hash of the item or 0 for display data.
+         */
+        QWidget *createPreview(const QVariantMap &data, quint64 itemHash, QWidget *parent);
 
     signals:
         void itemWidgetCreated(const PersistentDisplayItem &selection);
@@ -146,6 +155,9 @@ class ItemDelegate final : public QItemDelegate
         int m_idealWidth;
 
         std::vector<std::shared_ptr<ItemWidget>> m_cache;
+
+        /// Cached widgets with their items while the model is being reordered.
+        std::vector<std::pair<QPersistentModelIndex, std::shared_ptr<ItemWidget>>> m_layoutCache;
 };
 
 #endif // ITEMDELEGATE_H
@@ -27,6 +27,7 @@
 #include "common/mimetypes.h"
 #include "common/regexp.h"
 #include "common/textdata.h"
+#include "item/itemjournal.h"
 #include "item/itemstore.h"
 #include "item/itemwidget.h"
 #include "item/serialize.h"
@@ -40,6 +41,7 @@
 #include <QModelIndex>
 #include <QSettings>
 #include <QPluginLoader>
+#include <QTextDocumentFragment>
 
 #include <algorithm>
 
@@ -56,6 +58,36 @@ bool priorityLessThan(const ItemLoaderPtr &lhs, const ItemLoaderPtr &rhs)
     return lhs->priority() > rhs->priority();
 }
 
+QString searchTextFromLoaders(const ItemLoaderList &loaders, const QVariantMap &data)
+{
+    QString text;
+
+    for ( const auto &loader : loaders ) {
+        const QString loaderText = loader->searchText(data);
+        if ( loaderText.isEmpty() )
+            continue;
+
+        if ( !text.isEmpty() )
+            text.append('\n');
+        text.append(loaderText);
+    }
+
+    return text;
+}
+
+/// Text must be case-folded if the literal pattern is case-insensitive.
+bool matchesSearchText(const LiteralMatcher &textMatcher, const QString &text)
+{
+    if ( textMatcher.isLiteral() )
+        return textMatcher.matchesSearchText(text);
+    return text.contains( textMatcher.regularExpression() );
+}
+
+bool needsFoldedSearchText(const LiteralMatcher &textMatcher)
+{
+    return textMatcher.isLiteral() && textMatcher.isCaseInsensitive();
+}
+
 void trySetPixmap(QLabel *label, const QVariantMap &data, int height)
 {
     const auto imageFormats = {
@@ -179,6 +211,10 @@ public:
     {
         return serializeData(model, file);
     }
+
+    bool canJournalItems() override { return true; }
+
+    bool canSaveItemsInBackground() override { return true; }
 };
 
 class DummyLoader final : public ItemLoaderInterface
@@ -215,10 +251,24 @@ public:
         return std::make_shared<DummySaver>();
     }
 
-    bool matches(const QModelIndex &index, const QRegularExpression &re) const override
+    QString searchText(const QVariantMap &data) const override
     {
-        const QString text = index.data(contentType::text).toString();
-        return text.contains(re);
+        if ( data.contains(mimeText) )
+            return getTextData(data, mimeText);
+
+        if ( data.contains(mimeUriList) )
+            return getTextData(data, mimeUriList);
+
+        const QString html = getTextData(data, mimeHtml);
+        if ( html.isEmpty() )
+            return QString();
+
+        return QTextDocumentFragment::fromHtml(html).toPlainText();
+    }
+
+    QStringList searchTextFormats() const override
+    {
+        return QStringList() << mimeText << mimeUriList << mimeHtml;
     }
 };
 
@@ -379,7 +429,9 @@ bool ItemFactory::isLoaderEnabled(const ItemLoaderPtr &loader) const
     return !m_disabledLoaders.contains(loader);
 }
 
-ItemSaverPtr ItemFactory::loadItems(const QString &tabName, QAbstractItemModel *model, QIODevice *file, int maxItems)
+ItemSaverPtr ItemFactory::loadItems(
+        const QString &tabName, QAbstractItemModel *model, QIODevice *file, int maxItems,
+        ItemJournal *journal)
 {
     auto loaders = enabledLoaders();
     for ( auto &loader : loaders ) {
@@ -390,6 +442,11 @@ ItemSaverPtr ItemFactory::loadItems(const QString &tabName, QAbstractItemModel *
             if (!saver)
                 return nullptr;
             file->close();
+
+            // Apply journal before other plugins start tracking changes in the model.
+            if ( journal && journal->isOpen() )
+                journal->replay(saver);
+
             saver = saveWithOther(tabName, model, saver, &loader, loaders, maxItems);
             return transformSaver(model, saver, loader, loaders);
         }
@@ -421,19 +478,69 @@ bool ItemFactory::matches(const QModelIndex &index, const QRegularExpression &re
     // Match formats if the filter expression contains single '/'.
     if (re.pattern().count('/') == 1) {
         const auto re2 = anchoredRegExp(re.pattern());
-        const QVariantMap data = index.data(contentType::data).toMap();
-        for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
-            if ( it.key().contains(re2) )
+        // Avoid reading data of items loaded lazily from tab file.
+        const QVariant mappedData = index.data(contentType::mappedData);
+        const QVariant item = mappedData.isValid() ? mappedData : index.data(contentType::data);
+        for ( const auto &format : snapshotItemFormats(item) ) {
+            if ( format.contains(re2) )
                 return true;
         }
     }
 
+    // Match cached search text (provided by all plugins) same as dataMatcher().
+    const auto textMatcher = literalMatcher(re);
+    const QString searchText = index.data(
+                needsFoldedSearchText(*textMatcher) ? contentType::foldedSearchText : contentType::searchText ).toString();
+    return matchesSearchText(*textMatcher, searchText);
+}
+
+ItemFactory::DataMatcher ItemFactory::dataMatcher(const QRegularExpression &re) const
+{
+    const bool matchFormats = re.pattern().count('/') == 1;
+    const auto formatRe = matchFormats ? anchoredRegExp(re.pattern()) : QRegularExpression();
+    const auto textMatcher = literalMatcher(re);
+    const auto createSearchText = searchTextFunction();
+
+    return [textMatcher, createSearchText, matchFormats, formatRe](const QVariant &item) {
+        if (matchFormats) {
+            for ( const auto &format : snapshotItemFormats(item) ) {
+                if ( format.contains(formatRe) )
+                    return true;
+            }
+        }
+
+        const QString searchText = createSearchText(item);
+        return matchesSearchText(
+            *textMatcher, needsFoldedSearchText(*textMatcher) ? searchText.toCaseFolded() : searchText );
+    };
+}
+
+ItemFactory::SnapshotSearchTextFunction ItemFactory::searchTextFunction() const
+{
+    const auto loaders = enabledLoaders();
+    const auto formats = searchTextFormats();
+    return [loaders, formats](const QVariant &item) {
+        return searchTextFromLoaders( loaders, snapshotItemData(item, formats) );
+    };
+}
+
+QString ItemFactory::searchText(const QVariantMap &data) const
+{
+    return searchTextFromLoaders( enabledLoaders(), data );
+}
+
+QStringList ItemFactory::searchTextFormats() const
+{
+    QStringList formats;
+
     for ( const auto &loader : enabledLoaders() ) {
-        if ( isLoaderEnabled(loader) && loader->matches(index, re) )
-            return true;
+        for ( const auto &format : loader->searchTextFormats() ) {
+            if ( !formats.contains(format) )
+                formats.append(format);
+        }
     }
 
-    return false;
+    return formats;
 }
 
 QList<ItemScriptable*> ItemFactory::scriptableObjects() const
@@ -588,6 +695,13 @@ ItemLoaderList ItemFactory::enabledLoaders(bool enabled) const
     return loaders;
 }
 
+std::shared_ptr<const LiteralMatcher> ItemFactory::literalMatcher(const QRegularExpression &re) const
+{
+    if ( !m_literalMatcher || m_literalMatcher->regularExpression() != re )
+        m_literalMatcher = std::make_shared<const LiteralMatcher>(re);
+    return m_literalMatcher;
+}
+
 ItemWidget *ItemFactory::transformItem(ItemWidget *item, const QVariantMap &data)
 {
     for (auto &loader : m_loaders) {
@@ -27,10 +27,13 @@
 #include <QSet>
 #include <QVector>
 
+#include <functional>
 #include <memory>
 
+class ItemJournal;
 class ItemLoaderInterface;
 class ItemWidget;
+class LiteralMatcher;
 class ScriptableProxy;
 class QAbstractItemModel;
 class QIODevice;
@@ -109,10 +112,12 @@ public:
     bool hasLoaders() const { return !m_loaders.isEmpty(); }
 
     /**
-     * Load items using a plugin.
+     * Load items using a plugin and apply changes from opened @a journal.
      * @return the first plugin (or nullptr) for which ItemLoaderInterface::loadItems() returned true
      */
-    ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel *model, QIODevice *file, int maxItems);
+    ItemSaverPtr loadItems(
+            const QString &tabName, QAbstractItemModel *model, QIODevice *file, int maxItems,
+            ItemJournal *journal = nullptr);
 
     /**
      * Initialize tab.
@@ -121,10 +126,41 @@ public:
     ItemSaverPtr initializeTab(const QString &tabName, QAbstractItemModel *model, int maxItems);
 
     /**
-     * Return true only if any plugin (ItemLoaderInterface::matches()) returns true;
+     * Return true only if item format or search text (see searchText()) matches.
      */
     bool matches(const QModelIndex &index, const QRegularExpression &re) const;
 
+    /// Matches item from ItemDataSnapshot.
+    using DataMatcher = std::function<bool(const QVariant &item)>;
+
+    /**
+     * Return function which matches item data same as matches() using
+     * search text of currently enabled plugins.
+     *
+     * The function can be called from any thread.
+     */
+    DataMatcher dataMatcher(const QRegularExpression &re) const;
+
+    /// Returns search text of item from ItemDataSnapshot.
+    using SnapshotSearchTextFunction = std::function<QString(const QVariant &item)>;
+
+    /**
+     * Return function which creates same text as searchText() for item
+     * from ItemDataSnapshot (only formats used by the text are read).
+     *
+     * The function can be called from any thread.
+     */
+    SnapshotSearchTextFunction searchTextFunction() const;
+
+    /**
+     * Return searchable text of item data (ItemLoaderInterface::searchText()
+     * of currently enabled plugins separated by new line).
+     */
+    QString searchText(const QVariantMap &data) const;
+
+    /// Return formats used by searchText() (ItemLoaderInterface::searchTextFormats()).
+    QStringList searchTextFormats() const;
+
     QList<ItemScriptable*> scriptableObjects() const;
 
     /**
@@ -160,10 +196,14 @@ private:
 
     void addLoader(const ItemLoaderPtr &loader);
 
+    /** Return matcher for item text (cached for the last regular expression). */
+    std::shared_ptr<const LiteralMatcher> literalMatcher(const QRegularExpression &re) const;
+
     ItemLoaderList m_loaders;
     ItemLoaderPtr m_dummyLoader;
     ItemLoaderList m_disabledLoaders;
     QMap<QObject *, ItemLoaderPtr> m_loaderChildren;
+    mutable std::shared_ptr<const LiteralMatcher> m_literalMatcher;
 };
 
 #endif // ITEMFACTORY_H
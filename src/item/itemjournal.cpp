@@ -0,0 +1,503 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemjournal.h"
+
+#include "common/contenttype.h"
+#include "common/log.h"
+#include "item/serialize.h"
+
+#include <QAbstractItemModel>
+#include <QByteArray>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+
+namespace {
+
+const char journalHeader[] = "CopyQ journal v1";
+
+// Journal is compacted (all items are saved again) if it grows over half of
+// the tab file size but not before it reaches this size.
+const qint64 minJournalSizeToCompact = 1024 * 1024;
+
+enum RecordType {
+    RecordInsert = 1,
+    RecordChange = 2,
+    RecordRemove = 3,
+    RecordMove = 4
+};
+
+struct TabFileId {
+    qint64 size = -1;
+    qint64 modified = -1;
+    qint32 rowCount = 0;
+};
+
+TabFileId tabFileId(const QString &tabFileName)
+{
+    const QFileInfo info(tabFileName);
+    TabFileId id;
+    if ( info.exists() ) {
+        id.size = info.size();
+        id.modified = info.lastModified().toMSecsSinceEpoch();
+    }
+    return id;
+}
+
+void writeHeader(QDataStream *stream, const TabFileId &id)
+{
+    *stream << QByteArray(journalHeader) << id.size << id.modified << id.rowCount;
+}
+
+bool readHeader(QDataStream *stream, TabFileId *id)
+{
+    QByteArray header;
+    *stream >> header >> id->size >> id->modified >> id->rowCount;
+    return stream->status() == QDataStream::Ok && header == journalHeader;
+}
+
+bool applyRecord(QAbstractItemModel *model, const QByteArray &bytes)
+{
+    QDataStream stream(bytes);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    qint32 type;
+    qint32 row;
+    stream >> type >> row;
+    if ( stream.status() != QDataStream::Ok || row < 0 )
+        return false;
+
+    const int rowCount = model->rowCount();
+
+    switch (type) {
+    case RecordInsert:
+    case RecordChange: {
+        QVariantMap data;
+        if ( !deserializeData(&stream, &data) )
+            return false;
+
+        if (type == RecordInsert) {
+            if ( row > rowCount || !model->insertRow(row) )
+                return false;
+        } else if (row >= rowCount) {
+            return false;
+        }
+
+        return model->setData( model->index(row, 0), data, contentType::data );
+    }
+
+    case RecordRemove: {
+        qint32 count;
+        stream >> count;
+        return stream.status() == QDataStream::Ok
+            && model->removeRows(row, count);
+    }
+
+    case RecordMove: {
+        qint32 count;
+        qint32 destinationRow;
+        stream >> count >> destinationRow;
+        return stream.status() == QDataStream::Ok
+            && model->moveRows(QModelIndex(), row, count, QModelIndex(), destinationRow);
+    }
+    }
+
+    return false;
+}
+
+} // namespace
+
+ItemJournal::ItemJournal(QAbstractItemModel *model, QObject *parent)
+    : QObject(parent)
+    , m_model(model)
+{
+    connect( model, &QAbstractItemModel::rowsInserted,
+             this, &ItemJournal::onRowsInserted );
+    connect( model, &QAbstractItemModel::rowsRemoved,
+             this, &ItemJournal::onRowsRemoved );
+    connect( model, &QAbstractItemModel::rowsMoved,
+             this, &ItemJournal::onRowsMoved );
+    connect( model, &QAbstractItemModel::dataChanged,
+             this, &ItemJournal::onDataChanged );
+
+    // Changes which cannot be journaled require saving all items.
+    connect( model, &QAbstractItemModel::layoutChanged,
+             this, &ItemJournal::close );
+    connect( model, &QAbstractItemModel::modelReset,
+             this, &ItemJournal::close );
+}
+
+bool ItemJournal::open(const QString &tabFileName)
+{
+    close();
+    m_needsFullSave = false;
+
+    QFile file( itemJournalFileName(tabFileName) );
+    if ( !file.exists() )
+        return false;
+
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        log( QString("Failed to open journal %1: %2")
+             .arg(file.fileName(), file.errorString()), LogError );
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    TabFileId id;
+    if ( !readHeader(&stream, &id) ) {
+        log( QString("Corrupted journal %1").arg(file.fileName()), LogWarning );
+        return false;
+    }
+
+    const TabFileId currentId = tabFileId(tabFileName);
+    if (id.size != currentId.size || id.modified != currentId.modified) {
+        COPYQ_LOG( QString("Ignoring outdated journal %1").arg(file.fileName()) );
+        return false;
+    }
+
+    m_tabFileName = tabFileName;
+    m_baseSize = id.size;
+    m_baseModified = id.modified;
+    m_baseRowCount = id.rowCount;
+    m_open = true;
+
+    return true;
+}
+
+bool ItemJournal::replay(const ItemSaverPtr &saver)
+{
+    if (!m_open || !m_model)
+        return false;
+
+    if ( !saver || !saver->canJournalItems() ) {
+        COPYQ_LOG( QString("Ignoring journal for %1 (unsupported by plugin)").arg(m_tabFileName) );
+        close();
+        return false;
+    }
+
+    if ( m_model->rowCount() != m_baseRowCount ) {
+        log( QString("Ignoring journal for %1 (expected %2 items but %3 loaded)")
+             .arg(m_tabFileName)
+             .arg(m_baseRowCount)
+             .arg(m_model->rowCount()), LogWarning );
+        close();
+        return false;
+    }
+
+    QFile file( itemJournalFileName(m_tabFileName) );
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        log( QString("Failed to open journal %1: %2")
+             .arg(file.fileName(), file.errorString()), LogError );
+        close();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    TabFileId id;
+    readHeader(&stream, &id);
+
+    int recordCount = 0;
+    QByteArray bytes;
+    while ( !stream.atEnd() ) {
+        stream >> bytes;
+
+        // Last record may be incomplete if application crashed while saving.
+        if ( stream.status() != QDataStream::Ok ) {
+            log( QString("Journal %1 is incomplete, %2 changes applied")
+                 .arg(file.fileName())
+                 .arg(recordCount), LogWarning );
+            close();
+            m_needsFullSave = true;
+            return false;
+        }
+
+        if ( !applyRecord(m_model, bytes) ) {
+            log( QString("Failed to apply change %1 from journal %2")
+                 .arg(recordCount)
+                 .arg(file.fileName()), LogError );
+            close();
+            m_needsFullSave = true;
+            return false;
+        }
+
+        ++recordCount;
+    }
+
+    COPYQ_LOG( QString("Applied %1 changes from journal %2")
+               .arg(recordCount)
+               .arg(file.fileName()) );
+
+    m_records.clear();
+    return true;
+}
+
+bool ItemJournal::append(const QString &tabFileName)
+{
+    if ( !m_open || tabFileName != m_tabFileName || !isTabFileUnchanged() )
+        return false;
+
+    if ( m_records.isEmpty() )
+        return true;
+
+    QFile file( itemJournalFileName(m_tabFileName) );
+    const qint64 journalSize = file.size();
+    if ( journalSize > qMax(minJournalSizeToCompact, m_baseSize / 2) ) {
+        COPYQ_LOG( QString("Compacting journal %1").arg(file.fileName()) );
+        return false;
+    }
+
+    if ( !file.open(QIODevice::WriteOnly | QIODevice::Append) ) {
+        log( QString("Failed to open journal %1: %2")
+             .arg(file.fileName(), file.errorString()), LogError );
+        close();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    if (journalSize == 0) {
+        TabFileId id;
+        id.size = m_baseSize;
+        id.modified = m_baseModified;
+        id.rowCount = m_baseRowCount;
+        writeHeader(&stream, id);
+    }
+
+    for (const auto &record : m_records) {
+        QByteArray bytes;
+        {
+            QDataStream recordStream(&bytes, QIODevice::WriteOnly);
+            recordStream.setVersion(QDataStream::Qt_4_7);
+            recordStream << static_cast<qint32>(record.type)
+                         << static_cast<qint32>(record.row);
+
+            if (record.type == RecordInsert || record.type == RecordChange)
+                serializeEncodedData(&recordStream, record.data);
+            else if (record.type == RecordRemove)
+                recordStream << static_cast<qint32>(record.count);
+            else
+                recordStream << static_cast<qint32>(record.count)
+                             << static_cast<qint32>(record.destinationRow);
+        }
+        stream << bytes;
+    }
+
+    if ( stream.status() != QDataStream::Ok || !file.flush() ) {
+        log( QString("Failed to write journal %1: %2")
+             .arg(file.fileName(), file.errorString()), LogError );
+        close();
+        return false;
+    }
+
+    COPYQ_LOG( QString("Appended %1 changes to journal %2")
+               .arg(m_records.size())
+               .arg(file.fileName()) );
+
+    m_records.clear();
+    return true;
+}
+
+void ItemJournal::reset(const QString &tabFileName, const ItemSaverPtr &saver)
+{
+    close();
+    m_needsFullSave = false;
+
+    const QString journalFileName = itemJournalFileName(tabFileName);
+    if ( QFile::exists(journalFileName) && !QFile::remove(journalFileName) ) {
+        log( QString("Failed to remove journal %1").arg(journalFileName), LogError );
+        return;
+    }
+
+    if ( !m_model || !saver || !saver->canJournalItems() )
+        return;
+
+    const TabFileId id = tabFileId(tabFileName);
+    if (id.size < 0)
+        return;
+
+    m_tabFileName = tabFileName;
+    m_baseSize = id.size;
+    m_baseModified = id.modified;
+    m_baseRowCount = m_model->rowCount();
+    m_open = true;
+}
+
+void ItemJournal::startFullSave(const QString &tabFileName, int saveId, const ItemSaverPtr &saver)
+{
+    close();
+    m_needsFullSave = false;
+
+    if ( !m_model || !saver || !saver->canJournalItems() )
+        return;
+
+    // Changes are recorded relative to the saved items.
+    m_tabFileName = tabFileName;
+    m_baseRowCount = m_model->rowCount();
+    m_pendingSaveId = saveId;
+}
+
+void ItemJournal::onItemsSaved(const QString &tabFileName, int saveId, bool success)
+{
+    if ( saveId != m_pendingSaveId || tabFileName != m_tabFileName )
+        return;
+
+    m_pendingSaveId = 0;
+
+    const TabFileId id = tabFileId(tabFileName);
+    if (!success || id.size < 0) {
+        close();
+        return;
+    }
+
+    m_baseSize = id.size;
+    m_baseModified = id.modified;
+    m_open = true;
+}
+
+void ItemJournal::close()
+{
+    m_open = false;
+    m_pendingSaveId = 0;
+    m_records.clear();
+}
+
+void ItemJournal::onRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (!isRecording() || parent.isValid())
+        return;
+
+    for (int row = first; row <= last; ++row)
+        addRecord(RecordInsert, row);
+}
+
+void ItemJournal::onRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (!isRecording() || parent.isValid())
+        return;
+
+    addRecord(RecordRemove, first, last - first + 1);
+}
+
+void ItemJournal::onRowsMoved(
+        const QModelIndex &sourceParent, int sourceStart, int sourceEnd,
+        const QModelIndex &destinationParent, int destinationRow)
+{
+    if (!isRecording() || sourceParent.isValid() || destinationParent.isValid())
+        return;
+
+    addRecord(RecordMove, sourceStart, sourceEnd - sourceStart + 1, destinationRow);
+}
+
+void ItemJournal::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if ( !isRecording() )
+        return;
+
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row)
+        addRecord(RecordChange, row);
+}
+
+void ItemJournal::addRecord(int type, int row, int count, int destinationRow)
+{
+    QVariantMap data;
+    if (type == RecordInsert || type == RecordChange) {
+        data = m_model->index(row, 0).data(contentType::data).toMap();
+
+        // Only the latest data are needed if the item was just added or changed.
+        if ( type == RecordChange && !m_records.isEmpty() ) {
+            auto &last = m_records.last();
+            if ( last.row == row && (last.type == RecordInsert || last.type == RecordChange) ) {
+                last.data = data;
+                return;
+            }
+        }
+    }
+
+    m_records.append( Record{type, row, count, destinationRow, data} );
+}
+
+bool ItemJournal::isTabFileUnchanged() const
+{
+    const TabFileId id = tabFileId(m_tabFileName);
+    return id.size == m_baseSize && id.modified == m_baseModified;
+}
+
+QString itemJournalFileName(const QString &tabFileName)
+{
+    return tabFileName + ".journal";
+}
+
+bool moveItemJournal(const QString &oldTabFileName, const QString &newTabFileName)
+{
+    QFile oldJournal( itemJournalFileName(oldTabFileName) );
+    if ( !oldJournal.exists() )
+        return true;
+
+    if ( !oldJournal.open(QIODevice::ReadOnly) ) {
+        log( QString("Failed to open journal %1: %2")
+             .arg(oldJournal.fileName(), oldJournal.errorString()), LogError );
+        return false;
+    }
+
+    QDataStream in(&oldJournal);
+    in.setVersion(QDataStream::Qt_4_7);
+
+    TabFileId id;
+    const TabFileId oldId = tabFileId(oldTabFileName);
+    if ( !readHeader(&in, &id) || id.size != oldId.size || id.modified != oldId.modified ) {
+        oldJournal.close();
+        oldJournal.remove();
+        return true;
+    }
+
+    QFile newJournal( itemJournalFileName(newTabFileName) );
+    if ( !newJournal.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+        log( QString("Failed to create journal %1: %2")
+             .arg(newJournal.fileName(), newJournal.errorString()), LogError );
+        return false;
+    }
+
+    TabFileId newId = tabFileId(newTabFileName);
+    newId.rowCount = id.rowCount;
+
+    QDataStream out(&newJournal);
+    out.setVersion(QDataStream::Qt_4_7);
+    writeHeader(&out, newId);
+
+    if ( out.status() != QDataStream::Ok
+         || newJournal.write( oldJournal.readAll() ) == -1
+         || !newJournal.flush() )
+    {
+        log( QString("Failed to write journal %1: %2")
+             .arg(newJournal.fileName(), newJournal.errorString()), LogError );
+        newJournal.remove();
+        return false;
+    }
+
+    oldJournal.close();
+    oldJournal.remove();
+    return true;
+}
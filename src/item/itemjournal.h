@@ -0,0 +1,153 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ITEMJOURNAL_H
+#define ITEMJOURNAL_H
+
+#include "item/itemwidget.h"
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+class QAbstractItemModel;
+class QModelIndex;
+
+/**
+ * Records changes in item model so these can be appended to a journal file
+ * instead of saving all items after each change.
+ *
+ * Journal file belongs to a specific tab file (identified by its size and
+ * modification time). It is replayed after loading items from the tab file
+ * and dropped whenever all items are saved again (compaction).
+ */
+class ItemJournal final : public QObject
+{
+public:
+    explicit ItemJournal(QAbstractItemModel *model, QObject *parent = nullptr);
+
+    /**
+     * Open existing journal for given tab file.
+     *
+     * @return true only if journal exists and belongs to the tab file
+     */
+    bool open(const QString &tabFileName);
+
+    /**
+     * Number of items in tab file when the journal was started.
+     *
+     * All these items must be loaded before calling replay().
+     */
+    int baseRowCount() const { return m_baseRowCount; }
+
+    /**
+     * Apply changes from opened journal on items loaded from tab file.
+     *
+     * Journal is closed if the saver doesn't support journaling or on failure.
+     *
+     * If replay stops at an incomplete or invalid change, the changes applied
+     * so far stay in the model and needsFullSave() returns true.
+     *
+     * @return true only if all changes were applied
+     */
+    bool replay(const ItemSaverPtr &saver);
+
+    /**
+     * Return true if all items must be saved soon (journal is damaged).
+     *
+     * Reset when a new journal is opened or started.
+     */
+    bool needsFullSave() const { return m_needsFullSave; }
+
+    /**
+     * Append recorded changes to the journal file.
+     *
+     * @return false if all items must be saved instead (journal is closed,
+     *         too large or belongs to a different tab file)
+     */
+    bool append(const QString &tabFileName);
+
+    /**
+     * Start new journal after all items were saved to the tab file.
+     */
+    void reset(const QString &tabFileName, const ItemSaverPtr &saver);
+
+    /**
+     * Start recording changes while all items are saved in background.
+     *
+     * New journal is started with the recorded changes once onItemsSaved()
+     * is called with the same save ID.
+     */
+    void startFullSave(const QString &tabFileName, int saveId, const ItemSaverPtr &saver);
+
+    /// Called when items were saved in background (see ItemSaveQueue).
+    void onItemsSaved(const QString &tabFileName, int saveId, bool success);
+
+    /**
+     * Stop recording changes; next save stores all items.
+     */
+    void close();
+
+    bool isOpen() const { return m_open; }
+
+    bool isRecording() const { return m_open || m_pendingSaveId != 0; }
+
+private:
+    struct Record {
+        int type;
+        int row;
+        int count;
+        int destinationRow;
+        QVariantMap data;
+    };
+
+    void onRowsInserted(const QModelIndex &parent, int first, int last);
+    void onRowsRemoved(const QModelIndex &parent, int first, int last);
+    void onRowsMoved(const QModelIndex &sourceParent, int sourceStart, int sourceEnd,
+                     const QModelIndex &destinationParent, int destinationRow);
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+
+    void addRecord(int type, int row, int count = 1, int destinationRow = -1);
+
+    bool isTabFileUnchanged() const;
+
+    QPointer<QAbstractItemModel> m_model;
+    QString m_tabFileName;
+    qint64 m_baseSize = -1;
+    qint64 m_baseModified = -1;
+    int m_baseRowCount = 0;
+    bool m_open = false;
+    bool m_needsFullSave = false;
+    int m_pendingSaveId = 0;
+    QVector<Record> m_records;
+};
+
+/// @return Journal file name for given tab file.
+QString itemJournalFileName(const QString &tabFileName);
+
+/**
+ * Move journal to a copy of the tab file.
+ *
+ * @return true if there is no valid journal or it was moved successfully
+ */
+bool moveItemJournal(const QString &oldTabFileName, const QString &newTabFileName);
+
+#endif // ITEMJOURNAL_H
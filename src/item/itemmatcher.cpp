@@ -0,0 +1,271 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemmatcher.h"
+
+#include "common/fuzzymatcher.h"
+
+#include <QRegularExpression>
+#include <QRunnable>
+
+namespace {
+
+// The first chunk is small so the top items are shown early.
+const int firstChunkSize = 256;
+const int chunkSize = 2048;
+
+class MatchRunnable final : public QRunnable
+{
+public:
+    MatchRunnable(
+            ItemMatcher *matcher, int matchId, int firstRow, int chunkStart, int chunkEnd,
+            const ItemDataSnapshot &items, const ItemFactory::DataMatcher &dataMatcher,
+            const std::shared_ptr<QAtomicInt> &cancelled)
+        : m_matcher(matcher)
+        , m_matchId(matchId)
+        , m_firstRow(firstRow)
+        , m_chunkStart(chunkStart)
+        , m_chunkEnd(chunkEnd)
+        , m_items(items)
+        , m_dataMatcher(dataMatcher)
+        , m_cancelled(cancelled)
+    {
+    }
+
+    void run() override
+    {
+        QBitArray matches(m_chunkEnd - m_chunkStart);
+        for (int i = m_chunkStart; i < m_chunkEnd; ++i) {
+            if ( m_cancelled->load() )
+                return;
+
+            // Skipped item.
+            if ( !m_items[i].isValid() )
+                continue;
+
+            if ( m_dataMatcher(m_items[i]) )
+                matches.setBit(i - m_chunkStart);
+        }
+
+        emit m_matcher->chunkMatched(m_matchId, m_firstRow + m_chunkStart, matches);
+    }
+
+private:
+    ItemMatcher *m_matcher;
+    int m_matchId;
+    int m_firstRow;
+    int m_chunkStart;
+    int m_chunkEnd;
+    ItemDataSnapshot m_items;
+    ItemFactory::DataMatcher m_dataMatcher;
+    std::shared_ptr<QAtomicInt> m_cancelled;
+};
+
+class FuzzyScoreRunnable final : public QRunnable
+{
+public:
+    FuzzyScoreRunnable(
+            ItemMatcher *matcher, int matchId, int firstRow, int chunkStart, int chunkEnd,
+            const ItemDataSnapshot &items, const QString &pattern,
+            const ItemFactory::SnapshotSearchTextFunction &searchText,
+            const std::shared_ptr<QAtomicInt> &cancelled)
+        : m_matcher(matcher)
+        , m_matchId(matchId)
+        , m_firstRow(firstRow)
+        , m_chunkStart(chunkStart)
+        , m_chunkEnd(chunkEnd)
+        , m_items(items)
+        , m_pattern(pattern)
+        , m_searchText(searchText)
+        , m_cancelled(cancelled)
+    {
+    }
+
+    void run() override
+    {
+        const FuzzyMatcher fuzzyMatcher(m_pattern);
+        QVector<int> scores(m_chunkEnd - m_chunkStart);
+        for (int i = m_chunkStart; i < m_chunkEnd; ++i) {
+            if ( m_cancelled->load() )
+                return;
+
+            // Skipped item.
+            if ( !m_items[i].isValid() )
+                continue;
+
+            const QString text = m_searchText(m_items[i]).toCaseFolded();
+            scores[i - m_chunkStart] = fuzzyMatcher.score(text, m_firstRow + i);
+        }
+
+        emit m_matcher->chunkScored(m_matchId, m_firstRow + m_chunkStart, scores);
+    }
+
+private:
+    ItemMatcher *m_matcher;
+    int m_matchId;
+    int m_firstRow;
+    int m_chunkStart;
+    int m_chunkEnd;
+    ItemDataSnapshot m_items;
+    QString m_pattern;
+    ItemFactory::SnapshotSearchTextFunction m_searchText;
+    std::shared_ptr<QAtomicInt> m_cancelled;
+};
+
+class CountRunnable final : public QRunnable
+{
+public:
+    CountRunnable(
+            ItemMatcher *matcher, int matchId, int index,
+            const ItemSearchIndex::Data &data, const QRegularExpression &re,
+            const std::shared_ptr<QAtomicInt> &cancelled)
+        : m_matcher(matcher)
+        , m_matchId(matchId)
+        , m_index(index)
+        , m_data(data)
+        , m_re(re)
+        , m_cancelled(cancelled)
+    {
+    }
+
+    void run() override
+    {
+        if ( m_cancelled->load() )
+            return;
+
+        emit m_matcher->indexCounted( m_matchId, m_index, m_data.search(m_re).size() );
+    }
+
+private:
+    ItemMatcher *m_matcher;
+    int m_matchId;
+    int m_index;
+    ItemSearchIndex::Data m_data;
+    QRegularExpression m_re;
+    std::shared_ptr<QAtomicInt> m_cancelled;
+};
+
+} // namespace
+
+ItemMatcher::ItemMatcher(QObject *parent)
+    : QObject(parent)
+{
+    connect( this, &ItemMatcher::chunkMatched,
+             this, &ItemMatcher::onChunkMatched, Qt::QueuedConnection );
+    connect( this, &ItemMatcher::chunkScored,
+             this, &ItemMatcher::onChunkScored, Qt::QueuedConnection );
+    connect( this, &ItemMatcher::indexCounted,
+             this, &ItemMatcher::onIndexCounted, Qt::QueuedConnection );
+}
+
+ItemMatcher::~ItemMatcher()
+{
+    cancel();
+    m_threadPool.waitForDone();
+}
+
+void ItemMatcher::start(const ItemDataSnapshot &items, int firstRow, const ItemFactory::DataMatcher &matcher)
+{
+    cancel();
+
+    m_cancelled = std::make_shared<QAtomicInt>(0);
+
+    for (int chunkStart = 0; chunkStart < items.size(); ) {
+        const int size = chunkStart == 0 ? firstChunkSize : chunkSize;
+        const int chunkEnd = qMin(items.size(), chunkStart + size);
+        m_threadPool.start( new MatchRunnable(
+            this, m_matchId, firstRow, chunkStart, chunkEnd, items, matcher, m_cancelled) );
+        ++m_pendingChunks;
+        chunkStart = chunkEnd;
+    }
+}
+
+void ItemMatcher::startScoring(
+        const ItemDataSnapshot &items, int firstRow, const QString &pattern,
+        const ItemFactory::SnapshotSearchTextFunction &searchText)
+{
+    cancel();
+
+    m_cancelled = std::make_shared<QAtomicInt>(0);
+
+    for (int chunkStart = 0; chunkStart < items.size(); ) {
+        const int size = chunkStart == 0 ? firstChunkSize : chunkSize;
+        const int chunkEnd = qMin(items.size(), chunkStart + size);
+        m_threadPool.start( new FuzzyScoreRunnable(
+            this, m_matchId, firstRow, chunkStart, chunkEnd, items, pattern, searchText, m_cancelled) );
+        ++m_pendingChunks;
+        chunkStart = chunkEnd;
+    }
+}
+
+void ItemMatcher::startCounting(const QVector<ItemSearchIndex::Data> &indexes, const QRegularExpression &re)
+{
+    cancel();
+
+    m_cancelled = std::make_shared<QAtomicInt>(0);
+
+    for (int i = 0; i < indexes.size(); ++i) {
+        m_threadPool.start( new CountRunnable(this, m_matchId, i, indexes[i], re, m_cancelled) );
+        ++m_pendingChunks;
+    }
+}
+
+void ItemMatcher::cancel()
+{
+    if (m_cancelled)
+        m_cancelled->store(1);
+
+    // Ignore results which are already queued.
+    ++m_matchId;
+    m_pendingChunks = 0;
+}
+
+void ItemMatcher::onChunkMatched(int matchId, int firstRow, const QBitArray &matches)
+{
+    if (matchId != m_matchId)
+        return;
+
+    emit matched(firstRow, matches);
+    finishChunk();
+}
+
+void ItemMatcher::onChunkScored(int matchId, int firstRow, const QVector<int> &scores)
+{
+    if (matchId != m_matchId)
+        return;
+
+    emit scored(firstRow, scores);
+    finishChunk();
+}
+
+void ItemMatcher::onIndexCounted(int matchId, int index, int count)
+{
+    if (matchId != m_matchId)
+        return;
+
+    emit counted(index, count);
+    finishChunk();
+}
+
+void ItemMatcher::finishChunk()
+{
+    --m_pendingChunks;
+    if (m_pendingChunks == 0)
+        emit finished();
+}
@@ -0,0 +1,113 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ITEMMATCHER_H
+#define ITEMMATCHER_H
+
+#include "item/itemfactory.h"
+#include "item/itemsearchindex.h"
+#include "item/serialize.h"
+
+#include <QBitArray>
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+
+#include <memory>
+
+/**
+ * Matches items from a snapshot in background threads.
+ *
+ * Items are split into chunks; result for each chunk is reported with
+ * matched() in the main thread as soon as it is available.
+ *
+ * Can also score items for fuzzy filter (see FuzzyMatcher) and count
+ * matching items in search indexes of multiple tabs.
+ */
+class ItemMatcher final : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ItemMatcher(QObject *parent = nullptr);
+
+    /// Cancels matching and waits for background threads.
+    ~ItemMatcher();
+
+    /**
+     * Start matching items from given row (previous matching is cancelled).
+     *
+     * Invalid items in snapshot are skipped (reported as not matching).
+     */
+    void start(const ItemDataSnapshot &items, int firstRow, const ItemFactory::DataMatcher &matcher);
+
+    /**
+     * Start scoring items from given row with fuzzy @a pattern (previous
+     * matching is cancelled).
+     *
+     * Scores are reported with scored(), invalid items in snapshot get zero.
+     */
+    void startScoring(
+            const ItemDataSnapshot &items, int firstRow, const QString &pattern,
+            const ItemFactory::SnapshotSearchTextFunction &searchText);
+
+    /**
+     * Start counting items matching @a re in search indexes (previous
+     * matching is cancelled).
+     *
+     * Number of matching items in each index is reported with counted().
+     */
+    void startCounting(const QVector<ItemSearchIndex::Data> &indexes, const QRegularExpression &re);
+
+    /// Cancel matching; no more results are reported.
+    void cancel();
+
+    bool isRunning() const { return m_pendingChunks > 0; }
+
+signals:
+    /// Bits are set for matching items starting at @a firstRow.
+    void matched(int firstRow, const QBitArray &matches);
+
+    /// Scores of items starting at @a firstRow (zero if not matching).
+    void scored(int firstRow, const QVector<int> &scores);
+
+    /// Number of matching items in index passed to startCounting().
+    void counted(int index, int count);
+
+    /// All items were matched.
+    void finished();
+
+    /// Internal signals emitted from background threads.
+    void chunkMatched(int matchId, int firstRow, const QBitArray &matches);
+    void chunkScored(int matchId, int firstRow, const QVector<int> &scores);
+    void indexCounted(int matchId, int index, int count);
+
+private:
+    void onChunkMatched(int matchId, int firstRow, const QBitArray &matches);
+    void onChunkScored(int matchId, int firstRow, const QVector<int> &scores);
+    void onIndexCounted(int matchId, int index, int count);
+    void finishChunk();
+
+    QThreadPool m_threadPool;
+    std::shared_ptr<QAtomicInt> m_cancelled;
+    int m_matchId = 0;
+    int m_pendingChunks = 0;
+};
+
+#endif // ITEMMATCHER_H
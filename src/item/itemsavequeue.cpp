@@ -0,0 +1,143 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemsavequeue.h"
+
+#include <QRunnable>
+#include <QThread>
+
+namespace {
+
+// Queueing more saves blocks until some finish.
+const int maxPendingSaves = 16;
+
+const int maxSaveThreads = 4;
+
+class SaveRunnable final : public QRunnable
+{
+public:
+    explicit SaveRunnable(const std::function<void()> &run)
+        : m_run(run)
+    {
+    }
+
+    void run() override
+    {
+        m_run();
+    }
+
+private:
+    std::function<void()> m_run;
+};
+
+} // namespace
+
+ItemSaveQueue::ItemSaveQueue(QObject *parent)
+    : QObject(parent)
+{
+    m_threadPool.setMaxThreadCount( qBound(1, QThread::idealThreadCount(), maxSaveThreads) );
+}
+
+ItemSaveQueue::~ItemSaveQueue()
+{
+    waitForSaved();
+    m_threadPool.waitForDone();
+}
+
+int ItemSaveQueue::save(const QString &tabFileName, const SaveFunction &saveFunction)
+{
+    QMutexLocker lock(&m_mutex);
+
+    const int saveId = ++m_lastSaveId;
+
+    for (auto &job : m_queue) {
+        if (job.tabFileName == tabFileName) {
+            job.saveId = saveId;
+            job.save = saveFunction;
+            return saveId;
+        }
+    }
+
+    while ( m_queue.size() + m_running.size() >= maxPendingSaves )
+        m_jobFinished.wait(&m_mutex);
+
+    m_queue.append( Job{tabFileName, saveId, saveFunction} );
+    startJobs();
+
+    return saveId;
+}
+
+bool ItemSaveQueue::waitForSaved(const QString &tabFileName)
+{
+    QMutexLocker lock(&m_mutex);
+
+    while ( isPending(tabFileName) )
+        m_jobFinished.wait(&m_mutex);
+
+    return tabFileName.isEmpty() ? m_failed.isEmpty() : !m_failed.contains(tabFileName);
+}
+
+void ItemSaveQueue::startJobs()
+{
+    for (auto it = m_queue.begin(); it != m_queue.end(); ) {
+        if ( m_running.contains(it->tabFileName) ) {
+            ++it;
+            continue;
+        }
+
+        const Job job = *it;
+        it = m_queue.erase(it);
+        m_running.insert(job.tabFileName);
+        m_threadPool.start( new SaveRunnable([this, job]() { runJob(job); }) );
+    }
+}
+
+void ItemSaveQueue::runJob(const Job &job)
+{
+    const bool success = job.save();
+
+    {
+        QMutexLocker lock(&m_mutex);
+        m_running.remove(job.tabFileName);
+        if (success)
+            m_failed.remove(job.tabFileName);
+        else
+            m_failed.insert(job.tabFileName);
+        startJobs();
+        m_jobFinished.wakeAll();
+    }
+
+    emit itemsSaved(job.tabFileName, job.saveId, success);
+}
+
+bool ItemSaveQueue::isPending(const QString &tabFileName) const
+{
+    if ( tabFileName.isEmpty() )
+        return !m_queue.isEmpty() || !m_running.isEmpty();
+
+    if ( m_running.contains(tabFileName) )
+        return true;
+
+    for (const auto &job : m_queue) {
+        if (job.tabFileName == tabFileName)
+            return true;
+    }
+
+    return false;
+}
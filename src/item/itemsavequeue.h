@@ -0,0 +1,94 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ITEMSAVEQUEUE_H
+#define ITEMSAVEQUEUE_H
+
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <functional>
+
+/**
+ * Saves tab files in background threads.
+ *
+ * Tab files are saved in parallel but saves of the same tab file are
+ * serialized in the order these were queued.
+ */
+class ItemSaveQueue final : public QObject
+{
+    Q_OBJECT
+
+public:
+    using SaveFunction = std::function<bool()>;
+
+    explicit ItemSaveQueue(QObject *parent = nullptr);
+
+    /// Waits for all pending saves.
+    ~ItemSaveQueue();
+
+    /**
+     * Queue saving a tab file.
+     *
+     * Queued save of the same tab file which has not started yet is replaced
+     * (only the latest items need to be saved).
+     *
+     * Blocks if too many saves are pending.
+     *
+     * @return save ID passed to itemsSaved()
+     */
+    int save(const QString &tabFileName, const SaveFunction &saveFunction);
+
+    /**
+     * Wait for pending saves of a tab file (or all tab files if empty).
+     *
+     * @return true only if the last saves of the tab files succeeded
+     */
+    bool waitForSaved(const QString &tabFileName = QString());
+
+signals:
+    /// Emitted (from a save thread) when a tab file is saved or save fails.
+    void itemsSaved(const QString &tabFileName, int saveId, bool success);
+
+private:
+    struct Job {
+        QString tabFileName;
+        int saveId;
+        SaveFunction save;
+    };
+
+    void startJobs();
+    void runJob(const Job &job);
+    bool isPending(const QString &tabFileName) const;
+
+    QMutex m_mutex;
+    QWaitCondition m_jobFinished;
+    QThreadPool m_threadPool;
+    QList<Job> m_queue;
+    QSet<QString> m_running;
+    QSet<QString> m_failed;
+    int m_lastSaveId = 0;
+};
+
+#endif // ITEMSAVEQUEUE_H
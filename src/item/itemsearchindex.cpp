@@ -0,0 +1,573 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemsearchindex.h"
+
+#include "common/contenttype.h"
+#include "common/log.h"
+#include "common/regexp.h"
+#include "common/textdata.h"
+#include "item/serialize.h"
+
+#include <QAbstractItemModel>
+#include <QByteArray>
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QMultiHash>
+#include <QRegularExpression>
+#include <QRunnable>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+const char searchIndexHeader[] = "CopyQ search index v1";
+
+// Longer texts are not split to trigrams, these are always verified with regular expression.
+const int maxIndexedTextLength = 100000;
+
+quint64 trigram(const QString &text, int i)
+{
+    return (static_cast<quint64>(text[i].unicode()) << 32)
+         | (static_cast<quint64>(text[i + 1].unicode()) << 16)
+         | static_cast<quint64>(text[i + 2].unicode());
+}
+
+/// Return sorted unique trigrams of case-folded text.
+QVector<quint64> trigrams(const QString &text)
+{
+    const QString folded = text.toCaseFolded();
+
+    QVector<quint64> result;
+    if (folded.size() < 3)
+        return result;
+
+    result.reserve(folded.size() - 2);
+    for (int i = 0; i + 2 < folded.size(); ++i)
+        result.append( trigram(folded, i) );
+
+    std::sort( result.begin(), result.end() );
+    result.erase( std::unique(result.begin(), result.end()), result.end() );
+    return result;
+}
+
+void removeSorted(QVector<int> *ids, int id)
+{
+    const auto it = std::lower_bound(ids->begin(), ids->end(), id);
+    if ( it != ids->end() && *it == id )
+        ids->erase(it);
+}
+
+/// Finds items with different hash than the expected one.
+class SyncRunnable final : public QRunnable
+{
+public:
+    SyncRunnable(
+            ItemSearchIndex *index, int syncId,
+            const ItemDataSnapshot &items, const QVector<quint64> &hashes,
+            const ItemSearchIndex::SnapshotSearchTextFunction &createSearchText,
+            const std::shared_ptr<QAtomicInt> &cancelled)
+        : m_index(index)
+        , m_syncId(syncId)
+        , m_items(items)
+        , m_hashes(hashes)
+        , m_createSearchText(createSearchText)
+        , m_cancelled(cancelled)
+    {
+    }
+
+    void run() override
+    {
+        QVector<int> rows;
+        QVector<quint64> hashes;
+        QStringList texts;
+
+        for (int row = 0; row < m_items.size(); ++row) {
+            if ( m_cancelled->load() )
+                return;
+
+            const quint64 hash = snapshotItemHash(m_items[row]);
+            if ( hash == m_hashes[row] )
+                continue;
+
+            rows.append(row);
+            hashes.append(hash);
+            texts.append( m_createSearchText(m_items[row]) );
+        }
+
+        emit m_index->changedItemsFound(m_syncId, rows, hashes, texts);
+    }
+
+private:
+    ItemSearchIndex *m_index;
+    int m_syncId;
+    ItemDataSnapshot m_items;
+    QVector<quint64> m_hashes;
+    ItemSearchIndex::SnapshotSearchTextFunction m_createSearchText;
+    std::shared_ptr<QAtomicInt> m_cancelled;
+};
+
+} // namespace
+
+ItemSearchIndex::ItemSearchIndex(QObject *parent)
+    : QObject(parent)
+{
+    m_threadPool.setMaxThreadCount(1);
+    connect( this, &ItemSearchIndex::changedItemsFound,
+             this, &ItemSearchIndex::onChangedItemsFound, Qt::QueuedConnection );
+}
+
+ItemSearchIndex::~ItemSearchIndex()
+{
+    cancelSyncInBackground();
+    m_threadPool.waitForDone();
+}
+
+void ItemSearchIndex::setModel(QAbstractItemModel *model)
+{
+    if (m_model)
+        disconnect(m_model, nullptr, this, nullptr);
+
+    m_model = model;
+
+    connect( model, &QAbstractItemModel::rowsInserted,
+             this, &ItemSearchIndex::onRowsInserted );
+    connect( model, &QAbstractItemModel::rowsRemoved,
+             this, &ItemSearchIndex::onRowsRemoved );
+    connect( model, &QAbstractItemModel::rowsMoved,
+             this, &ItemSearchIndex::onRowsMoved );
+    connect( model, &QAbstractItemModel::dataChanged,
+             this, &ItemSearchIndex::onDataChanged );
+    connect( model, &QAbstractItemModel::layoutAboutToBeChanged,
+             this, &ItemSearchIndex::onLayoutAboutToBeChanged );
+    connect( model, &QAbstractItemModel::layoutChanged,
+             this, &ItemSearchIndex::onLayoutChanged );
+    connect( model, &QAbstractItemModel::modelReset,
+             this, &ItemSearchIndex::sync );
+}
+
+void ItemSearchIndex::sync()
+{
+    if (!m_model)
+        return;
+
+    cancelSyncInBackground();
+
+    QMultiHash<quint64, int> oldIds;
+    for (auto it = m_data.m_entries.constBegin(); it != m_data.m_entries.constEnd(); ++it)
+        oldIds.insert(it.value().hash, it.key());
+
+    const int rowCount = m_model->rowCount();
+    QVector<int> rowToId;
+    rowToId.reserve(rowCount);
+
+    for (int row = 0; row < rowCount; ++row) {
+        const quint64 hash = m_model->index(row, 0).data(contentType::hash).toULongLong();
+        const auto it = oldIds.find(hash);
+        if ( it != oldIds.end() ) {
+            rowToId.append( it.value() );
+            oldIds.erase(it);
+        } else {
+            rowToId.append( addEntry(entryForRow(row)) );
+        }
+    }
+
+    for (const int id : oldIds)
+        removeEntry(id);
+
+    m_data.m_rowToId = rowToId;
+}
+
+void ItemSearchIndex::syncInBackground(const SnapshotSearchTextFunction &createSearchText)
+{
+    if (!m_model)
+        return;
+
+    cancelSyncInBackground();
+
+    // Entries for missing rows are created in background.
+    const int rowCount = m_model->rowCount();
+    while ( m_data.m_rowToId.size() > rowCount )
+        removeEntry( m_data.m_rowToId.takeLast() );
+    while ( m_data.m_rowToId.size() < rowCount )
+        m_data.m_rowToId.append( addEntry(Entry()) );
+
+    m_syncIndexes.reserve(rowCount);
+    m_syncHashes.reserve(rowCount);
+    for (int row = 0; row < rowCount; ++row) {
+        m_syncIndexes.append( m_model->index(row, 0) );
+        m_syncHashes.append( m_data.entry(row).hash );
+    }
+
+    m_syncCancelled = std::make_shared<QAtomicInt>(0);
+    m_threadPool.start( new SyncRunnable(
+        this, m_syncId, itemDataSnapshot(*m_model), m_syncHashes, createSearchText, m_syncCancelled) );
+}
+
+void ItemSearchIndex::clear()
+{
+    cancelSyncInBackground();
+    m_data = Data();
+    m_fileModified = QDateTime();
+    m_fileSize = -1;
+}
+
+ItemSearchIndex::Entry ItemSearchIndex::Data::entry(int row) const
+{
+    return m_entries.value( m_rowToId.value(row, -1) );
+}
+
+QVector<ItemSearchIndex::Entry> ItemSearchIndex::Data::entries() const
+{
+    QVector<Entry> result;
+    result.reserve( m_rowToId.size() );
+    for (const int id : m_rowToId)
+        result.append( m_entries.value(id) );
+    return result;
+}
+
+QVector<int> ItemSearchIndex::Data::search(const QRegularExpression &re) const
+{
+    QVector<int> rows;
+    if ( !re.isValid() )
+        return rows;
+
+    QVector<int> ids;
+    const bool useCandidates = candidates(re, &ids);
+    if ( useCandidates && ids.isEmpty() )
+        return rows;
+
+    for (int row = 0; row < m_rowToId.size(); ++row) {
+        const int id = m_rowToId[row];
+        if ( useCandidates && !std::binary_search(ids.begin(), ids.end(), id) )
+            continue;
+
+        if ( m_entries.value(id).text.contains(re) )
+            rows.append(row);
+    }
+
+    return rows;
+}
+
+bool ItemSearchIndex::load(const QString &fileName)
+{
+    const QFileInfo info(fileName);
+    if ( !info.exists() ) {
+        clear();
+        return false;
+    }
+
+    if ( info.size() == m_fileSize && info.lastModified() == m_fileModified )
+        return true;
+
+    clear();
+
+    QFile file(fileName);
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        log( QString("Failed to open search index file %1: %2")
+             .arg(quoteString(fileName), file.errorString()), LogWarning );
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    QByteArray header;
+    qint32 size;
+    stream >> header >> size;
+    if ( stream.status() != QDataStream::Ok || header != searchIndexHeader || size < 0 ) {
+        log( QString("Corrupted search index file %1").arg(quoteString(fileName)), LogWarning );
+        return false;
+    }
+
+    m_data.m_rowToId.reserve(size);
+    for (qint32 i = 0; i < size; ++i) {
+        Entry entry;
+        stream >> entry.hash >> entry.text;
+        if ( stream.status() != QDataStream::Ok ) {
+            log( QString("Corrupted search index file %1").arg(quoteString(fileName)), LogWarning );
+            clear();
+            return false;
+        }
+
+        m_data.m_rowToId.append( addEntry(entry) );
+    }
+
+    m_fileSize = info.size();
+    m_fileModified = info.lastModified();
+    return true;
+}
+
+bool ItemSearchIndex::saveEntries(const QVector<Entry> &entries, QIODevice *file)
+{
+    QDataStream stream(file);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    stream << QByteArray(searchIndexHeader) << static_cast<qint32>(entries.size());
+    for (const auto &entry : entries)
+        stream << entry.hash << entry.text;
+
+    return stream.status() == QDataStream::Ok;
+}
+
+void ItemSearchIndex::onRowsInserted(const QModelIndex &, int first, int last)
+{
+    if ( first > m_data.m_rowToId.size() ) {
+        sync();
+        return;
+    }
+
+    QVector<int> ids;
+    ids.reserve(last - first + 1);
+    for (int row = first; row <= last; ++row)
+        ids.append( addEntry(entryForRow(row)) );
+
+    m_data.m_rowToId.insert(first, ids.size(), -1);
+    std::copy( ids.begin(), ids.end(), m_data.m_rowToId.begin() + first );
+}
+
+void ItemSearchIndex::onRowsRemoved(const QModelIndex &, int first, int last)
+{
+    if ( last >= m_data.m_rowToId.size() ) {
+        sync();
+        return;
+    }
+
+    for (int row = first; row <= last; ++row)
+        removeEntry( m_data.m_rowToId[row] );
+
+    m_data.m_rowToId.remove(first, last - first + 1);
+}
+
+void ItemSearchIndex::onRowsMoved(
+        const QModelIndex &, int sourceStart, int sourceEnd,
+        const QModelIndex &, int destinationRow)
+{
+    if ( sourceEnd >= m_data.m_rowToId.size() || destinationRow > m_data.m_rowToId.size() ) {
+        sync();
+        return;
+    }
+
+    const int count = sourceEnd - sourceStart + 1;
+    const QVector<int> ids = m_data.m_rowToId.mid(sourceStart, count);
+    m_data.m_rowToId.remove(sourceStart, count);
+
+    const int targetRow = destinationRow > sourceStart ? destinationRow - count : destinationRow;
+    m_data.m_rowToId.insert(targetRow, count, -1);
+    std::copy( ids.begin(), ids.end(), m_data.m_rowToId.begin() + targetRow );
+}
+
+void ItemSearchIndex::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if ( bottomRight.row() >= m_data.m_rowToId.size() ) {
+        sync();
+        return;
+    }
+
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        const int oldId = m_data.m_rowToId[row];
+        const quint64 hash = m_model->index(row, 0).data(contentType::hash).toULongLong();
+        if ( m_data.m_entries.value(oldId).hash == hash )
+            continue;
+
+        removeEntry(oldId);
+        m_data.m_rowToId[row] = addEntry( entryForRow(row) );
+    }
+}
+
+void ItemSearchIndex::onLayoutAboutToBeChanged()
+{
+    m_layoutIndexes.clear();
+    m_layoutIndexes.reserve( m_data.m_rowToId.size() );
+    for (int row = 0; row < m_data.m_rowToId.size(); ++row)
+        m_layoutIndexes.append( m_model->index(row, 0) );
+}
+
+void ItemSearchIndex::onLayoutChanged()
+{
+    const QVector<QPersistentModelIndex> indexes = m_layoutIndexes;
+    m_layoutIndexes.clear();
+
+    // Move entries with items without reading item data.
+    const int rowCount = m_model->rowCount();
+    if ( indexes.size() != m_data.m_rowToId.size() || rowCount != m_data.m_rowToId.size() ) {
+        sync();
+        return;
+    }
+
+    QVector<int> rowToId(rowCount, -1);
+    for (int oldRow = 0; oldRow < indexes.size(); ++oldRow) {
+        const QPersistentModelIndex &index = indexes[oldRow];
+        if ( !index.isValid() ) {
+            sync();
+            return;
+        }
+        rowToId[index.row()] = m_data.m_rowToId[oldRow];
+    }
+
+    m_data.m_rowToId = rowToId;
+}
+
+void ItemSearchIndex::onChangedItemsFound(
+        int syncId, const QVector<int> &rows,
+        const QVector<quint64> &hashes, const QStringList &texts)
+{
+    if (syncId != m_syncId)
+        return;
+
+    const QVector<QPersistentModelIndex> indexes = m_syncIndexes;
+    const QVector<quint64> expectedHashes = m_syncHashes;
+    cancelSyncInBackground();
+
+    for (int i = 0; i < rows.size(); ++i) {
+        const QPersistentModelIndex &index = indexes[ rows[i] ];
+        if ( !index.isValid() )
+            continue;
+
+        // Skip items changed in the meantime (their entries are already updated).
+        const int row = index.row();
+        const int oldId = m_data.m_rowToId.value(row, -1);
+        if ( oldId == -1 || m_data.m_entries.value(oldId).hash != expectedHashes[ rows[i] ] )
+            continue;
+
+        Entry entry;
+        entry.hash = hashes[i];
+        entry.text = texts[i];
+        removeEntry(oldId);
+        m_data.m_rowToId[row] = addEntry(entry);
+    }
+
+    if ( !rows.isEmpty() )
+        emit syncedInBackground();
+}
+
+void ItemSearchIndex::cancelSyncInBackground()
+{
+    if (m_syncCancelled)
+        m_syncCancelled->store(1);
+
+    // Ignore results which are already queued.
+    ++m_syncId;
+    m_syncIndexes.clear();
+    m_syncHashes.clear();
+}
+
+ItemSearchIndex::Entry ItemSearchIndex::entryForRow(int row) const
+{
+    const QModelIndex index = m_model->index(row, 0);
+
+    Entry entry;
+    entry.hash = index.data(contentType::hash).toULongLong();
+    entry.text = index.data(contentType::searchText).toString();
+    return entry;
+}
+
+int ItemSearchIndex::addEntry(const Entry &entry)
+{
+    // New IDs are always larger so posting lists stay sorted.
+    const int id = m_nextId++;
+    m_data.m_entries.insert(id, entry);
+
+    if (entry.text.size() > maxIndexedTextLength) {
+        m_data.m_unindexedIds.append(id);
+    } else {
+        for ( const quint64 t : trigrams(entry.text) )
+            m_data.m_postings[t].append(id);
+    }
+
+    return id;
+}
+
+void ItemSearchIndex::removeEntry(int id)
+{
+    const Entry entry = m_data.m_entries.take(id);
+
+    if (entry.text.size() > maxIndexedTextLength) {
+        removeSorted(&m_data.m_unindexedIds, id);
+        return;
+    }
+
+    for ( const quint64 t : trigrams(entry.text) ) {
+        const auto it = m_data.m_postings.find(t);
+        if ( it == m_data.m_postings.end() )
+            continue;
+
+        removeSorted(&it.value(), id);
+        if ( it.value().isEmpty() )
+            m_data.m_postings.erase(it);
+    }
+}
+
+bool ItemSearchIndex::Data::candidates(const QRegularExpression &re, QVector<int> *ids) const
+{
+    QStringList parts;
+    if ( !literalPatternParts(re.pattern(), &parts) )
+        return false;
+
+    QVector<quint64> queryTrigrams;
+    for (const auto &part : parts)
+        queryTrigrams += trigrams(part);
+
+    if ( queryTrigrams.isEmpty() )
+        return false;
+
+    // Intersect postings starting with the shortest one.
+    QVector<const QVector<int>*> postings;
+    for (const quint64 t : queryTrigrams) {
+        const auto it = m_postings.constFind(t);
+        if ( it == m_postings.constEnd() ) {
+            *ids = m_unindexedIds;
+            return true;
+        }
+        postings.append( &it.value() );
+    }
+
+    std::sort( postings.begin(), postings.end(),
+               [](const QVector<int> *lhs, const QVector<int> *rhs) {
+                   return lhs->size() < rhs->size();
+               } );
+
+    *ids = *postings[0];
+    for (int i = 1; i < postings.size() && !ids->isEmpty(); ++i) {
+        QVector<int> result;
+        std::set_intersection(
+                    ids->begin(), ids->end(),
+                    postings[i]->begin(), postings[i]->end(),
+                    std::back_inserter(result) );
+        ids->swap(result);
+    }
+
+    if ( !m_unindexedIds.isEmpty() ) {
+        QVector<int> result;
+        std::set_union(
+                    ids->begin(), ids->end(),
+                    m_unindexedIds.begin(), m_unindexedIds.end(),
+                    std::back_inserter(result) );
+        ids->swap(result);
+    }
+
+    return true;
+}
+
+QString itemSearchIndexFileName(const QString &tabFileName)
+{
+    return tabFileName + ".index";
+}
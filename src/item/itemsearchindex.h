@@ -0,0 +1,192 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ITEMSEARCHINDEX_H
+#define ITEMSEARCHINDEX_H
+
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QHash>
+#include <QObject>
+#include <QPersistentModelIndex>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+
+class QAbstractItemModel;
+class QIODevice;
+class QModelIndex;
+class QRegularExpression;
+
+/**
+ * Trigram index of searchable item text (text, notes, tags etc.).
+ *
+ * Index either follows changes in an item model or it is loaded from
+ * a file stored beside tab file so tabs can be searched without loading them.
+ *
+ * Only trigrams are kept in index, matching rows are always verified
+ * with the regular expression.
+ */
+class ItemSearchIndex final : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entry {
+        quint64 hash = 0;
+        QString text;
+    };
+
+    /**
+     * Index data which can be copied and searched in any thread.
+     *
+     * Data are implicitly shared so copying is fast.
+     */
+    class Data {
+    public:
+        int count() const { return m_rowToId.size(); }
+
+        Entry entry(int row) const;
+
+        /// Entries in same order as the items.
+        QVector<Entry> entries() const;
+
+        /// Return sorted rows of items matching @a re.
+        QVector<int> search(const QRegularExpression &re) const;
+
+    private:
+        friend class ItemSearchIndex;
+
+        /// Return sorted IDs of candidate entries; false if all entries are candidates.
+        bool candidates(const QRegularExpression &re, QVector<int> *ids) const;
+
+        QVector<int> m_rowToId;
+        QHash<int, Entry> m_entries;
+        QHash<quint64, QVector<int>> m_postings;
+        /// IDs of entries with text too long to be indexed.
+        QVector<int> m_unindexedIds;
+    };
+
+    /// Returns search text of item from ItemDataSnapshot (called from other threads).
+    using SnapshotSearchTextFunction = std::function<QString(const QVariant &item)>;
+
+    explicit ItemSearchIndex(QObject *parent = nullptr);
+
+    /// Cancels background sync and waits for it.
+    ~ItemSearchIndex();
+
+    /**
+     * Follow changes in model.
+     *
+     * Model must provide contentType::searchText role.
+     * Call sync() or syncInBackground() to index items already in model.
+     */
+    void setModel(QAbstractItemModel *model);
+
+    /**
+     * Update index for all items in model.
+     *
+     * Entries with same item hash are reused.
+     */
+    void sync();
+
+    /**
+     * Use current entries (e.g. loaded from file) for items in the same rows
+     * and update entries of changed items in background.
+     *
+     * Only hashes and search texts of items are read in background, the
+     * entries are updated later in the main thread.
+     */
+    void syncInBackground(const SnapshotSearchTextFunction &createSearchText);
+
+    void clear();
+
+    int count() const { return m_data.count(); }
+
+    Entry entry(int row) const { return m_data.entry(row); }
+
+    /// Entries in same order as the items.
+    QVector<Entry> entries() const { return m_data.entries(); }
+
+    /// Return sorted rows of items matching @a re.
+    QVector<int> search(const QRegularExpression &re) const { return m_data.search(re); }
+
+    const Data &data() const { return m_data; }
+
+    /// Load index file (nothing is done if the file didn't change since last call).
+    bool load(const QString &fileName);
+
+    static bool saveEntries(const QVector<Entry> &entries, QIODevice *file);
+
+signals:
+    /// Entries of changed items were updated after syncInBackground().
+    void syncedInBackground();
+
+    /// Internal signal emitted from background thread.
+    void changedItemsFound(
+            int syncId, const QVector<int> &rows,
+            const QVector<quint64> &hashes, const QStringList &texts);
+
+private:
+    void onRowsInserted(const QModelIndex &parent, int first, int last);
+    void onRowsRemoved(const QModelIndex &parent, int first, int last);
+    void onRowsMoved(const QModelIndex &sourceParent, int sourceStart, int sourceEnd,
+                     const QModelIndex &destinationParent, int destinationRow);
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void onLayoutAboutToBeChanged();
+    void onLayoutChanged();
+    void onChangedItemsFound(
+            int syncId, const QVector<int> &rows,
+            const QVector<quint64> &hashes, const QStringList &texts);
+
+    void cancelSyncInBackground();
+
+    Entry entryForRow(int row) const;
+
+    int addEntry(const Entry &entry);
+    void removeEntry(int id);
+
+    QPointer<QAbstractItemModel> m_model;
+
+    Data m_data;
+    int m_nextId = 0;
+
+    /// Items in rows before layout change.
+    QVector<QPersistentModelIndex> m_layoutIndexes;
+
+    /// Items and their expected hashes being synced in background.
+    QVector<QPersistentModelIndex> m_syncIndexes;
+    QVector<quint64> m_syncHashes;
+    int m_syncId = 0;
+    std::shared_ptr<QAtomicInt> m_syncCancelled;
+    QThreadPool m_threadPool;
+
+    QDateTime m_fileModified;
+    qint64 m_fileSize = -1;
+};
+
+/// @return Search index file name for given tab file.
+QString itemSearchIndexFileName(const QString &tabFileName);
+
+#endif // ITEMSEARCHINDEX_H
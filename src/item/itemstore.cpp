@@ -23,13 +23,42 @@
 #include "common/log.h"
 #include "common/textdata.h"
 #include "item/itemfactory.h"
+#include "item/itemjournal.h"
+#include "item/itemsavequeue.h"
+#include "item/itemsearchindex.h"
+#include "item/serialize.h"
 
 #include <QAbstractItemModel>
 #include <QDir>
 #include <QFile>
+#include <QReadWriteLock>
+
+#ifdef Q_OS_UNIX
+#   include <cerrno>
+#   include <cstdio>
+#   include <cstring>
+#endif
 
 namespace {
 
+ItemSaveQueue *itemSaveQueue()
+{
+    static ItemSaveQueue queue;
+    return &queue;
+}
+
+/**
+ * Tab files are being written while the lock is held for reading.
+ *
+ * Unused blobs are removed only while holding the lock for writing
+ * so blobs referenced by partially written tab files are kept.
+ */
+QReadWriteLock &itemBlobsLock()
+{
+    static QReadWriteLock lock;
+    return lock;
+}
+
 /// @return File name for data file with items.
 QString itemFileName(const QString &id)
 {
@@ -63,9 +92,96 @@ void printItemFileError(
          ), LogError );
 }
 
+/// Replace tab file with a temporary file (atomically if possible).
+bool replaceTabFile(const QString &tabName, QFile *tmpFile, const QString &tabFileName)
+{
+    tmpFile->close();
+
+#ifdef Q_OS_UNIX
+    const QByteArray from = QFile::encodeName( tmpFile->fileName() );
+    const QByteArray to = QFile::encodeName(tabFileName);
+    if ( std::rename(from.constData(), to.constData()) != 0 ) {
+        log( QString("Tab %1: Failed to save tab (overwrite original file), file %2: %3").arg(
+                 quoteString(tabName),
+                 quoteString(tmpFile->fileName()),
+                 QString::fromLocal8Bit(std::strerror(errno))
+             ), LogError );
+        return false;
+    }
+#else
+    QFile oldTabFile(tabFileName);
+    if (oldTabFile.exists() && !oldTabFile.remove()) {
+        printItemFileError("save tab (remove file)", tabName, oldTabFile);
+        return false;
+    }
+
+    if ( !tmpFile->rename(tabFileName) ) {
+        printItemFileError("save tab (overwrite original file)", tabName, *tmpFile);
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+/**
+ * Save items to temporary file and replace tab file with it.
+ *
+ * Safe to call from any thread if @a saveItemsToFile is.
+ */
+template <typename SaveItemsToFile>
+bool saveTabFile(
+        const QString &tabName, const QString &tabFileName, int itemCount,
+        SaveItemsToFile saveItemsToFile)
+{
+    QSet<QString> oldBlobs;
+
+    {
+        QReadLocker lock( &itemBlobsLock() );
+
+        // Save to temp file.
+        QFile tmpFile( tabFileName + ".tmp" );
+        if ( !tmpFile.open(QIODevice::WriteOnly) ) {
+            printItemFileError("save tab (open temporary file)", tabName, tmpFile);
+            return false;
+        }
+
+        COPYQ_LOG( QString("Tab \"%1\": Saving %2 items").arg(tabName).arg(itemCount) );
+
+        if ( !saveItemsToFile(&tmpFile) ) {
+            printItemFileError("save tab (save items to temporary file)", tabName, tmpFile);
+            return false;
+        }
+
+        // 1. Safely flush all data to temporary file.
+        if ( !syncFile(&tmpFile) ) {
+            printItemFileError("save tab (flush temporary file)", tabName, tmpFile);
+            return false;
+        }
+
+        // Blobs referenced only from the old tab file can be removed later.
+        oldBlobs = itemBlobs(tabFileName);
+
+        // 2. Overwrite previous file.
+        if ( !replaceTabFile(tabName, &tmpFile, tabFileName) )
+            return false;
+    }
+
+    COPYQ_LOG( QString("Tab \"%1\": Items saved").arg(tabName) );
+
+    if ( !oldBlobs.isEmpty() ) {
+        QWriteLocker lock( &itemBlobsLock() );
+        oldBlobs.subtract( itemBlobs(tabFileName) );
+        removeUnusedItemBlobs(tabFileName, oldBlobs);
+    }
+
+    return true;
+}
+
 ItemSaverPtr loadItems(
         const QString &tabName, const QString &tabFileName,
-        QAbstractItemModel &model, ItemFactory *itemFactory, int maxItems)
+        QAbstractItemModel &model, ItemFactory *itemFactory, int maxItems,
+        ItemJournal *journal)
 {
     COPYQ_LOG( QString("Tab \"%1\": Loading items").arg(tabName) );
 
@@ -75,7 +191,7 @@ ItemSaverPtr loadItems(
         return nullptr;
     }
 
-    return itemFactory->loadItems(tabName, &model, &tabFile, maxItems);
+    return itemFactory->loadItems(tabName, &model, &tabFile, maxItems, journal);
 }
 
 ItemSaverPtr createTab(
@@ -97,12 +213,15 @@ ItemSaverPtr createTab(
 
 } // namespace
 
-ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel &model, ItemFactory *itemFactory, int maxItems)
+ItemSaverPtr loadItems(
+        const QString &tabName, QAbstractItemModel &model, ItemFactory *itemFactory, int maxItems,
+        ItemJournal *journal)
 {
     if ( !createItemDirectory() )
         return nullptr;
 
     const QString tabFileName = itemFileName(tabName);
+    itemSaveQueue()->waitForSaved(tabFileName);
 
     ItemSaverPtr saver;
 
@@ -112,16 +231,24 @@ ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel &model, ItemFa
         if ( tmpFile.exists() ) {
             log( QString("Tab \"%1\": Restoring items (previous save failed)").arg(tabName), LogWarning );
 
-            saver = loadItems(tabName, tmpFile.fileName(), model, itemFactory, maxItems);
+            saver = loadItems(tabName, tmpFile.fileName(), model, itemFactory, maxItems, nullptr);
             if ( saver && !tmpFile.rename(tabFileName) )
                 printItemFileError("overwrite original file", tabName, tmpFile);
         }
     }
 
     if (!saver) {
-        saver = QFile::exists(tabFileName)
-                ? loadItems(tabName, tabFileName, model, itemFactory, maxItems)
-                : createTab(tabName, model, itemFactory, maxItems);
+        if ( QFile::exists(tabFileName) ) {
+            // Items removed from the end of the list may be still referenced in journal.
+            if ( journal && journal->open(tabFileName) )
+                maxItems = qMax(maxItems, journal->baseRowCount());
+
+            saver = loadItems(tabName, tabFileName, model, itemFactory, maxItems, journal);
+        } else {
+            saver = createTab(tabName, model, itemFactory, maxItems);
+            if (saver && journal)
+                journal->reset(tabFileName, saver);
+        }
     }
 
     if (!saver) {
@@ -141,61 +268,130 @@ bool saveItems(const QString &tabName, const QAbstractItemModel &model, const It
     if ( !createItemDirectory() )
         return false;
 
-    // Save to temp file.
-    QFile tmpFile( tabFileName + ".tmp" );
-    if ( !tmpFile.open(QIODevice::WriteOnly) ) {
-        printItemFileError("save tab (open temporary file)", tabName, tmpFile);
-        return false;
-    }
+    // Keep order of saves.
+    itemSaveQueue()->waitForSaved(tabFileName);
 
-    COPYQ_LOG( QString("Tab \"%1\": Saving %2 items").arg(tabName).arg(model.rowCount()) );
+    return saveTabFile(tabName, tabFileName, model.rowCount(), [&](QIODevice *file) {
+        return saver->saveItems(tabName, model, file);
+    });
+}
 
-    if ( !saver->saveItems(tabName, model, &tmpFile) ) {
-        printItemFileError("save tab (save items to temporary file)", tabName, tmpFile);
-        return false;
+bool saveItems(const QString &tabName, const QAbstractItemModel &model, const ItemSaverPtr &saver, ItemJournal *journal, bool *appendedToJournal)
+{
+    const QString tabFileName = itemFileName(tabName);
+
+    const bool appended = journal->append(tabFileName);
+    if (appendedToJournal)
+        *appendedToJournal = appended;
+    if (appended)
+        return true;
+
+    if ( !saver->canSaveItemsInBackground() ) {
+        if ( !saveItems(tabName, model, saver) )
+            return false;
+
+        journal->reset(tabFileName, saver);
+        return true;
     }
 
-    // 1. Safely flush all data to temporary file.
-    if ( !tmpFile.flush() ) {
-        printItemFileError("save tab (flush temporary file)", tabName, tmpFile);
+    if ( !createItemDirectory() )
         return false;
-    }
 
-    // 2. Remove old tab file.
-    {
-        QFile oldTabFile(tabFileName);
-        if (oldTabFile.exists() && !oldTabFile.remove()) {
-            printItemFileError("save tab (remove file)", tabName, oldTabFile);
+    // Model data are implicitly shared, so only changed items are copied later.
+    const ItemDataSnapshot items = itemDataSnapshot(model);
+    const int saveId = itemSaveQueue()->save(tabFileName, [tabName, tabFileName, items]() {
+        if ( !saveTabFile(tabName, tabFileName, items.size(), [&](QIODevice *file) {
+                return serializeData(items, file);
+            }) )
+        {
             return false;
         }
-    }
 
-    // 3. Overwrite previous file.
-    if ( !tmpFile.rename(tabFileName) ) {
-        printItemFileError("save tab (overwrite original file)", tabName, tmpFile);
+        // Journal belongs to the previous tab file.
+        QFile::remove( itemJournalFileName(tabFileName) );
+        return true;
+    });
+
+    QObject::connect( itemSaveQueue(), &ItemSaveQueue::itemsSaved,
+                      journal, &ItemJournal::onItemsSaved, Qt::UniqueConnection );
+    journal->startFullSave(tabFileName, saveId, saver);
+
+    return true;
+}
+
+bool saveItemSearchIndex(const QString &tabName, const ItemSearchIndex &index)
+{
+    if ( !createItemDirectory() )
         return false;
-    }
 
-    COPYQ_LOG( QString("Tab \"%1\": Items saved").arg(tabName) );
+    const QString indexFileName = itemSearchIndexFileName( itemFileName(tabName) );
+    const QVector<ItemSearchIndex::Entry> entries = index.entries();
+    itemSaveQueue()->save(indexFileName, [tabName, indexFileName, entries]() {
+        QFile tmpFile( indexFileName + ".tmp" );
+        if ( !tmpFile.open(QIODevice::WriteOnly) ) {
+            printItemFileError("save search index (open temporary file)", tabName, tmpFile);
+            return false;
+        }
+
+        if ( !ItemSearchIndex::saveEntries(entries, &tmpFile) || !syncFile(&tmpFile) ) {
+            printItemFileError("save search index", tabName, tmpFile);
+            return false;
+        }
+
+        return replaceTabFile(tabName, &tmpFile, indexFileName);
+    });
 
     return true;
 }
 
+bool loadItemSearchIndex(const QString &tabName, ItemSearchIndex *index)
+{
+    const QString indexFileName = itemSearchIndexFileName( itemFileName(tabName) );
+    itemSaveQueue()->waitForSaved(indexFileName);
+    return index->load(indexFileName);
+}
+
+bool waitForSavedItems(const QString &tabName)
+{
+    return itemSaveQueue()->waitForSaved( tabName.isEmpty() ? QString() : itemFileName(tabName) );
+}
+
 void removeItems(const QString &tabName)
 {
     const QString tabFileName = itemFileName(tabName);
+    const QString indexFileName = itemSearchIndexFileName(tabFileName);
+    itemSaveQueue()->waitForSaved(tabFileName);
+    itemSaveQueue()->waitForSaved(indexFileName);
+
+    QWriteLocker lock( &itemBlobsLock() );
+    const QSet<QString> blobs = itemBlobs(tabFileName);
     QFile::remove(tabFileName);
     QFile::remove(tabFileName + ".tmp");
+    QFile::remove( itemJournalFileName(tabFileName) );
+    QFile::remove(indexFileName);
+    removeUnusedItemBlobs(tabFileName, blobs);
 }
 
 bool moveItems(const QString &oldId, const QString &newId)
 {
     const QString oldFileName = itemFileName(oldId);
     const QString newFileName = itemFileName(newId);
+    const QString oldIndexFileName = itemSearchIndexFileName(oldFileName);
+    itemSaveQueue()->waitForSaved(oldFileName);
+    itemSaveQueue()->waitForSaved(oldIndexFileName);
 
     if ( oldFileName != newFileName && QFile::copy(oldFileName, newFileName) ) {
-        QFile::remove(oldFileName);
-        return true;
+        if ( moveItemJournal(oldFileName, newFileName) ) {
+            QFile::remove(oldFileName);
+
+            // Search index is rebuilt when the tab is loaded if this fails.
+            const QString newIndexFileName = itemSearchIndexFileName(newFileName);
+            QFile::remove(newIndexFileName);
+            QFile::rename(oldIndexFileName, newIndexFileName);
+            return true;
+        }
+
+        QFile::remove(newFileName);
     }
 
     log( QString("Failed to move items from \"%1\" (tab \"%2\") to \"%3\" (tab \"%4\")").arg(
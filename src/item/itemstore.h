@@ -21,18 +21,55 @@
 
 #include "item/itemwidget.h"
 
+#include <QString>
+
 class QAbstractItemModel;
 class ItemFactory;
-class QString;
+class ItemJournal;
+class ItemSearchIndex;
 
-/** Load items from configuration file. */
+/** Load items from configuration file and apply changes from journal. */
 ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel &model //!< Model for items.
-        , ItemFactory *itemFactory, int maxItems);
+        , ItemFactory *itemFactory, int maxItems
+        , ItemJournal *journal = nullptr //!< Journal with changes since items were saved.
+        );
 
 /** Save items to configuration file. */
 bool saveItems(const QString &tabName, const QAbstractItemModel &model //!< Model containing items to save.
         , const ItemSaverPtr &saver);
 
+/**
+ * Append changes to the journal or save all items to configuration file
+ * if the journal cannot be used or is too large.
+ *
+ * If the saver allows it, all items are saved in background from a snapshot
+ * (see waitForSavedItems()).
+ */
+bool saveItems(const QString &tabName, const QAbstractItemModel &model //!< Model containing items to save.
+        , const ItemSaverPtr &saver, ItemJournal *journal
+        , bool *appendedToJournal = nullptr //!< Set to true if only the journal was appended.
+        );
+
+/**
+ * Save search index of items beside configuration file in background.
+ */
+bool saveItemSearchIndex(const QString &tabName, const ItemSearchIndex &index);
+
+/**
+ * Load search index saved with saveItemSearchIndex().
+ *
+ * @return false if index doesn't exist or it cannot be loaded
+ */
+bool loadItemSearchIndex(const QString &tabName, ItemSearchIndex *index);
+
+/**
+ * Wait for items saved in background.
+ *
+ * @return true only if last saves succeeded
+ */
+bool waitForSavedItems(const QString &tabName = QString() //!< Tab to wait for (all tabs if empty).
+        );
+
 /** Remove configuration file for items. */
 void removeItems(const QString &tabName //!< See ClipboardBrowser::getID().
         );
@@ -205,6 +205,16 @@ bool ItemSaverInterface::saveItems(const QString &, const QAbstractItemModel &,
     return false;
 }
 
+bool ItemSaverInterface::canJournalItems()
+{
+    return false;
+}
+
+bool ItemSaverInterface::canSaveItemsInBackground()
+{
+    return false;
+}
+
 bool ItemSaverInterface::canRemoveItems(const QList<QModelIndex> &, QString *)
 {
     return true;
@@ -268,9 +278,14 @@ ItemSaverPtr ItemLoaderInterface::transformSaver(const ItemSaverPtr &saver, QAbs
     return saver;
 }
 
-bool ItemLoaderInterface::matches(const QModelIndex &, const QRegularExpression &) const
+QString ItemLoaderInterface::searchText(const QVariantMap &) const
 {
-    return false;
+    return QString();
+}
+
+QStringList ItemLoaderInterface::searchTextFormats() const
+{
+    return QStringList();
 }
 
 QObject *ItemLoaderInterface::tests(const TestInterfacePtr &) const
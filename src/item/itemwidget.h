@@ -211,6 +211,20 @@ public:
      */
     virtual bool saveItems(const QString &tabName, const QAbstractItemModel &model, QIODevice *file);
 
+    /**
+     * Return true if item changes can be appended to a journal file instead
+     * of saving all items with saveItems() each time.
+     *
+     * Journal is applied on items after loading them with the same plugin.
+     */
+    virtual bool canJournalItems();
+
+    /**
+     * Return true if saveItems() only serializes item data (see serializeData())
+     * so items can be saved from a snapshot in other thread instead.
+     */
+    virtual bool canSaveItemsInBackground();
+
     /**
      * Called before items are deleted by user.
      * @return true if items can be removed, false to cancel the removal
@@ -252,7 +266,7 @@ public:
  * - loads items from file (creates ItemSaverInterface instance),
  * - creates item widgets (creates ItemWidget instance),
  * - adds scripting capabilities (creates ItemScriptable instance),
- * - matches/filters items,
+ * - provides text for filtering items,
  * - provides commands for Command dialog,
  * - provides settings widget for Configuration dialog.
  */
@@ -370,10 +384,23 @@ public:
     virtual ItemSaverPtr transformSaver(const ItemSaverPtr &saver, QAbstractItemModel *model);
 
     /**
-     * Return true if regular expression matches items content.
-     * Returns false by default.
+     * Return text which should be found when searching items (see ItemSearchIndex).
+     *
+     * Items are filtered by matching the text so it should contain any text
+     * shown in item.
+     *
+     * This is called from other threads so it must not access any shared state.
+     * Returns empty string by default.
+     */
+    virtual QString searchText(const QVariantMap &data) const;
+
+    /**
+     * Return formats used by searchText().
+     *
+     * Only these formats are read to create search text for items loaded
+     * lazily from tab file. Returns empty list by default.
      */
-    virtual bool matches(const QModelIndex &index, const QRegularExpression &re) const;
+    virtual QStringList searchTextFormats() const;
 
     /**
      * Return object with tests.
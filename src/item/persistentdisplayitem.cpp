@@ -23,8 +23,10 @@
 
 PersistentDisplayItem::PersistentDisplayItem(ItemDelegate *delegate,
         const QVariantMap &data,
-        QWidget *widget)
+        QWidget *widget,
+        quint64 itemHash)
     : m_data(data)
+    , m_itemHash(itemHash)
     , m_widget(widget)
     , m_delegate(delegate)
 {
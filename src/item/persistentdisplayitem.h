@@ -41,7 +41,8 @@ public:
     PersistentDisplayItem() = default;
 
     PersistentDisplayItem(
-            ItemDelegate *delegate, const QVariantMap &data, QWidget *widget);
+            ItemDelegate *delegate, const QVariantMap &data, QWidget *widget,
+            quint64 itemHash);
 
     /**
      * Returns display data of the item.
@@ -50,6 +51,12 @@ public:
      */
     const QVariantMap &data() const { return m_data; }
 
+    /**
+     * Returns hash of the item (contentType::hash) or 0 if data are not
+     * item data (e.g. display data of item preview).
+     */
+    quint64 itemHash() const { return m_itemHash; }
+
     /**
      * Returns true only if display item widget is still available.
      */
@@ -64,6 +71,7 @@ public:
 
 private:
     QVariantMap m_data;
+    quint64 m_itemHash = 0;
     QPointer<QWidget> m_widget;
     QPointer<ItemDelegate> m_delegate;
 };
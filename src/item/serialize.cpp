@@ -22,19 +22,127 @@
 #include "common/contenttype.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
+#include "common/textdata.h"
 
 #include <QAbstractItemModel>
 #include <QByteArray>
+#include <QCryptographicHash>
 #include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QIODevice>
 #include <QList>
 #include <QPair>
+#include <QSaveFile>
+#include <QSet>
 #include <QStringList>
 
+#include <limits>
 #include <unordered_map>
 
+#ifdef Q_OS_UNIX
+#   include <unistd.h>
+#elif defined(Q_OS_WIN)
+#   include <io.h>
+#endif
+
 namespace {
 
+int itemBlobMinSize = 0;
+
+QString itemBlobDirectory(const QString &tabFileName)
+{
+    return QFileInfo(tabFileName).absolutePath() + "/item_blobs";
+}
+
+QString fileName(QIODevice *file)
+{
+    const auto fileDevice = qobject_cast<QFileDevice*>(file);
+    return fileDevice ? fileDevice->fileName() : QString();
+}
+
+} // namespace
+
+/**
+ * Tab file data (memory-mapped if possible).
+ */
+class MappedTabFile final
+{
+public:
+    explicit MappedTabFile(QIODevice *file)
+    {
+        const QString tabFileName = fileName(file);
+        if ( !tabFileName.isEmpty() )
+            m_blobDirectory = itemBlobDirectory(tabFileName);
+
+#ifndef Q_OS_WIN
+        // Open the file again since the mapping is removed once the original
+        // file is closed. (On Windows, mapped file cannot be replaced later.)
+        if ( !tabFileName.isEmpty() ) {
+            m_file.setFileName(tabFileName);
+            if ( m_file.open(QIODevice::ReadOnly) ) {
+                const qint64 size = m_file.size();
+                if ( size <= std::numeric_limits<int>::max() ) {
+                    const uchar *data = m_file.map(0, size);
+                    if (data) {
+                        m_bytes = QByteArray::fromRawData(
+                            reinterpret_cast<const char*>(data), static_cast<int>(size) );
+                        return;
+                    }
+                }
+                m_file.close();
+            }
+        }
+#endif
+
+        if ( file->seek(0) )
+            m_bytes = file->readAll();
+    }
+
+    /// Return file content (not copied from mapped memory).
+    const QByteArray &bytes() const { return m_bytes; }
+
+    /// Return directory with item blobs referenced from the tab file.
+    const QString &blobDirectory() const { return m_blobDirectory; }
+
+private:
+    QFile m_file;
+    QByteArray m_bytes;
+    QString m_blobDirectory;
+};
+
+namespace {
+
+/// Marks tab file with format index (older tab files start with item count).
+const qint32 indexedTabFileMarker = -3;
+
+/// Marks tab file with format index and codec for each format.
+const qint32 indexedTabFileMarkerV2 = -4;
+
+/// Codec used to store format data.
+enum DataCodec {
+    NoCodec = 0,
+    ZlibCodec = 1,
+};
+
+/// Format data are stored in blob file with given ID (with codec as first byte).
+const qint8 blobCodecFlag = 0x40;
+
+/// Smaller data are not compressed.
+const int minCompressDataSize = 1024;
+
+/// Format entry in index of a tab file.
+struct IndexedFormat {
+    QString mime;
+    qint8 codec = NoCodec;
+    qint64 offset = 0;
+    qint64 size = 0;
+};
+
+/// Size of marker and index offset at the beginning of indexed tab file.
+const qint64 indexedTabFileHeaderSize = sizeof(qint32) + sizeof(qint64);
+
 template <typename T>
 bool readOrError(QDataStream *out, T *value, const char *error)
 {
@@ -105,6 +213,45 @@ QString compressMime(const QString &mime)
     return "0" + mime;
 }
 
+bool isCompressible(const QString &mime)
+{
+    // Most image formats are already compressed.
+    return mime.startsWith("text/")
+        || mime == "image/bmp"
+        || mime == "image/x-bmp"
+        || mime == "image/svg+xml"
+        || mime == "application/json"
+        || mime == "application/xml";
+}
+
+QByteArray encodeData(const QString &mime, const QByteArray &bytes, qint8 *codec)
+{
+    if ( bytes.size() >= minCompressDataSize && isCompressible(mime) ) {
+        // Use fast compression level since all items are compressed on each save.
+        const QByteArray compressed = qCompress(bytes, 1);
+        if ( compressed.size() < bytes.size() ) {
+            *codec = ZlibCodec;
+            return compressed;
+        }
+    }
+
+    *codec = NoCodec;
+    return bytes;
+}
+
+bool decodeData(qint8 codec, QByteArray *bytes)
+{
+    switch (codec) {
+    case NoCodec:
+        return true;
+    case ZlibCodec:
+        *bytes = qUncompress(*bytes);
+        return !bytes->isEmpty();
+    }
+
+    return false;
+}
+
 bool deserializeDataV2(QDataStream *out, QVariantMap *data)
 {
     qint32 size;
@@ -138,8 +285,473 @@ bool deserializeDataV2(QDataStream *out, QVariantMap *data)
     return out->status() == QDataStream::Ok;
 }
 
+bool deserializeDataV3(QDataStream *out, QVariantMap *data)
+{
+    qint32 size;
+    if ( !readOrError(out, &size, "Failed to read size (v3)") )
+        return false;
+
+    QByteArray tmpBytes;
+    qint8 codec;
+    for (qint32 i = 0; i < size; ++i) {
+        const QString mime = decompressMime(out);
+        if ( out->status() != QDataStream::Ok )
+            return false;
+
+        if ( !readOrError(out, &codec, "Failed to read codec (v3)") )
+            return false;
+
+        if ( !readOrError(out, &tmpBytes, "Failed to read item data (v3)") )
+            return false;
+
+        if ( !decodeData(codec, &tmpBytes) ) {
+            log("Corrupted data: Failed to decode data (v3)", LogError);
+            out->setStatus(QDataStream::ReadCorruptData);
+            return false;
+        }
+        data->insert(mime, tmpBytes);
+    }
+
+    return out->status() == QDataStream::Ok;
+}
+
+bool isIndexedTabFile(QIODevice *file)
+{
+    QDataStream stream( file->peek(sizeof(qint32)) );
+    stream.setVersion(QDataStream::Qt_4_7);
+    qint32 marker;
+    stream >> marker;
+    return stream.status() == QDataStream::Ok
+        && (marker == indexedTabFileMarker || marker == indexedTabFileMarkerV2);
+}
+
+/**
+ * Save format data to a blob file unless a blob with the same size exists.
+ *
+ * Blob data are written to a unique temporary file (the same blob can be saved
+ * from multiple tabs in parallel) and flushed to disk before the tab file
+ * referencing the blob is replaced.
+ *
+ * @return blob ID or empty on failure
+ */
+QByteArray saveItemBlob(const QString &directory, const QString &mime, const QByteArray &bytes)
+{
+    const QByteArray id = QCryptographicHash::hash(bytes, QCryptographicHash::Sha256).toHex();
+    const QString blobFileName = directory + "/" + QString::fromLatin1(id);
+
+    qint8 codec;
+    const QByteArray encodedBytes = encodeData(mime, bytes, &codec);
+
+    // Overwrite truncated or otherwise damaged blobs.
+    const QFileInfo blobInfo(blobFileName);
+    if ( blobInfo.exists() ) {
+        if ( blobInfo.size() == encodedBytes.size() + 1 )
+            return id;
+        log( QString("Corrupted data: Replacing item blob %1").arg(blobFileName), LogWarning );
+    }
+
+    if ( !QDir(directory).mkpath(".") ) {
+        log( QString("Failed to create directory for item blobs: %1").arg(directory), LogError );
+        return QByteArray();
+    }
+
+    QSaveFile blobFile(blobFileName);
+    if ( !blobFile.open(QIODevice::WriteOnly)
+         || !blobFile.putChar(static_cast<char>(codec))
+         || blobFile.write(encodedBytes) != encodedBytes.size()
+         || !syncFile(&blobFile)
+         || !blobFile.commit() )
+    {
+        log( QString("Failed to save item blob %1: %2")
+             .arg(blobFile.fileName(), blobFile.errorString()), LogError );
+        blobFile.cancelWriting();
+        return QByteArray();
+    }
+
+    return id;
+}
+
+QByteArray loadItemBlob(const QString &directory, const QString &id)
+{
+    QFile blobFile(directory + "/" + id);
+    if ( !blobFile.open(QIODevice::ReadOnly) ) {
+        log( QString("Failed to open item blob %1: %2")
+             .arg(blobFile.fileName(), blobFile.errorString()), LogError );
+        return QByteArray();
+    }
+
+    QByteArray bytes = blobFile.readAll();
+    if ( bytes.isEmpty() ) {
+        log( QString("Corrupted data: Empty item blob %1").arg(blobFile.fileName()), LogError );
+        return QByteArray();
+    }
+
+    const qint8 codec = static_cast<qint8>(bytes[0]);
+    bytes.remove(0, 1);
+    if ( !decodeData(codec, &bytes) ) {
+        log( QString("Corrupted data: Failed to decode item blob %1").arg(blobFile.fileName()), LogError );
+        return QByteArray();
+    }
+
+    return bytes;
+}
+
+bool serializeIndexedData(const ItemDataSnapshot &items, QIODevice *file)
+{
+    const QString tabFileName = fileName(file);
+    const QString blobDirectory = (itemBlobMinSize > 0 && !tabFileName.isEmpty())
+            ? itemBlobDirectory(tabFileName) : QString();
+
+    QDataStream stream(file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    // Index offset is updated after writing all data.
+    stream << indexedTabFileMarkerV2 << static_cast<qint64>(0);
+
+    QByteArray index;
+    QDataStream indexStream(&index, QIODevice::WriteOnly);
+    indexStream.setVersion(QDataStream::Qt_4_7);
+
+    const auto writeFormat = [&](const QString &mime, qint8 codec, const QByteArray &bytes) {
+        indexStream << compressMime(mime)
+                    << codec
+                    << static_cast<qint64>(file->pos())
+                    << static_cast<qint64>(bytes.size());
+        return stream.writeRawData(bytes.constData(), bytes.size()) == bytes.size();
+    };
+
+    const auto encodeAndWriteFormat = [&](const QString &mime, const QByteArray &rawBytes) {
+        qint8 codec;
+        QByteArray bytes;
+        if ( !blobDirectory.isEmpty() && rawBytes.size() >= itemBlobMinSize ) {
+            bytes = saveItemBlob(blobDirectory, mime, rawBytes);
+            if ( bytes.isEmpty() )
+                return false;
+            codec = blobCodecFlag;
+        } else {
+            bytes = encodeData(mime, rawBytes, &codec);
+        }
+        return writeFormat(mime, codec, bytes);
+    };
+
+    const qint32 length = items.size();
+    indexStream << length;
+
+    for(qint32 i = 0; i < length && stream.status() == QDataStream::Ok; ++i) {
+        const QVariant &item = items[i];
+
+        // Unchanged items loaded from tab file are copied without decoding,
+        // compressing or hashing the data again.
+        if ( item.userType() == qMetaTypeId<MappedItemData>() ) {
+            const auto mappedData = item.value<MappedItemData>();
+            const bool sameBlobDirectory = mappedData.blobDirectory() == blobDirectory;
+            const auto formats = mappedData.encodedFormats();
+            indexStream << static_cast<qint32>(formats.size());
+            for (const auto &format : formats) {
+                // Blobs cannot be referenced if saved in other directory or disabled.
+                const bool ok = (format.codec & blobCodecFlag) && !sameBlobDirectory
+                        ? encodeAndWriteFormat( format.format, mappedData.data(format.format) )
+                        : writeFormat(format.format, format.codec, format.bytes);
+                if (!ok)
+                    return false;
+            }
+            continue;
+        }
+
+        const QVariantMap data = item.toMap();
+        indexStream << static_cast<qint32>(data.size());
+        for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+            if ( !encodeAndWriteFormat(it.key(), it.value().toByteArray()) )
+                return false;
+        }
+    }
+
+    const qint64 indexOffset = file->pos();
+    if ( stream.writeRawData(index.constData(), index.size()) != index.size() )
+        return false;
+
+    if ( !file->seek(sizeof(qint32)) )
+        return false;
+
+    stream << indexOffset;
+
+    return stream.status() == QDataStream::Ok && file->seek(file->size());
+}
+
+/// Read tab file header and seek to item count in the index.
+bool readIndexHeader(QDataStream *stream, qint64 fileSize, bool *hasCodecs, qint64 *indexOffset, qint32 *length)
+{
+    qint32 marker;
+    if ( !readOrError(stream, &marker, "Failed to read tab file marker") )
+        return false;
+    if ( !readOrError(stream, indexOffset, "Failed to read index offset") )
+        return false;
+
+    *hasCodecs = marker == indexedTabFileMarkerV2;
+
+    if ( *indexOffset < indexedTabFileHeaderSize || *indexOffset > fileSize
+         || !stream->device()->seek(*indexOffset) )
+    {
+        log("Corrupted data: Invalid index offset", LogError);
+        return false;
+    }
+
+    if ( !readOrError(stream, length, "Failed to read length") )
+        return false;
+
+    if (*length < 0) {
+        log("Corrupted data: Invalid length", LogError);
+        return false;
+    }
+
+    return true;
+}
+
+bool readIndexedFormat(QDataStream *stream, bool hasCodecs, qint64 indexOffset, IndexedFormat *format)
+{
+    format->mime = decompressMime(stream);
+    if ( stream->status() != QDataStream::Ok )
+        return false;
+
+    if ( hasCodecs && !readOrError(stream, &format->codec, "Failed to read codec") )
+        return false;
+    if ( !readOrError(stream, &format->offset, "Failed to read data offset") )
+        return false;
+    if ( !readOrError(stream, &format->size, "Failed to read data size") )
+        return false;
+
+    if ( format->offset < indexedTabFileHeaderSize || format->size < 0
+         || format->offset + format->size > indexOffset )
+    {
+        log("Corrupted data: Invalid data offset", LogError);
+        return false;
+    }
+
+    return true;
+}
+
+bool deserializeIndexedData(QAbstractItemModel *model, QIODevice *file, int maxItems)
+{
+    const auto tabFile = std::make_shared<MappedTabFile>(file);
+    const QByteArray &bytes = tabFile->bytes();
+
+    QDataStream stream(bytes);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    bool hasCodecs;
+    qint64 indexOffset;
+    qint32 length;
+    if ( !readIndexHeader(&stream, bytes.size(), &hasCodecs, &indexOffset, &length) )
+        return false;
+
+    // Limit the loaded number of items to model's maximum.
+    length = qMin(length, maxItems) - model->rowCount();
+
+    if ( length != 0 && !model->insertRows(0, length) )
+        return false;
+
+    IndexedFormat format;
+    for(qint32 i = 0; i < length; ++i) {
+        qint32 formatCount;
+        if ( !readOrError(&stream, &formatCount, "Failed to read format count") )
+            return false;
+
+        MappedItemData data(tabFile);
+        for (qint32 j = 0; j < formatCount; ++j) {
+            if ( !readIndexedFormat(&stream, hasCodecs, indexOffset, &format) )
+                return false;
+
+            data.insert(format.mime, format.offset, static_cast<int>(format.size), format.codec);
+        }
+
+        const auto index = model->index(i, 0);
+        if ( !model->setData(index, QVariant::fromValue(data), contentType::mappedData)
+             && !model->setData(index, data.toMap(), contentType::data) )
+        {
+            log("Failed to set model data", LogError);
+            return false;
+        }
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
 } // namespace
 
+MappedItemData::MappedItemData(const std::shared_ptr<MappedTabFile> &file)
+    : m_file(file)
+{
+}
+
+void MappedItemData::insert(const QString &format, qint64 offset, int size, qint8 codec)
+{
+    m_formats.append({format, offset, size, codec});
+}
+
+bool MappedItemData::contains(const QString &format) const
+{
+    for (const auto &mappedFormat : m_formats) {
+        if (mappedFormat.format == format)
+            return true;
+    }
+    return false;
+}
+
+QStringList MappedItemData::formats() const
+{
+    QStringList result;
+    result.reserve( m_formats.size() );
+    for (const auto &mappedFormat : m_formats)
+        result.append(mappedFormat.format);
+    return result;
+}
+
+QByteArray MappedItemData::data(const QString &format) const
+{
+    for (const auto &mappedFormat : m_formats) {
+        if (mappedFormat.format == format)
+            return decodedData(mappedFormat);
+    }
+    return QByteArray();
+}
+
+QVariantMap MappedItemData::toMap() const
+{
+    QVariantMap result;
+    for (const auto &mappedFormat : m_formats)
+        result.insert( mappedFormat.format, decodedData(mappedFormat) );
+    return result;
+}
+
+QVariantMap MappedItemData::toRawMap() const
+{
+    QVariantMap result;
+    for (const auto &mappedFormat : m_formats) {
+        if (mappedFormat.codec == NoCodec)
+            result.insert( mappedFormat.format, rawData(mappedFormat) );
+        else
+            result.insert( mappedFormat.format, decodedData(mappedFormat) );
+    }
+    return result;
+}
+
+QVector<MappedItemData::EncodedFormat> MappedItemData::encodedFormats() const
+{
+    QVector<EncodedFormat> result;
+    result.reserve( m_formats.size() );
+    for (const auto &mappedFormat : m_formats)
+        result.append({mappedFormat.format, mappedFormat.codec, rawData(mappedFormat)});
+    return result;
+}
+
+QString MappedItemData::blobDirectory() const
+{
+    return m_file ? m_file->blobDirectory() : QString();
+}
+
+QByteArray MappedItemData::rawData(const Format &format) const
+{
+    return QByteArray::fromRawData(
+        m_file->bytes().constData() + format.offset, format.size );
+}
+
+QByteArray MappedItemData::decodedData(const Format &format) const
+{
+    const QByteArray bytes = rawData(format);
+    if (format.codec & blobCodecFlag)
+        return loadItemBlob( m_file->blobDirectory(), QString::fromLatin1(bytes) );
+
+    if (format.codec == NoCodec)
+        return QByteArray( bytes.constData(), bytes.size() );
+
+    QByteArray decoded = bytes;
+    if ( !decodeData(format.codec, &decoded) ) {
+        log( QString("Corrupted data: Failed to decode data (format %1)").arg(format.format), LogError );
+        return QByteArray();
+    }
+
+    return decoded;
+}
+
+bool syncFile(QFileDevice *file)
+{
+    if ( !file->flush() )
+        return false;
+
+#ifdef Q_OS_UNIX
+    return ::fsync( file->handle() ) == 0;
+#elif defined(Q_OS_WIN)
+    return ::_commit( file->handle() ) == 0;
+#else
+    return true;
+#endif
+}
+
+void setItemBlobMinSize(int size)
+{
+    itemBlobMinSize = size;
+}
+
+QSet<QString> itemBlobs(const QString &tabFileName)
+{
+    QSet<QString> blobs;
+
+    QFile file(tabFileName);
+    if ( !file.open(QIODevice::ReadOnly) || !isIndexedTabFile(&file) )
+        return blobs;
+
+    const MappedTabFile tabFile(&file);
+    const QByteArray &bytes = tabFile.bytes();
+
+    QDataStream stream(bytes);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    bool hasCodecs;
+    qint64 indexOffset;
+    qint32 length;
+    if ( !readIndexHeader(&stream, bytes.size(), &hasCodecs, &indexOffset, &length) )
+        return blobs;
+
+    IndexedFormat format;
+    for(qint32 i = 0; i < length; ++i) {
+        qint32 formatCount;
+        if ( !readOrError(&stream, &formatCount, "Failed to read format count") )
+            return blobs;
+
+        for (qint32 j = 0; j < formatCount; ++j) {
+            if ( !readIndexedFormat(&stream, hasCodecs, indexOffset, &format) )
+                return blobs;
+
+            if (format.codec & blobCodecFlag) {
+                const auto id = bytes.mid(static_cast<int>(format.offset), static_cast<int>(format.size));
+                blobs.insert( QString::fromLatin1(id) );
+            }
+        }
+    }
+
+    return blobs;
+}
+
+void removeUnusedItemBlobs(const QString &tabFileName, QSet<QString> blobs)
+{
+    if ( blobs.isEmpty() )
+        return;
+
+    const QDir tabDir = QFileInfo(tabFileName).absoluteDir();
+    const QStringList tabFileNames = tabDir.entryList(
+        {"*_tab_*.dat", "*_tab_*.dat.tmp"}, QDir::Files );
+    for (const auto &otherTabFileName : tabFileNames) {
+        blobs.subtract( itemBlobs(tabDir.absoluteFilePath(otherTabFileName)) );
+        if ( blobs.isEmpty() )
+            return;
+    }
+
+    const QDir blobDir( itemBlobDirectory(tabFileName) );
+    for (const auto &id : blobs) {
+        if ( !QFile::remove(blobDir.absoluteFilePath(id)) )
+            log( QString("Failed to remove unused item blob %1").arg(id), LogWarning );
+    }
+}
+
 void serializeData(QDataStream *stream, const QVariantMap &data)
 {
     *stream << static_cast<qint32>(-2);
@@ -157,6 +769,24 @@ void serializeData(QDataStream *stream, const QVariantMap &data)
     }
 }
 
+void serializeEncodedData(QDataStream *stream, const QVariantMap &data)
+{
+    *stream << static_cast<qint32>(-3);
+
+    const qint32 size = data.size();
+    *stream << size;
+
+    QByteArray bytes;
+    qint8 codec;
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        const auto &mime = it.key();
+        bytes = encodeData( mime, it.value().toByteArray(), &codec );
+        *stream << compressMime(mime)
+                << codec
+                << bytes;
+    }
+}
+
 bool deserializeData(QDataStream *stream, QVariantMap *data)
 {
     try {
@@ -164,6 +794,9 @@ bool deserializeData(QDataStream *stream, QVariantMap *data)
         if ( !readOrError(stream, &length, "Failed to read length") )
             return false;
 
+        if (length == -3)
+            return deserializeDataV3(stream, data);
+
         if (length == -2)
             return deserializeDataV2(stream, data);
 
@@ -263,13 +896,67 @@ bool deserializeData(QAbstractItemModel *model, QDataStream *stream, int maxItem
 
 bool serializeData(const QAbstractItemModel &model, QIODevice *file)
 {
+    if ( !file->isSequential() )
+        return serializeIndexedData( itemDataSnapshot(model), file );
+
     QDataStream stream(file);
     stream.setVersion(QDataStream::Qt_4_7);
     return serializeData(model, &stream);
 }
 
+QVariantMap snapshotItemData(const QVariant &item, const QStringList &formats)
+{
+    if ( item.userType() != qMetaTypeId<MappedItemData>() )
+        return item.toMap();
+
+    const MappedItemData mappedData = item.value<MappedItemData>();
+    QVariantMap data;
+    for (const auto &format : formats) {
+        if ( mappedData.contains(format) )
+            data.insert( format, mappedData.data(format) );
+    }
+    return data;
+}
+
+QStringList snapshotItemFormats(const QVariant &item)
+{
+    if ( item.userType() == qMetaTypeId<MappedItemData>() )
+        return item.value<MappedItemData>().formats();
+    return item.toMap().keys();
+}
+
+quint64 snapshotItemHash(const QVariant &item)
+{
+    if ( item.userType() == qMetaTypeId<MappedItemData>() ) {
+        // Raw data are valid only while the mapped data exist.
+        const MappedItemData mappedData = item.value<MappedItemData>();
+        return hash( mappedData.toRawMap() );
+    }
+    return hash( item.toMap() );
+}
+
+ItemDataSnapshot itemDataSnapshot(const QAbstractItemModel &model, int firstRow)
+{
+    ItemDataSnapshot items;
+    items.reserve( qMax(0, model.rowCount() - firstRow) );
+    for (int row = firstRow; row < model.rowCount(); ++row) {
+        const QModelIndex index = model.index(row, 0);
+        const QVariant mappedData = index.data(contentType::mappedData);
+        items.append( mappedData.isValid() ? mappedData : index.data(contentType::data) );
+    }
+    return items;
+}
+
+bool serializeData(const ItemDataSnapshot &items, QIODevice *file)
+{
+    return serializeIndexedData(items, file);
+}
+
 bool deserializeData(QAbstractItemModel *model, QIODevice *file, int maxItems)
 {
+    if ( isIndexedTabFile(file) )
+        return deserializeIndexedData(model, file, maxItems);
+
     QDataStream stream(file);
     stream.setVersion(QDataStream::Qt_4_7);
     return deserializeData(model, &stream, maxItems);
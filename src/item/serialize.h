@@ -20,21 +20,153 @@
 #ifndef SERIALIZE_H
 #define SERIALIZE_H
 
+#include <QMetaType>
+#include <QSet>
 #include <QVariantMap>
+#include <QVector>
 
+#include <memory>
+
+class MappedTabFile;
 class QAbstractItemModel;
 class QByteArray;
 class QDataStream;
+class QFileDevice;
 class QIODevice;
+class QStringList;
+
+/**
+ * Item formats stored in a memory-mapped tab file.
+ *
+ * Only offsets to the file are kept, format data are copied from the file
+ * when requested.
+ */
+class MappedItemData final
+{
+public:
+    /// Format data as stored in tab file.
+    struct EncodedFormat {
+        QString format;
+        qint8 codec;
+        QByteArray bytes;
+    };
+
+    MappedItemData() = default;
+
+    explicit MappedItemData(const std::shared_ptr<MappedTabFile> &file);
+
+    void insert(const QString &format, qint64 offset, int size, qint8 codec);
+
+    bool isEmpty() const { return m_formats.isEmpty(); }
+
+    bool contains(const QString &format) const;
+
+    QStringList formats() const;
+
+    /// Return copy of format data.
+    QByteArray data(const QString &format) const;
+
+    /// Return copy of all formats.
+    QVariantMap toMap() const;
+
+    /**
+     * Return all formats without copying data.
+     *
+     * Returned data are valid only as long as this object exists.
+     */
+    QVariantMap toRawMap() const;
+
+    /**
+     * Return formats as stored in the tab file (compressed data or blob IDs)
+     * without copying or decoding data.
+     *
+     * Returned data are valid only as long as this object exists.
+     */
+    QVector<EncodedFormat> encodedFormats() const;
+
+    /// Return directory with blobs referenced by encoded formats.
+    QString blobDirectory() const;
+
+private:
+    struct Format {
+        QString format;
+        qint64 offset;
+        int size;
+        qint8 codec;
+    };
+
+    QByteArray rawData(const Format &format) const;
+    QByteArray decodedData(const Format &format) const;
+
+    std::shared_ptr<MappedTabFile> m_file;
+    QVector<Format> m_formats;
+};
+
+Q_DECLARE_METATYPE(MappedItemData)
 
 void serializeData(QDataStream *stream, const QVariantMap &data);
+/**
+ * Same as serializeData() but compresses format data.
+ *
+ * Older versions cannot read the data so use this only for tab files.
+ */
+void serializeEncodedData(QDataStream *stream, const QVariantMap &data);
 bool deserializeData(QDataStream *stream, QVariantMap *data);
 QByteArray serializeData(const QVariantMap &data);
 bool deserializeData(QVariantMap *data, const QByteArray &bytes);
 
 bool serializeData(const QAbstractItemModel &model, QDataStream *stream);
 bool deserializeData(QAbstractItemModel *model, QDataStream *stream, int maxItems);
+/**
+ * Save items to a file with an index of format data offsets.
+ *
+ * Items loaded from such file are set to model using
+ * contentType::mappedData role so item data are read only when needed.
+ */
 bool serializeData(const QAbstractItemModel &model, QIODevice *file);
 bool deserializeData(QAbstractItemModel *model, QIODevice *file, int maxItems);
 
+/**
+ * Copy of item data which can be serialized later in any thread.
+ *
+ * Each item is either QVariantMap or MappedItemData so taking the snapshot
+ * doesn't copy any format data.
+ */
+using ItemDataSnapshot = QVector<QVariant>;
+
+ItemDataSnapshot itemDataSnapshot(const QAbstractItemModel &model, int firstRow = 0);
+
+/**
+ * Return given formats of an item from snapshot.
+ *
+ * Other formats of items loaded lazily from tab file are not read.
+ */
+QVariantMap snapshotItemData(const QVariant &item, const QStringList &formats);
+
+/// Return formats of an item from snapshot without reading data.
+QStringList snapshotItemFormats(const QVariant &item);
+
+/// Return hash of an item from snapshot (same as contentType::hash of the item).
+quint64 snapshotItemHash(const QVariant &item);
+
+/// Same as serializeData() for model but uses item snapshot.
+bool serializeData(const ItemDataSnapshot &items, QIODevice *file);
+
+/// Flush file data to disk.
+bool syncFile(QFileDevice *file);
+
+/**
+ * Save format data of at least given size to blob files shared by all tab
+ * files in the same directory (disabled if size is not positive).
+ *
+ * Blob files are named by hash of the data so each is stored only once.
+ */
+void setItemBlobMinSize(int size);
+
+/// Return IDs of item blobs referenced by a tab file.
+QSet<QString> itemBlobs(const QString &tabFileName);
+
+/// Remove given blobs unless referenced by any tab file in the same directory.
+void removeUnusedItemBlobs(const QString &tabFileName, QSet<QString> blobs);
+
 #endif // SERIALIZE_H
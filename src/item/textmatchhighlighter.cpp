@@ -0,0 +1,158 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textmatchhighlighter.h"
+
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QPalette>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+
+namespace {
+
+// Limit time spent highlighting at once so searching stays responsive.
+const qint64 maxHighlightTimeMs = 4;
+const int maxMatchesPerBatch = 256;
+
+} // namespace
+
+TextMatchHighlighter::TextMatchHighlighter(QTextEdit *editor)
+    : QObject(editor)
+    , m_editor(editor)
+{
+    m_timerHighlight.setSingleShot(true);
+    m_timerHighlight.setInterval(0);
+    connect( &m_timerHighlight, &QTimer::timeout,
+             this, &TextMatchHighlighter::highlightNextMatches );
+
+    connect( m_editor->verticalScrollBar(), &QScrollBar::valueChanged,
+             this, &TextMatchHighlighter::highlightNextMatches );
+
+    m_editor->installEventFilter(this);
+    m_editor->viewport()->installEventFilter(this);
+}
+
+void TextMatchHighlighter::setHighlight(
+        const QRegularExpression &re, const QFont &highlightFont, const QPalette &highlightPalette)
+{
+    m_re = re;
+
+    m_format = QTextCharFormat();
+    m_format.setBackground( highlightPalette.base() );
+    m_format.setForeground( highlightPalette.text() );
+    m_format.setFont(highlightFont);
+
+    restart();
+    highlightNextMatches();
+}
+
+bool TextMatchHighlighter::eventFilter(QObject *, QEvent *event)
+{
+    const auto type = event->type();
+    if (type == QEvent::Show || type == QEvent::Resize)
+        m_timerHighlight.start();
+
+    return false;
+}
+
+void TextMatchHighlighter::restart()
+{
+    m_timerHighlight.stop();
+    m_document = m_editor->document();
+    m_nextPosition = 0;
+
+    if ( !m_selections.isEmpty() ) {
+        m_selections.clear();
+        m_editor->setExtraSelections(m_selections);
+    }
+}
+
+void TextMatchHighlighter::highlightNextMatches()
+{
+    if ( !m_re.isValid() || m_re.pattern().isEmpty() )
+        return;
+
+    // Postpone until the editor is shown.
+    if ( !m_editor->isVisible() )
+        return;
+
+    // Document is set after the editor is resized in some items.
+    if ( m_document != m_editor->document() )
+        restart();
+
+    const int endPosition = visibleEndPosition();
+    if (m_nextPosition >= endPosition)
+        return;
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    QTextEdit::ExtraSelection selection;
+    selection.format = m_format;
+
+    int matchCount = 0;
+    bool budgetExceeded = false;
+    QTextBlock block = m_document->findBlock(m_nextPosition);
+    for ( ; block.isValid() && block.position() < endPosition && !budgetExceeded; block = block.next() ) {
+        const int blockPosition = block.position();
+        const int offset = qMax(0, m_nextPosition - blockPosition);
+        m_nextPosition = blockPosition + block.length();
+
+        auto it = m_re.globalMatch(block.text(), offset);
+        while ( it.hasNext() ) {
+            const auto match = it.next();
+            if ( match.capturedLength() == 0 )
+                continue;
+
+            selection.cursor = QTextCursor(m_document);
+            selection.cursor.setPosition( blockPosition + match.capturedStart() );
+            selection.cursor.setPosition( blockPosition + match.capturedEnd(), QTextCursor::KeepAnchor );
+            m_selections.append(selection);
+
+            if ( ++matchCount >= maxMatchesPerBatch || elapsed.elapsed() >= maxHighlightTimeMs ) {
+                m_nextPosition = blockPosition + match.capturedEnd();
+                budgetExceeded = true;
+                break;
+            }
+        }
+
+        if ( elapsed.elapsed() >= maxHighlightTimeMs )
+            budgetExceeded = true;
+    }
+
+    if (matchCount > 0)
+        m_editor->setExtraSelections(m_selections);
+
+    if (budgetExceeded)
+        m_timerHighlight.start();
+}
+
+int TextMatchHighlighter::visibleEndPosition() const
+{
+    const QRect rect = m_editor->viewport()->rect();
+    if ( rect.isEmpty() )
+        return 0;
+
+    // Include whole last visible block.
+    const QTextBlock block = m_editor->cursorForPosition( rect.bottomRight() ).block();
+    return block.position() + block.length();
+}
@@ -0,0 +1,67 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TEXTMATCHHIGHLIGHTER_H
+#define TEXTMATCHHIGHLIGHTER_H
+
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QTextCharFormat>
+#include <QTextEdit>
+#include <QTimer>
+
+class QTextDocument;
+
+/**
+ * Highlights text matching regular expression in a text editor.
+ *
+ * Matches are searched only while the editor is visible and only in the
+ * part of the document rendered in the editor viewport. Work is split into
+ * short batches; remaining matches are highlighted in next event loop
+ * iterations and when the editor is shown, resized or scrolled.
+ */
+class TextMatchHighlighter final : public QObject
+{
+public:
+    explicit TextMatchHighlighter(QTextEdit *editor);
+
+    void setHighlight(const QRegularExpression &re, const QFont &highlightFont,
+                      const QPalette &highlightPalette);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    void restart();
+    void highlightNextMatches();
+    int visibleEndPosition() const;
+
+    QTextEdit *m_editor;
+    QPointer<QTextDocument> m_document;
+    QRegularExpression m_re;
+    QTextCharFormat m_format;
+    QList<QTextEdit::ExtraSelection> m_selections;
+    /// Document position to continue searching from.
+    int m_nextPosition = 0;
+    QTimer m_timerHighlight;
+};
+
+#endif // TEXTMATCHHIGHLIGHTER_H
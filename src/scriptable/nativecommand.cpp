@@ -0,0 +1,197 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "nativecommand.h"
+
+#include "common/commandstatus.h"
+#include "common/log.h"
+#include "common/mimetypes.h"
+#include "common/textdata.h"
+#include "scriptable/scriptableproxy.h"
+
+#include <QFile>
+#include <QStringList>
+#include <QVector>
+
+namespace {
+
+void writeOutput(const QByteArray &output)
+{
+    QFile f;
+    f.open(stdout, QIODevice::WriteOnly);
+    f.write(output);
+}
+
+int printError(const QString &error)
+{
+    const auto message = "ScriptError: " + error;
+    log( message, LogNote );
+
+    QFile f;
+    f.open(stderr, QIODevice::WriteOnly);
+    f.write( message.toUtf8() + '\n' );
+
+    return CommandException;
+}
+
+bool toRow(const QString &arg, int *row)
+{
+    bool ok;
+    *row = arg.toInt(&ok);
+    return ok;
+}
+
+bool addItems(const QString &tabName, const QStringList &args, ScriptableProxy *proxy, int *exitCode)
+{
+    QVector<QVariantMap> items;
+    items.reserve( args.size() );
+    for (const auto &arg : args)
+        items.append( createDataMap(mimeText, arg) );
+
+    const auto error = proxy->browserInsert(tabName, 0, items);
+    *exitCode = error.isEmpty() ? CommandFinished : printError(error);
+    return true;
+}
+
+bool readItems(const QString &tabName, const QStringList &args, ScriptableProxy *proxy, int *exitCode)
+{
+    // Reading clipboard is left to script.
+    QVector<int> rows;
+    QStringList mimes;
+    QString mime = mimeText;
+    for (const auto &arg : args) {
+        int row;
+        if ( !toRow(arg, &row) )
+            mime = arg;
+        else if (row < 0)
+            return false;
+        else {
+            rows.append(row);
+            mimes.append(mime);
+        }
+    }
+
+    if ( rows.isEmpty() )
+        return false;
+
+    QByteArray output;
+    const auto itemsData = proxy->browserItemsData(tabName, rows, mimes);
+    for (int i = 0; i < itemsData.size(); ++i) {
+        if (i != 0)
+            output.append('\n');
+        output.append(itemsData[i]);
+    }
+
+    writeOutput(output);
+    *exitCode = CommandFinished;
+    return true;
+}
+
+bool itemCount(const QString &tabName, const QStringList &args, ScriptableProxy *proxy, int *exitCode)
+{
+    if ( !args.isEmpty() )
+        return false;
+
+    writeOutput( QByteArray::number(proxy->browserLength(tabName)) + '\n' );
+    *exitCode = CommandFinished;
+    return true;
+}
+
+bool selectItem(const QString &tabName, const QStringList &args, ScriptableProxy *proxy, int *exitCode)
+{
+    int row;
+    if ( args.size() != 1 || !toRow(args[0], &row) )
+        return false;
+
+    proxy->browserMoveToClipboard(tabName, row);
+    *exitCode = CommandFinished;
+    return true;
+}
+
+} // namespace
+
+QString parseCommandLineArgument(const QString &arg)
+{
+    QString result;
+    bool escape = false;
+
+    for (const auto &c : arg) {
+        if (escape) {
+            escape = false;
+
+            if (c == 'n')
+                result.append('\n');
+            else if (c == 't')
+                result.append('\t');
+            else if (c == '\\')
+                result.append('\\');
+            else
+                result.append(c);
+        } else if (c == '\\') {
+            escape = true;
+        } else {
+            result.append(c);
+        }
+    }
+
+    return result;
+}
+
+bool runNativeCommand(const QStringList &arguments, ScriptableProxy *proxy, int *exitCode)
+{
+    QStringList args;
+    args.reserve( arguments.size() );
+    for (const auto &arg : arguments) {
+        // Special arguments (reading stdin, raw arguments) are handled by script.
+        if ( arg == "-" || arg == "--" || arg == "-e" )
+            return false;
+        args.append( parseCommandLineArgument(arg) );
+    }
+
+    QString tabName;
+    if ( args.size() > 2 && args[0] == "tab" ) {
+        tabName = args[1];
+        args = args.mid(2);
+    }
+
+    if ( args.isEmpty() )
+        return false;
+
+    const auto cmd = args.takeFirst();
+
+    using NativeCommand = bool (*)(const QString &, const QStringList &, ScriptableProxy *, int *);
+    NativeCommand command = nullptr;
+    if (cmd == "add")
+        command = addItems;
+    else if (cmd == "read")
+        command = readItems;
+    else if (cmd == "size" || cmd == "count" || cmd == "length")
+        command = itemCount;
+    else if (cmd == "select")
+        command = selectItem;
+    else
+        return false;
+
+    // Script commands can override any function.
+    if ( proxy->hasScriptCommands() )
+        return false;
+
+    COPYQ_LOG_VERBOSE( QString("Running native command: %1").arg(cmd) );
+    return command(tabName, args, proxy, exitCode);
+}
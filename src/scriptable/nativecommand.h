@@ -0,0 +1,41 @@
+/*
+    Copyright (c) 2020, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NATIVECOMMAND_H
+#define NATIVECOMMAND_H
+
+class ScriptableProxy;
+class QString;
+class QStringList;
+
+/// Returns argument with escape sequences (e.g. "\n") replaced.
+QString parseCommandLineArgument(const QString &arg);
+
+/**
+ * Runs simple command without script engine.
+ *
+ * Only few frequently used commands are handled ("add", "read", "size", "select",
+ * optionally prefixed with "tab NAME"). These are executed directly with @a proxy
+ * and produce same output as when evaluated in script.
+ *
+ * @return false if command is not handled and it must be evaluated in script
+ */
+bool runNativeCommand(const QStringList &arguments, ScriptableProxy *proxy, int *exitCode);
+
+#endif // NATIVECOMMAND_H
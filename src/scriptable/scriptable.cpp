@@ -21,11 +21,13 @@
 
 #include "app/clipboardmonitor.h"
 #include "common/action.h"
+#include "common/appconfig.h"
 #include "common/command.h"
 #include "common/commandstatus.h"
 #include "common/commandstore.h"
 #include "common/common.h"
 #include "common/log.h"
+#include "common/scriptjob.h"
 #include "common/sleeptimer.h"
 #include "common/version.h"
 #include "common/textdata.h"
@@ -36,6 +38,7 @@
 #include "scriptable/commandhelp.h"
 #include "scriptable/dirclass.h"
 #include "scriptable/fileclass.h"
+#include "scriptable/nativecommand.h"
 #include "scriptable/scriptableproxy.h"
 #include "scriptable/temporaryfileclass.h"
 #include "../qt/bytearrayclass.h"
@@ -45,8 +48,10 @@
 #include <QCryptographicHash>
 #include <QDateTime>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QMap>
 #include <QMimeData>
 #include <QNetworkAccessManager>
@@ -56,6 +61,7 @@
 #include <QRegularExpression>
 #include <QScriptContext>
 #include <QScriptEngine>
+#include <QScriptProgram>
 #include <QScriptValueIterator>
 #include <QSettings>
 #include <QSysInfo>
@@ -109,6 +115,22 @@ private:
     QElapsedTimer m_timer;
 };
 
+/// Returns true if action only runs a script which can be run in current Scriptable.
+bool isScriptAction(const Action &action)
+{
+    const auto &cmd = action.command();
+    const auto cmd1 = cmd.value(0).value(0);
+    return cmd.size() == 1 && cmd[0].size() == 1
+        && cmd1.size() >= 2
+        && cmd1[0] == "copyq"
+        && (!cmd1[1].startsWith("-") || cmd1[1] == "-e");
+}
+
+struct MenuFilterResult {
+    bool enabled = false;
+    QElapsedTimer age;
+};
+
 QString helpHead()
 {
     return Scriptable::tr("Usage: copyq [%1]").arg(Scriptable::tr("COMMAND")) + "\n\n"
@@ -473,33 +495,6 @@ void logScriptError(const QString &text)
     log( createScriptErrorMessage(text), LogNote );
 }
 
-QString parseCommandLineArgument(const QString &arg)
-{
-    QString result;
-    bool escape = false;
-
-    for (const auto &c : arg) {
-        if (escape) {
-            escape = false;
-
-            if (c == 'n')
-                result.append('\n');
-            else if (c == 't')
-                result.append('\t');
-            else if (c == '\\')
-                result.append('\\');
-            else
-                result.append(c);
-        } else if (c == '\\') {
-            escape = true;
-        } else {
-            result.append(c);
-        }
-    }
-
-    return result;
-}
-
 bool matchData(const QRegularExpression &re, const QVariantMap &data, const QString &format)
 {
     if ( re.pattern().isEmpty() )
@@ -509,35 +504,122 @@ bool matchData(const QRegularExpression &re, const QVariantMap &data, const QStr
     return text.contains(re);
 }
 
-bool isInternalDataFormat(const QString &format)
+QScriptValue checksumForArgument(Scriptable *scriptable, QCryptographicHash::Algorithm method)
 {
-    return format == mimeWindowTitle
-        || format == mimeItems
-        || format == mimeOwner
-        || format == mimeClipboardMode
-        || format == mimeCurrentTab
-        || format == mimeSelectedItems
-        || format == mimeCurrentItem
-        || format == mimeShortcut
-        || format == mimeOutputTab;
+    const auto data = scriptable->makeByteArray(scriptable->argument(0));
+    const QByteArray hash = QCryptographicHash::hash(data, method).toHex();
+    return QString::fromUtf8(hash);
 }
 
-QVariantMap copyWithoutInternalData(const QVariantMap &data) {
-    QVariantMap newData;
-    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
-        const auto &format = it.key();
-        if ( !isInternalDataFormat(format) )
-            newData.insert(format, it.value());
-    }
+/// Return syntax error message or empty string if script is valid.
+QString syntaxErrorMessage(const QString &script, const QString &fileName)
+{
+    const auto syntaxResult = QScriptEngine::checkSyntax(script);
+    if (syntaxResult.state() == QScriptSyntaxCheckResult::Valid)
+        return QString();
 
-    return newData;
+    return QString("%1:%2:%3: syntax error: %4")
+            .arg(fileName)
+            .arg(syntaxResult.errorLineNumber())
+            .arg(syntaxResult.errorColumnNumber())
+            .arg(syntaxResult.errorMessage());
 }
 
-QScriptValue checksumForArgument(Scriptable *scriptable, QCryptographicHash::Algorithm method)
+/**
+ * Restores environment variables set by a job in script worker (e.g. with
+ * setEnv()) and current directory of the process on destruction.
+ */
+class ProcessStateGuard final {
+public:
+    ProcessStateGuard()
+        : m_currentPath(QDir::currentPath())
+        , m_previous(activeGuard())
+    {
+        activeGuard() = this;
+    }
+
+    ~ProcessStateGuard()
+    {
+        for (auto it = m_environment.constBegin(); it != m_environment.constEnd(); ++it) {
+            if (it.value().isSet)
+                qputenv( it.key().constData(), it.value().value );
+            else
+                qunsetenv( it.key().constData() );
+        }
+
+        if ( QDir::currentPath() != m_currentPath )
+            QDir::setCurrent(m_currentPath);
+
+        activeGuard() = m_previous;
+    }
+
+    ProcessStateGuard(const ProcessStateGuard &) = delete;
+    ProcessStateGuard &operator=(const ProcessStateGuard &) = delete;
+
+    /// Set environment variable (restored by active guard).
+    static bool setEnv(const QByteArray &name, const QByteArray &value)
+    {
+        saveEnv(name);
+        return qputenv( name.constData(), value );
+    }
+
+    /// Unset environment variable (restored by active guard).
+    static bool unsetEnv(const QByteArray &name)
+    {
+        saveEnv(name);
+        return qunsetenv( name.constData() );
+    }
+
+private:
+    struct Variable {
+        bool isSet;
+        QByteArray value;
+    };
+
+    static ProcessStateGuard *&activeGuard()
+    {
+        static ProcessStateGuard *guard = nullptr;
+        return guard;
+    }
+
+    static void saveEnv(const QByteArray &name)
+    {
+        ProcessStateGuard *guard = activeGuard();
+        if ( guard && !guard->m_environment.contains(name) ) {
+            const bool isSet = qEnvironmentVariableIsSet( name.constData() );
+            guard->m_environment.insert( name, Variable{isSet, qgetenv(name.constData())} );
+        }
+    }
+
+    /// Original values of changed environment variables.
+    QHash<QByteArray, Variable> m_environment;
+    QString m_currentPath;
+    ProcessStateGuard *m_previous;
+};
+
+struct ScriptCommandProgram {
+    QString name;
+    QScriptProgram program;
+};
+
+/**
+ * Script commands fetched only if they change on server (i.e. version changes).
+ *
+ * Shared by all script engines in the process (e.g. jobs in script worker).
+ *
+ * Each new engine still evaluates the programs since QtScript cannot copy
+ * initialized global object to other engine, and each client process
+ * (command line) fetches and parses them again.
+ */
+struct ScriptCommandCache {
+    int version = -1;
+    QVector<ScriptCommandProgram> programs;
+};
+
+ScriptCommandCache &scriptCommandCache()
 {
-    const auto data = scriptable->makeByteArray(scriptable->argument(0));
-    const QByteArray hash = QCryptographicHash::hash(data, method).toHex();
-    return QString::fromUtf8(hash);
+    static ScriptCommandCache cache;
+    return cache;
 }
 
 } // namespace
@@ -1220,23 +1302,43 @@ QScriptValue Scriptable::read()
     QString mime(mimeText);
     QScriptValue value;
 
-    bool used = false;
+    // Fetch data for all rows at once (negative row is clipboard).
+    QVector<int> rows;
+    QStringList mimes;
     for ( int i = 0; i < argumentCount(); ++i ) {
         value = argument(i);
         int row;
         if ( toInt(value, &row) ) {
-            if (used)
-                result.append( m_inputSeparator.toUtf8() );
-            used = true;
-            result.append( row >= 0 ? m_proxy->browserItemData(m_tabName, row, mime)
-                                    : getClipboardData(mime) );
+            rows.append(row);
+            mimes.append(mime);
         } else {
             mime = toString(value, this);
         }
     }
 
-    if (!used)
-        result.append( getClipboardData(mime) );
+    if ( rows.isEmpty() )
+        return newByteArray( getClipboardData(mime) );
+
+    QVector<int> itemRows;
+    QStringList itemMimes;
+    for (int i = 0; i < rows.size(); ++i) {
+        if (rows[i] >= 0) {
+            itemRows.append(rows[i]);
+            itemMimes.append(mimes[i]);
+        }
+    }
+
+    const auto itemsData = itemRows.isEmpty()
+            ? QVector<QByteArray>()
+            : m_proxy->browserItemsData(m_tabName, itemRows, itemMimes);
+
+    int itemIndex = 0;
+    for (int i = 0; i < rows.size(); ++i) {
+        if (i != 0)
+            result.append( m_inputSeparator.toUtf8() );
+        result.append( rows[i] >= 0 ? itemsData.value(itemIndex++)
+                                    : getClipboardData(mimes[i]) );
+    }
 
     return newByteArray(result);
 }
@@ -1896,6 +1998,61 @@ void Scriptable::setItem()
     insert(2);
 }
 
+QScriptValue Scriptable::getItems()
+{
+    m_skipArguments = -1;
+
+    QVector<int> rows;
+    for ( int i = 0; i < argumentCount(); ++i ) {
+        int row;
+        if ( !toInt(argument(i), &row) ) {
+            throwError(argumentError());
+            return QScriptValue();
+        }
+        rows.append(row);
+    }
+
+    return toScriptValue( m_proxy->browserItemsData(m_tabName, rows), this );
+}
+
+void Scriptable::changeItems()
+{
+    m_skipArguments = -1;
+
+    if ( argumentCount() % 2 != 0 ) {
+        throwError(argumentError());
+        return;
+    }
+
+    QVector<int> rows;
+    QVector<QVariantMap> dataList;
+    for ( int i = 0; i < argumentCount(); i += 2 ) {
+        int row;
+        if ( !toInt(argument(i), &row) ) {
+            throwError(argumentError());
+            return;
+        }
+
+        QVariantMap data;
+        QScriptValueIterator it( argument(i + 1) );
+        while (it.hasNext()) {
+            it.next();
+            if ( it.flags() & QScriptValue::SkipInEnumeration )
+                continue;
+            if ( !toItemData(it.value(), it.name(), &data) ) {
+                throwError(argumentError());
+                return;
+            }
+        }
+
+        rows.append(row);
+        dataList.append(data);
+    }
+
+    if ( !m_proxy->browserChangeRows(m_tabName, rows, dataList) )
+        throwError("Failed to change items");
+}
+
 QScriptValue Scriptable::toBase64()
 {
     m_skipArguments = 1;
@@ -2159,7 +2316,7 @@ QScriptValue Scriptable::setEnv()
     m_skipArguments = 2;
     const QString name = arg(0);
     const QByteArray value = makeByteArray(argument(1));
-    return qputenv(name.toUtf8().constData(), value);
+    return ProcessStateGuard::setEnv(name.toUtf8(), value);
 }
 
 void Scriptable::sleep()
@@ -2423,20 +2580,7 @@ void Scriptable::saveData()
 
 QScriptValue Scriptable::hasData()
 {
-    for (auto it = m_data.constBegin(); it != m_data.constEnd(); ++it) {
-        const auto &format = it.key();
-        if ( isInternalDataFormat(format) )
-            continue;
-
-        auto bytes = it.value().toByteArray();
-        for (const auto &byte : bytes) {
-            const QChar c(byte);
-            if ( !c.isSpace() && !c.isNull() )
-                return true;
-        }
-    }
-
-    return false;
+    return containsAnyData(m_data);
 }
 
 void Scriptable::showDataNotification()
@@ -2501,11 +2645,31 @@ void Scriptable::runDisplayCommands()
             return;
         running = true;
 
-        if ( m_data.isEmpty() )
-            m_data = m_proxy->setDisplayData(m_actionId, m_data);
+        // Items are received and sent back in batches.
+        QVector<QVariantMap> displayDataList;
+        for (;;) {
+            const auto dataList = m_proxy->setDisplayData(m_actionId, displayDataList);
+            if ( dataList.isEmpty() )
+                break;
+
+            PerformanceLogger logger( QString("Display commands for %1 items").arg(dataList.size()) );
+
+            const auto commands = m_proxy->displayCommands();
+            displayDataList.clear();
+            displayDataList.reserve( dataList.size() );
+            for (const auto &data : dataList) {
+                m_data = data;
+                // Empty data leaves the item unmodified (a display command failed).
+                displayDataList.append( runCommands(CommandType::Display, commands) ? m_data : QVariantMap() );
+                if ( !canContinue() )
+                    break;
+            }
 
-        while ( !m_data.isEmpty() && runCommands(CommandType::Display) ) {
-            m_data = m_proxy->setDisplayData(m_actionId, m_data);
+            if ( !canContinue() ) {
+                // Items not processed yet are sent to display commands again later.
+                m_proxy->setDisplayData(m_actionId, displayDataList);
+                break;
+            }
         }
 
         m_data.clear();
@@ -2521,9 +2685,17 @@ void Scriptable::runDisplayCommands()
 void Scriptable::runMenuCommandFilters()
 {
     QEventLoop loop;
+    // Waits for filter processes to finish.
+    QEventLoop *filtersLoop = nullptr;
+    bool interrupted = false;
+
     connect(this, &Scriptable::finished, &loop, [&]() {
-        if (m_abort == Abort::AllEvaluations)
+        if (m_abort == Abort::AllEvaluations) {
+            interrupted = true;
+            if (filtersLoop)
+                filtersLoop->quit();
             loop.exit();
+        }
     });
 
     QByteArray bytes;
@@ -2537,6 +2709,11 @@ void Scriptable::runMenuCommandFilters()
             return;
         }
 
+        // Stop filters for previous menu.
+        interrupted = true;
+        if (filtersLoop)
+            filtersLoop->quit();
+
         bytes = receivedBytes;
         if ( !bytes.isEmpty() )
             timer.start();
@@ -2546,11 +2723,22 @@ void Scriptable::runMenuCommandFilters()
     const int actionId = m_actionId;
     m_actionId = -1;
 
+    const AppConfig appConfig;
+    const int maxRunningFilters = appConfig.option<Config::menu_filter_jobs>();
+    const int cacheTimeoutMs = appConfig.option<Config::menu_filter_cache_ms>();
+
+    // Results of filters run in separate processes for filter command and data.
+    QHash<QString, MenuFilterResult> cache;
+
+    bool running = false;
     connect(&timer, &QTimer::timeout, &loop, [&]() {
-        if ( bytes.isEmpty() )
+        if ( running || bytes.isEmpty() )
             return;
+        running = true;
+        interrupted = false;
 
         const int currentRun = bytes.toInt();
+        bytes.clear();
 
         getActionData(actionId);
         const QStringList matchCommands =
@@ -2558,14 +2746,110 @@ void Scriptable::runMenuCommandFilters()
 
         PerformanceLogger logger( QLatin1String("Menu item filters") );
 
+        for (auto it = cache.begin(); it != cache.end(); ) {
+            if ( it.value().age.hasExpired(cacheTimeoutMs) )
+                it = cache.erase(it);
+            else
+                ++it;
+        }
+
+        const QString text = getTextData(m_data);
+        const QString cacheKeySuffix = QString("\n%1\n%2")
+                .arg( ::hash(m_data) )
+                .arg( getTextData(m_data, mimeWindowTitle) );
+
+        QList<int> pending;
+        QList<QPair<int, bool>> results;
+        int runningCount = 0;
+        bool stale = false;
+
+        QEventLoop currentFiltersLoop;
+        filtersLoop = &currentFiltersLoop;
+
+        // Destroyed first so remaining processes are killed before other variables are gone.
+        QObject filterProcesses;
+
+        auto enableMenuItem = [&](int i, const QVariantMap &menuItem) {
+            if ( !stale && !m_proxy->enableMenuItem(actionId, currentRun, i, menuItem) )
+                stale = true;
+        };
+
+        // Scripts are run in current engine so they can modify menuItem.
         for (int i = 0; i < matchCommands.length(); ++i) {
+            Action action;
+            action.setCommand(matchCommands[i]);
+            if ( !isScriptAction(action) ) {
+                const auto cached = cache.constFind(matchCommands[i] + cacheKeySuffix);
+                if ( cached == cache.constEnd() )
+                    pending.append(i);
+                else
+                    results.append( qMakePair(i, cached.value().enabled) );
+                continue;
+            }
+
+            if ( stale || interrupted || !canContinue() )
+                break;
+
             m_engine->globalObject().setProperty( "menuItem", m_engine->newObject() );
             const bool enabled = canExecuteCommandFilter(matchCommands[i]);
             QVariantMap menuItem = toDataMap(m_engine->globalObject().property("menuItem"));
             menuItem["enabled"] = enabled && menuItem.value("enabled", true).toBool();
-            if ( !m_proxy->enableMenuItem(actionId, currentRun, i, menuItem) )
-                break;
+            enableMenuItem(i, menuItem);
+        }
+
+        // Other filters run in parallel and menu items are updated as they finish.
+        while ( !stale && !interrupted && canContinue() ) {
+            while ( !pending.isEmpty() && runningCount < maxRunningFilters ) {
+                const int i = pending.takeFirst();
+                const QString matchCommand = matchCommands[i];
+
+                auto action = new Action(&filterProcesses);
+                action->setInput( text.toUtf8() );
+                action->setData(m_data);
+                action->setCommand( matchCommand, QStringList(text) );
+                action->setWorkingDirectory( m_dirClass->getCurrentPath() );
+                connect( action, &Action::actionFinished, &currentFiltersLoop,
+                         [&, i, matchCommand](Action *act) {
+                            act->deleteLater();
+                            --runningCount;
+                            if (stale || interrupted)
+                                return;
+
+                            MenuFilterResult filterResult;
+                            filterResult.enabled = !act->actionFailed() && act->exitCode() == 0;
+                            filterResult.age.start();
+                            if (cacheTimeoutMs > 0)
+                                cache.insert(matchCommand + cacheKeySuffix, filterResult);
+
+                            results.append( qMakePair(i, filterResult.enabled) );
+                            currentFiltersLoop.quit();
+                         });
+
+                ++runningCount;
+                action->start();
+            }
+
+            if ( results.isEmpty() ) {
+                if (runningCount == 0)
+                    break;
+                currentFiltersLoop.exec();
+                continue;
+            }
+
+            const auto result = results.takeFirst();
+            QVariantMap menuItem;
+            menuItem["enabled"] = result.second;
+            enableMenuItem(result.first, menuItem);
         }
+
+        // Ignore processes killed when leaving the scope.
+        stale = true;
+        filtersLoop = nullptr;
+        running = false;
+
+        // Menu could have changed while filters were running.
+        if ( !bytes.isEmpty() )
+            timer.start();
     });
 
     emit receiveData();
@@ -2574,6 +2858,91 @@ void Scriptable::runMenuCommandFilters()
         loop.exec();
 }
 
+void Scriptable::scriptWorker()
+{
+    QEventLoop loop;
+    connect(this, &Scriptable::finished, &loop, [&]() {
+        if (m_abort == Abort::AllEvaluations)
+            loop.exit();
+    });
+
+    QByteArray bytes;
+    QTimer timer;
+    timer.setSingleShot(true);
+    timer.setInterval(0);
+
+    Scriptable *job = nullptr;
+
+    connect(this, &Scriptable::dataReceived, &loop, [&](const QByteArray &receivedBytes) {
+        // Pass data to the running job (e.g. display commands).
+        if (job) {
+            emit job->dataReceived(receivedBytes);
+            return;
+        }
+
+        if (receivedBytes == "ABORT") {
+            abortEvaluation(Abort::AllEvaluations);
+            return;
+        }
+
+        bytes = receivedBytes;
+        if ( !bytes.isEmpty() )
+            timer.start();
+    });
+
+    const int workerActionId = m_actionId;
+
+    connect(&timer, &QTimer::timeout, &loop, [&]() {
+        ScriptJob scriptJob;
+        const bool isValidJob = deserializeScriptJob(bytes, &scriptJob);
+        bytes.clear();
+        if (!isValidJob) {
+            log("Failed to read script job", LogError);
+            return;
+        }
+
+        // Collect output as with actions run in current Scriptable.
+        Action action;
+        QByteArray output;
+        connect( &action, &Action::actionOutput,
+                 &loop, [&](const QByteArray &outputData) { output.append(outputData); } );
+
+        // Jobs must not change environment or current directory of other jobs.
+        ProcessStateGuard processState;
+
+        // Processes started by the job (including nested "copyq" calls)
+        // belong to the job's action.
+        ProcessStateGuard::setEnv( "COPYQ_ACTION_ID", QByteArray::number(scriptJob.actionId) );
+        if ( scriptJob.actionName.isEmpty() )
+            ProcessStateGuard::unsetEnv("COPYQ_ACTION_NAME");
+        else
+            ProcessStateGuard::setEnv( "COPYQ_ACTION_NAME", scriptJob.actionName.toUtf8() );
+
+        // New engine for each job so scripts don't affect each other.
+        QScriptEngine engine;
+        Scriptable scriptable(&engine, m_proxy);
+        connect( &scriptable, &Scriptable::receiveData,
+                 this, &Scriptable::receiveData );
+
+        scriptable.m_action = &action;
+        scriptable.m_input = scriptable.newByteArray(QByteArray());
+
+        job = &scriptable;
+        scriptable.setActionId(scriptJob.actionId);
+        scriptable.setActionName(scriptJob.actionName);
+        const int exitCode = scriptable.executeArguments(scriptJob.arguments);
+        job = nullptr;
+
+        m_proxy->scriptWorkerReady(
+                    workerActionId, scriptJob.actionId, exitCode, output, action.errorOutput());
+    });
+
+    m_proxy->scriptWorkerReady(workerActionId, -1, 0, QByteArray(), QByteArray());
+
+    if (m_abort == Abort::None)
+        loop.exec();
+}
+
 void Scriptable::monitorClipboard()
 {
     if (!verifyClipboardAccess())
@@ -2679,19 +3048,46 @@ void Scriptable::onSynchronizeSelection(ClipboardMode sourceMode, const QString
 
 bool Scriptable::sourceScriptCommands()
 {
-    const auto commands = m_proxy->scriptCommands();
-    for (const auto &command : commands) {
+    // Commands are fetched only if they changed since cached (in the same round trip).
+    auto &cache = scriptCommandCache();
+    const auto scriptCommands = m_proxy->scriptCommandsSince(cache.version);
+    const int version = scriptCommands.version;
+
+    // Skip sourcing if the engine already contains current script commands.
+    if (version == m_scriptCommandsVersion)
+        return true;
+
+    if (cache.version != version) {
+        cache.programs.clear();
+        for (const auto &command : scriptCommands.commands)
+            cache.programs.append( ScriptCommandProgram{command.name, QScriptProgram(command.cmd, command.name)} );
+        cache.version = version;
+    }
+
+    for (const auto &program : cache.programs) {
         engine()->pushContext();
-        eval(command.cmd, command.name);
+        eval(program.program);
+
+        // Script is parsed again only to report position of a syntax error.
+        if ( engine()->hasUncaughtException()
+             && engine()->uncaughtException().property("name").toString() == "SyntaxError" )
+        {
+            const auto syntaxError = syntaxErrorMessage(program.program.sourceCode(), program.name);
+            if ( !syntaxError.isEmpty() ) {
+                engine()->clearExceptions();
+                throwError(syntaxError);
+            }
+        }
         engine()->popContext();
         if ( engine()->hasUncaughtException() ) {
-            const auto exceptionText = processUncaughtException("ScriptCommand::" + command.name);
+            const auto exceptionText = processUncaughtException("ScriptCommand::" + program.name);
             const auto message = createScriptErrorMessage(exceptionText).toUtf8();
             printError(message);
             return false;
         }
     }
 
+    m_scriptCommandsVersion = version;
     return true;
 }
 
@@ -2771,6 +3167,9 @@ int Scriptable::executeArguments(const QStringList &args)
     if (exitCode == CommandFinished)
         setActionData();
 
+    // Server must process all queued calls before client exits.
+    m_proxy->flushQueuedFunctionCalls();
+
     // Destroy objects so destructors are run before script finishes
     // (e.g. file writes are flushed or temporary files are automatically removed).
     m_engine->collectGarbage();
@@ -2982,17 +3381,18 @@ QScriptValue Scriptable::screenshot(bool select)
 
 QScriptValue Scriptable::eval(const QString &script, const QString &fileName)
 {
-    const auto syntaxResult = QScriptEngine::checkSyntax(script);
-    if (syntaxResult.state() != QScriptSyntaxCheckResult::Valid) {
-        throwError( QString("%1:%2:%3: syntax error: %4")
-                    .arg(fileName)
-                    .arg(syntaxResult.errorLineNumber())
-                    .arg(syntaxResult.errorColumnNumber())
-                    .arg(syntaxResult.errorMessage()) );
+    const auto syntaxError = syntaxErrorMessage(script, fileName);
+    if ( !syntaxError.isEmpty() ) {
+        throwError(syntaxError);
         return QScriptValue();
     }
 
-    const auto result = engine()->evaluate(script, fileName);
+    return eval( QScriptProgram(script, fileName) );
+}
+
+QScriptValue Scriptable::eval(const QScriptProgram &program)
+{
+    const auto result = engine()->evaluate(program);
 
     if (m_abort != Abort::None) {
         engine()->clearExceptions();
@@ -3044,13 +3444,8 @@ bool Scriptable::runAction(Action *action)
 
     // Shortcut to run script in current Scriptable
     // instead of spawning new process.
-    const auto &cmd = action->command();
-    const auto cmd1 = cmd.value(0).value(0);
-    if ( cmd.size() == 1 && cmd[0].size() == 1
-         && cmd1.size() >= 2
-         && cmd1[0] == "copyq"
-         && (!cmd1[1].startsWith("-") || cmd1[1] == "-e") )
-    {
+    if ( isScriptAction(*action) ) {
+        const auto cmd1 = action->command()[0][0];
         const auto oldInput = m_input;
         m_input = newByteArray(action->input());
 
@@ -3076,6 +3471,7 @@ bool Scriptable::runAction(Action *action)
 
     // Update data for the new action.
     setActionData();
+    m_proxy->flushQueuedFunctionCalls();
 
     action->setWorkingDirectory( m_dirClass->getCurrentPath() );
     action->start();
@@ -3097,13 +3493,18 @@ bool Scriptable::runCommands(CommandType::CommandType type)
 {
     Q_ASSERT(type == CommandType::Automatic || type == CommandType::Display);
 
+    const auto commands = type == CommandType::Automatic
+            ? m_proxy->automaticCommands()
+            : m_proxy->displayCommands();
+    return runCommands(type, commands);
+}
+
+bool Scriptable::runCommands(CommandType::CommandType type, QVector<Command> commands)
+{
     const auto label = type == CommandType::Automatic
             ? "Automatic command \"%1\": %2"
             : "Display command \"%1\": %2";
 
-    auto commands = type == CommandType::Automatic
-            ? m_proxy->automaticCommands()
-            : m_proxy->displayCommands();
     const QString tabName = getTextData(m_data, mimeCurrentTab);
 
     for (auto &command : commands) {
@@ -44,6 +44,7 @@ class QFile;
 class QNetworkReply;
 class QNetworkAccessManager;
 class QScriptEngine;
+class QScriptProgram;
 class QTextCodec;
 
 enum class ClipboardOwnership;
@@ -293,6 +294,9 @@ public slots:
     void setItem();
     void setitem() { setItem(); }
 
+    QScriptValue getItems();
+    void changeItems();
+
     QScriptValue toBase64();
     QScriptValue tobase64() { return toBase64(); }
     QScriptValue fromBase64();
@@ -378,6 +382,8 @@ public slots:
 
     void runMenuCommandFilters();
 
+    void scriptWorker();
+
     void monitorClipboard();
     void provideClipboard();
     void provideSelection();
@@ -406,9 +412,11 @@ private:
     QScriptValue screenshot(bool select);
     QByteArray serialize(const QScriptValue &value);
     QScriptValue eval(const QString &script);
+    QScriptValue eval(const QScriptProgram &program);
     QTextCodec *codecFromNameOrThrow(const QScriptValue &codecName);
     bool runAction(Action *action);
     bool runCommands(CommandType::CommandType type);
+    bool runCommands(CommandType::CommandType type, QVector<Command> commands);
     bool canExecuteCommand(const Command &command);
     bool canExecuteCommandFilter(const QString &matchCommand);
     bool canAccessClipboard() const;
@@ -448,6 +456,8 @@ private:
     QVariantMap m_oldData;
     int m_actionId = -1;
     QString m_actionName;
+    /// Version of script commands already sourced in the engine.
+    int m_scriptCommandsVersion = -1;
     Abort m_abort = Abort::None;
     int m_skipArguments = 0;
 
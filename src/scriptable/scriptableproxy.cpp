@@ -79,6 +79,7 @@
 #include <QShortcut>
 #include <QSpinBox>
 #include <QTextEdit>
+#include <QTimer>
 #include <QUrl>
 
 #ifdef HAS_TESTS
@@ -90,6 +91,9 @@
 const quint32 serializedFunctionCallMagicNumber = 0x58746908;
 const quint32 serializedFunctionCallVersion = 2;
 
+/// Maximum number of queued calls before sending them.
+const int maxQueuedFunctionCalls = 256;
+
 #define BROWSER(tabName, call) \
     ClipboardBrowser *c = fetchBrowser(tabName); \
     if (c) \
@@ -100,6 +104,7 @@ const quint32 serializedFunctionCallVersion = 2;
 #define INVOKE_(function, arguments, functionCallId) \
     static const auto f = FunctionCallSerializer(STR(#function)).withSlotArguments arguments; \
     const auto args = f.argumentList arguments; \
+    sendQueuedFunctionCalls(); \
     emit sendMessage(f.serialize(functionCallId, args), CommandFunctionCall)
 
 #define INVOKE(FUNCTION, ARGUMENTS) \
@@ -119,6 +124,15 @@ const quint32 serializedFunctionCallVersion = 2;
         return; \
     }
 
+// Queues call without return value which is sent later together with other calls.
+// Use only for functions which don't block (e.g. open dialogs).
+#define INVOKE_QUEUED(FUNCTION, ARGUMENTS) \
+    if (!m_wnd) { \
+        static const auto f = FunctionCallSerializer(STR(#FUNCTION)).withSlotArguments ARGUMENTS; \
+        queueFunctionCall( f.serialize(-1, f.argumentList ARGUMENTS) ); \
+        return; \
+    }
+
 Q_DECLARE_METATYPE(QFile*)
 
 QDataStream &operator<<(QDataStream &out, const NotificationButton &button)
@@ -219,6 +233,22 @@ QDataStream &operator>>(QDataStream &in, Command &command)
     return in;
 }
 
+QDataStream &operator<<(QDataStream &out, const VersionedCommands &commands)
+{
+    out << commands.version
+        << commands.commands;
+    Q_ASSERT(out.status() == QDataStream::Ok);
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, VersionedCommands &commands)
+{
+    in >> commands.version
+       >> commands.commands;
+    Q_ASSERT(in.status() == QDataStream::Ok);
+    return in;
+}
+
 QDataStream &operator<<(QDataStream &out, ClipboardMode mode)
 {
     const int modeId = static_cast<int>(mode);
@@ -601,6 +631,21 @@ QString tabNameEmptyError()
     return ScriptableProxy::tr("Tab name cannot be empty!");
 }
 
+/// Changes formats in item (invalid values remove formats).
+bool changeItem(ClipboardBrowser *c, int row, const QVariantMap &data)
+{
+    const auto index = c->index(row);
+    QVariantMap itemData = c->model()->data(index, contentType::data).toMap();
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        if ( it.value().isValid() )
+            itemData.insert( it.key(), it.value() );
+        else
+            itemData.remove( it.key() );
+    }
+
+    return c->model()->setData(index, itemData, contentType::data);
+}
+
 void raiseWindow(QPointer<QWidget> window)
 {
     window->raise();
@@ -813,7 +858,9 @@ ScriptableProxy::ScriptableProxy(MainWindow *mainWindow, QObject *parent)
     qRegisterMetaTypeStreamOperators<NotificationButtons>("NotificationButtons");
     qRegisterMetaTypeStreamOperators<ScriptablePath>("ScriptablePath");
     qRegisterMetaTypeStreamOperators<QVector<int>>("QVector<int>");
+    qRegisterMetaTypeStreamOperators<QVector<QByteArray>>("QVector<QByteArray>");
     qRegisterMetaTypeStreamOperators<QVector<Command>>("QVector<Command>");
+    qRegisterMetaTypeStreamOperators<VersionedCommands>("VersionedCommands");
     qRegisterMetaTypeStreamOperators<QVector<QVariantMap>>("QVector<QVariantMap>");
     qRegisterMetaTypeStreamOperators<Qt::KeyboardModifiers>("Qt::KeyboardModifiers");
 }
@@ -838,6 +885,100 @@ void ScriptableProxy::callFunction(const QByteArray &serializedFunctionCall)
     t->start(0);
 }
 
+void ScriptableProxy::callFunctions(const QByteArray &serializedFunctionCalls)
+{
+    if (m_shouldBeDeleted)
+        return;
+
+    int functionCallId;
+    QVector<QByteArray> functionCalls;
+    {
+        QDataStream stream(serializedFunctionCalls);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream >> functionCallId >> functionCalls;
+        if (stream.status() != QDataStream::Ok) {
+            log("Failed to read scriptable proxy slot call batch", LogError);
+            Q_ASSERT(false);
+            return;
+        }
+    }
+
+    ++m_functionCallStack;
+    auto t = new QTimer(this);
+    t->setSingleShot(true);
+    QObject::connect( t, &QTimer::timeout, this, [=]() {
+        for (const auto &functionCall : functionCalls)
+            callFunctionHelper(functionCall);
+
+        // Reply only if client waits for the calls to finish.
+        if (functionCallId != -1) {
+            QByteArray bytes;
+            {
+                QDataStream stream(&bytes, QIODevice::WriteOnly);
+                stream << functionCallId << QVariant();
+            }
+            emit sendMessage(bytes, CommandFunctionCallReturnValue);
+        }
+
+        t->deleteLater();
+
+        --m_functionCallStack;
+        if (m_shouldBeDeleted && m_functionCallStack == 0)
+            deleteLater();
+    });
+    t->start(0);
+}
+
+void ScriptableProxy::sendQueuedFunctionCalls()
+{
+    if ( m_queuedFunctionCalls.isEmpty() )
+        return;
+
+    sendQueuedFunctionCalls(-1);
+}
+
+void ScriptableProxy::sendQueuedFunctionCalls(int functionCallId)
+{
+    QByteArray bytes;
+    {
+        QDataStream stream(&bytes, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << functionCallId << m_queuedFunctionCalls;
+    }
+    m_queuedFunctionCalls.clear();
+
+    emit sendMessage(bytes, CommandFunctionCallBatch);
+}
+
+void ScriptableProxy::flushQueuedFunctionCalls()
+{
+    if ( m_queuedFunctionCalls.isEmpty() )
+        return;
+
+    const auto functionCallId = ++m_lastFunctionCallId;
+    sendQueuedFunctionCalls(functionCallId);
+    waitForFunctionCallFinished(functionCallId);
+}
+
+void ScriptableProxy::queueFunctionCall(const QByteArray &serializedFunctionCall)
+{
+    m_queuedFunctionCalls.append(serializedFunctionCall);
+
+    if ( m_queuedFunctionCalls.size() >= maxQueuedFunctionCalls ) {
+        sendQueuedFunctionCalls();
+        return;
+    }
+
+    // Send the calls once client gets back to event loop.
+    if (!m_sendQueuedFunctionCallsScheduled) {
+        m_sendQueuedFunctionCallsScheduled = true;
+        QTimer::singleShot(0, this, [this]() {
+            m_sendQueuedFunctionCallsScheduled = false;
+            sendQueuedFunctionCalls();
+        });
+    }
+}
+
 QByteArray ScriptableProxy::callFunctionHelper(const QByteArray &serializedFunctionCall)
 {
     QVector<QVariant> arguments;
@@ -998,7 +1139,7 @@ QVariantMap ScriptableProxy::getActionData(int id)
 
 void ScriptableProxy::setActionData(int id, const QVariantMap &data)
 {
-    INVOKE2(setActionData, (id, data));
+    INVOKE_QUEUED(setActionData, (id, data));
     m_wnd->setActionData(id, data);
 }
 
@@ -1192,12 +1333,55 @@ void ScriptableProxy::action(const QVariantMap &arg1, const Command &arg2)
 void ScriptableProxy::runInternalAction(const QVariantMap &data, const QString &command)
 {
     INVOKE2(runInternalAction, (data, command));
+
+    // Avoid starting script if no automatic command can match new clipboard data.
+    if ( command == "copyq onClipboardChanged"
+         && m_wnd->scriptCommands().isEmpty()
+         && !m_wnd->canMatchAutomaticCommands(data) )
+    {
+        COPYQ_LOG("Handling clipboard change without automatic commands");
+        onClipboardChanged(data);
+        return;
+    }
+
     auto action = new Action();
     action->setCommand(command);
     action->setData(data);
     m_wnd->runInternalAction(action);
 }
 
+void ScriptableProxy::onClipboardChanged(const QVariantMap &data)
+{
+    // Same as default onClipboardChanged() script if no automatic command runs.
+    const bool isClipboard = isClipboardData(data);
+    if ( containsAnyData(data) ) {
+        const QString outputTab = getTextData(data, mimeOutputTab);
+        if ( !outputTab.isEmpty() ) {
+            const auto mode = isClipboard ? ClipboardMode::Clipboard : ClipboardMode::Selection;
+            saveData(outputTab, copyWithoutInternalData(data), mode);
+        }
+    }
+
+    if (isClipboard) {
+        setTitleForData(data);
+        showDataNotification(data);
+        setClipboardData( copyWithoutInternalData(data) );
+    }
+}
+
+void ScriptableProxy::scriptWorkerReady(
+        int workerActionId, int finishedJobActionId, int exitCode,
+        const QByteArray &output, const QByteArray &errorOutput)
+{
+    INVOKE2(scriptWorkerReady, (workerActionId, finishedJobActionId, exitCode, output, errorOutput));
+
+    // Following data sent to the client belong to the worker again.
+    m_actionData = m_wnd->actionData(workerActionId);
+    m_actionId = workerActionId;
+
+    m_wnd->scriptWorkerReady(workerActionId, finishedJobActionId, exitCode, output, errorOutput);
+}
+
 QByteArray ScriptableProxy::tryGetCommandOutput(const QString &command)
 {
     INVOKE(tryGetCommandOutput, (command));
@@ -1237,7 +1421,7 @@ void ScriptableProxy::showMessage(const QString &title,
         const QString &notificationId,
         const NotificationButtons &buttons)
 {
-    INVOKE2(showMessage, (title, msg, icon, msec, notificationId, buttons));
+    INVOKE_QUEUED(showMessage, (title, msg, icon, msec, notificationId, buttons));
 
     auto notification = m_wnd->createNotification(notificationId);
     notification->setTitle(title);
@@ -1273,7 +1457,7 @@ void ScriptableProxy::browserMoveToClipboard(const QString &tabName, int row)
 
 void ScriptableProxy::browserSetCurrent(const QString &tabName, int arg1)
 {
-    INVOKE2(browserSetCurrent, (tabName, arg1));
+    INVOKE_QUEUED(browserSetCurrent, (tabName, arg1));
     BROWSER(tabName, setCurrent(arg1));
 }
 
@@ -1495,19 +1679,22 @@ bool ScriptableProxy::browserChange(const QString &tabName, const QVariantMap &d
 {
     INVOKE(browserChange, (tabName, data, row));
     ClipboardBrowser *c = fetchBrowser(tabName);
+    return c && changeItem(c, row, data);
+}
+
+bool ScriptableProxy::browserChangeRows(
+        const QString &tabName, const QVector<int> &rows, const QVector<QVariantMap> &dataList)
+{
+    INVOKE(browserChangeRows, (tabName, rows, dataList));
+    ClipboardBrowser *c = fetchBrowser(tabName);
     if (!c)
         return false;
 
-    const auto index = c->index(row);
-    QVariantMap itemData = c->model()->data(index, contentType::data).toMap();
-    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
-        if ( it.value().isValid() )
-            itemData.insert( it.key(), it.value() );
-        else
-            itemData.remove( it.key() );
-    }
+    bool changed = true;
+    for (int i = 0; i < rows.size() && i < dataList.size(); ++i)
+        changed = changeItem(c, rows[i], dataList[i]) && changed;
 
-    return c->model()->setData(index, itemData, contentType::data);
+    return changed;
 }
 
 QByteArray ScriptableProxy::browserItemData(const QString &tabName, int arg1, const QString &arg2)
@@ -1522,6 +1709,40 @@ QVariantMap ScriptableProxy::browserItemData(const QString &tabName, int arg1)
     return itemData(tabName, arg1);
 }
 
+QVector<QByteArray> ScriptableProxy::browserItemsData(
+        const QString &tabName, const QVector<int> &rows, const QStringList &mimes)
+{
+    INVOKE(browserItemsData, (tabName, rows, mimes));
+
+    QVector<QByteArray> result;
+    result.reserve( rows.size() );
+    for (int i = 0; i < rows.size(); ++i)
+        result.append( itemData(tabName, rows[i], mimes.value(i)) );
+
+    return result;
+}
+
+QVector<QVariantMap> ScriptableProxy::browserItemsData(const QString &tabName, const QVector<int> &rows)
+{
+    INVOKE(browserItemsData, (tabName, rows));
+    ClipboardBrowser *c = fetchBrowser(tabName);
+    if (!c)
+        return QVector<QVariantMap>();
+
+    QVector<QVariantMap> result;
+    if ( rows.isEmpty() ) {
+        result.reserve( c->length() );
+        for (int row = 0; row < c->length(); ++row)
+            result.append( c->copyIndex(c->index(row)) );
+    } else {
+        result.reserve( rows.size() );
+        for (int row : rows)
+            result.append( c->copyIndex(c->index(row)) );
+    }
+
+    return result;
+}
+
 void ScriptableProxy::setCurrentTab(const QString &tabName)
 {
     INVOKE2(setCurrentTab, (tabName));
@@ -1709,7 +1930,7 @@ QString ScriptableProxy::testSelected()
 
 void ScriptableProxy::serverLog(const QString &text)
 {
-    INVOKE2(serverLog, (text));
+    INVOKE_QUEUED(serverLog, (text));
     log(text, LogAlways);
 }
 
@@ -1824,7 +2045,7 @@ int ScriptableProxy::inputDialog(const NamedValueList &values)
 
 void ScriptableProxy::setSelectedItemsData(const QString &mime, const QVariant &value)
 {
-    INVOKE2(setSelectedItemsData, (mime, value));
+    INVOKE_QUEUED(setSelectedItemsData, (mime, value));
     const QList<QPersistentModelIndex> selected = selectedIndexes();
     for (const auto &index : selected) {
         ClipboardBrowser *c = m_wnd->browserForItem(index);
@@ -2139,11 +2360,12 @@ bool ScriptableProxy::enableMenuItem(int actionId, int currentRun, int menuItemM
     return m_wnd->setMenuItemEnabled(actionId, currentRun, menuItemMatchCommandIndex, menuItem);
 }
 
-QVariantMap ScriptableProxy::setDisplayData(int actionId, const QVariantMap &displayData)
+QVector<QVariantMap> ScriptableProxy::setDisplayData(int actionId, const QVector<QVariantMap> &displayDataList)
 {
-    INVOKE(setDisplayData, (actionId, displayData));
-    m_actionData = m_wnd->setDisplayData(actionId, displayData);
-    return m_actionData;
+    INVOKE(setDisplayData, (actionId, displayDataList));
+    const auto nextDisplayDataList = m_wnd->setDisplayData(actionId, displayDataList);
+    m_actionData = nextDisplayDataList.value(0);
+    return nextDisplayDataList;
 }
 
 QVector<Command> ScriptableProxy::automaticCommands()
@@ -2164,6 +2386,22 @@ QVector<Command> ScriptableProxy::scriptCommands()
     return m_wnd->scriptCommands();
 }
 
+bool ScriptableProxy::hasScriptCommands()
+{
+    INVOKE(hasScriptCommands, ());
+    return !m_wnd->scriptCommands().isEmpty();
+}
+
+VersionedCommands ScriptableProxy::scriptCommandsSince(int version)
+{
+    INVOKE(scriptCommandsSince, (version));
+    VersionedCommands result;
+    result.version = m_wnd->scriptCommandsVersion();
+    if (result.version != version)
+        result.commands = m_wnd->scriptCommands();
+    return result;
+}
+
 bool ScriptableProxy::openUrls(const QStringList &urls)
 {
     INVOKE(openUrls, (urls));
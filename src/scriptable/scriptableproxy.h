@@ -54,6 +54,12 @@ struct ScriptablePath {
     QString path;
 };
 
+/// Commands with version which changes each time the commands change.
+struct VersionedCommands {
+    int version = -1;
+    QVector<Command> commands;
+};
+
 Q_DECLARE_METATYPE(NamedValueList)
 Q_DECLARE_METATYPE(ScriptablePath)
 Q_DECLARE_METATYPE(NotificationButtons)
@@ -61,6 +67,7 @@ Q_DECLARE_METATYPE(QVector<QVariantMap>)
 Q_DECLARE_METATYPE(Qt::KeyboardModifiers)
 Q_DECLARE_METATYPE(Command)
 Q_DECLARE_METATYPE(ClipboardMode)
+Q_DECLARE_METATYPE(VersionedCommands)
 
 QDataStream &operator<<(QDataStream &out, const NotificationButton &button);
 QDataStream &operator>>(QDataStream &in, NotificationButton &button);
@@ -68,6 +75,8 @@ QDataStream &operator<<(QDataStream &out, const NamedValueList &list);
 QDataStream &operator>>(QDataStream &in, NamedValueList &list);
 QDataStream &operator<<(QDataStream &out, const Command &command);
 QDataStream &operator>>(QDataStream &in, Command &command);
+QDataStream &operator<<(QDataStream &out, const VersionedCommands &commands);
+QDataStream &operator>>(QDataStream &in, VersionedCommands &commands);
 QDataStream &operator<<(QDataStream &out, ClipboardMode mode);
 QDataStream &operator>>(QDataStream &in, ClipboardMode &mode);
 QDataStream &operator<<(QDataStream &out, const ScriptablePath &path);
@@ -84,6 +93,17 @@ public:
 
     void callFunction(const QByteArray &serializedFunctionCall);
 
+    /// Calls functions queued in client (see flushQueuedFunctionCalls()).
+    void callFunctions(const QByteArray &serializedFunctionCalls);
+
+    /**
+     * Sends calls queued in client and waits for the server to process them.
+     *
+     * Calls to functions without return value which don't block are queued
+     * and sent together later (before any other function call).
+     */
+    void flushQueuedFunctionCalls();
+
     int actionId() const { return m_actionId; }
 
     void setFunctionCallReturnValue(const QByteArray &bytes);
@@ -128,6 +148,16 @@ public slots:
     void action(const QVariantMap &arg1, const Command &arg2);
 
     void runInternalAction(const QVariantMap &data, const QString &command);
+
+    /**
+     * Script worker is ready for next job.
+     *
+     * Also reports result of previously finished job if @a finishedJobActionId is not -1.
+     */
+    void scriptWorkerReady(
+            int workerActionId, int finishedJobActionId, int exitCode,
+            const QByteArray &output, const QByteArray &errorOutput);
+
     QByteArray tryGetCommandOutput(const QString &command);
 
     void showMessage(const QString &title,
@@ -170,10 +200,18 @@ public slots:
 
     QString browserInsert(const QString &tabName, int row, const QVector<QVariantMap> &items);
     bool browserChange(const QString &tabName, const QVariantMap &data, int row);
+    bool browserChangeRows(
+            const QString &tabName, const QVector<int> &rows, const QVector<QVariantMap> &dataList);
 
     QByteArray browserItemData(const QString &tabName, int arg1, const QString &arg2);
     QVariantMap browserItemData(const QString &tabName, int arg1);
 
+    /// Returns data for each row in given format (format is taken from the same index).
+    QVector<QByteArray> browserItemsData(
+            const QString &tabName, const QVector<int> &rows, const QStringList &mimes);
+    /// Returns data of items in given rows or all items if @a rows is empty.
+    QVector<QVariantMap> browserItemsData(const QString &tabName, const QVector<int> &rows);
+
     void setCurrentTab(const QString &tabName);
 
     QString tab(const QString &tabName);
@@ -240,11 +278,14 @@ public slots:
 
     bool enableMenuItem(int actionId, int currentRun, int menuItemMatchCommandIndex, const QVariantMap &menuItem);
 
-    QVariantMap setDisplayData(int actionId, const QVariantMap &displayData);
+    QVector<QVariantMap> setDisplayData(int actionId, const QVector<QVariantMap> &displayDataList);
 
     QVector<Command> automaticCommands();
     QVector<Command> displayCommands();
     QVector<Command> scriptCommands();
+    bool hasScriptCommands();
+    /// Return script commands only if version differs (otherwise only the version).
+    VersionedCommands scriptCommandsSince(int version);
 
     bool openUrls(const QStringList &urls);
 
@@ -267,6 +308,14 @@ private:
 
     QVariant waitForFunctionCallFinished(int functionId);
 
+    /// Handles clipboard change in server if no automatic command can match.
+    void onClipboardChanged(const QVariantMap &data);
+
+    void queueFunctionCall(const QByteArray &serializedFunctionCall);
+    void sendQueuedFunctionCalls();
+    /// Server replies only if @a functionCallId is not -1.
+    void sendQueuedFunctionCalls(int functionCallId);
+
     QByteArray callFunctionHelper(const QByteArray &serializedFunctionCall);
 
 #ifdef HAS_TESTS
@@ -279,6 +328,9 @@ private:
     int m_actionId = -1;
 
     int m_lastFunctionCallId = -1;
+
+    QVector<QByteArray> m_queuedFunctionCalls;
+    bool m_sendQueuedFunctionCallsScheduled = false;
     int m_lastInputDialogId = -1;
 
     int m_functionCallStack = 0;
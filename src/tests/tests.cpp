@@ -22,15 +22,19 @@
 
 #include "common/appconfig.h"
 #include "common/client_server.h"
+#include "common/clientsocket.h"
+#include "common/commandmatcher.h"
 #include "common/common.h"
 #include "common/config.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
+#include "common/regexp.h"
 #include "common/settings.h"
 #include "common/shortcuts.h"
 #include "common/sleeptimer.h"
 #include "common/textdata.h"
 #include "common/version.h"
+#include "item/clipboardmodel.h"
 #include "item/itemfactory.h"
 #include "item/itemwidget.h"
 #include "item/serialize.h"
@@ -38,12 +42,16 @@
 #include "platform/platformnativeinterface.h"
 
 #include <QClipboard>
+#include <QDataStream>
 #include <QDebug>
 #include <QDir>
 #include <QElapsedTimer>
+#include <QEventLoop>
 #include <QFile>
 #include <QFileInfo>
 #include <QGuiApplication>
+#include <QLocalServer>
+#include <QLocalSocket>
 #include <QMap>
 #include <QMimeData>
 #include <QProcess>
@@ -741,6 +749,44 @@ QStringList splitLines(const QString &nativeText)
     return nativeText.split(QRegularExpression("\r\n|\n|\r"));
 }
 
+/// Frame as written by ClientSocket (version other than 1 is an internal frame).
+QByteArray socketFrame(quint32 version, qint32 code, const QByteArray &message)
+{
+    QByteArray frame;
+    QDataStream stream(&frame, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << quint32(0x0C090701) << version << static_cast<quint32>(4 + message.size()) << code;
+    stream.writeRawData( message.constData(), message.size() );
+    return frame;
+}
+
+bool waitForSocketData(QLocalSocket *socket, qint64 size)
+{
+    SleepTimer t(8000);
+    while ( socket->bytesAvailable() < size ) {
+        if ( !t.sleep() )
+            return false;
+    }
+    return true;
+}
+
+bool readSocketFrame(QLocalSocket *socket, quint32 *version, qint32 *code, QByteArray *message)
+{
+    if ( !waitForSocketData(socket, 16) )
+        return false;
+
+    QDataStream stream(socket);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magicNumber;
+    quint32 length;
+    stream >> magicNumber >> *version >> length >> *code;
+    if ( magicNumber != 0x0C090701 || length < 4 || !waitForSocketData(socket, length - 4) )
+        return false;
+
+    *message = socket->read(length - 4);
+    return message->size() == static_cast<int>(length - 4);
+}
+
 } // namespace
 
 Tests::Tests(const TestInterfacePtr &test, QObject *parent)
@@ -1276,6 +1322,20 @@ void Tests::commandsGetSetItem()
     RUN(args << "eval" << "print(getitem(1)['text/html'])", "<b>HTML text 2</b>");
 }
 
+void Tests::commandsGetChangeItems()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab << "separator" << ",";
+
+    RUN(args << "add" << "C" << "B" << "A", "");
+    RUN(args << "eval" << "print(getItems(0, 2).map(function(item){ return str(item[mimeText]) }).join(','))", "A,C");
+    RUN(args << "eval" << "print(getItems().length)", "3");
+
+    RUN(args << "eval" << "changeItems(0, {'text/plain': 'X', 'text/html': undefined}, 2, {'text/plain': 'Z'})", "");
+    RUN(args << "read" << "0" << "1" << "2", "X,B,Z");
+    RUN(args << "read" << "0" << "text/html" << "2" << "text/plain" << "1", "X,,B");
+}
+
 void Tests::commandsChecksums()
 {
     RUN("md5sum" << "TEST", "033bd94b1168d7e4f0d644c3c95e35bf\n");
@@ -2130,6 +2190,23 @@ void Tests::moveItems()
     RUN(args << "testSelected", tab + " 1 0 1\n");
 }
 
+void Tests::sortAndReverseItems()
+{
+    const auto args = Args() << "separator" << " ";
+    RUN(args << "add" << "B" << "D" << "A" << "C", "");
+
+    // sort all items except the first one
+    RUN(args << "keys" << "RIGHT" << "DOWN" << "SHIFT+DOWN" << "SHIFT+DOWN" << "CTRL+SHIFT+S", "");
+    RUN(args << "read" << "0" << "1" << "2" << "3", "C A B D");
+
+    // selection follows the sorted items
+    RUN(args << "keys" << "CTRL+SHIFT+R", "");
+    RUN(args << "read" << "0" << "1" << "2" << "3", "C D B A");
+
+    RUN(args << "keys" << "CTRL+A" << "CTRL+SHIFT+S", "");
+    RUN(args << "read" << "0" << "1" << "2" << "3", "A B C D");
+}
+
 void Tests::deleteItems()
 {
     const auto tab = QString(clipboardTabName);
@@ -2153,6 +2230,72 @@ void Tests::searchItems()
     RUN("testSelected", QString(clipboardTabName) + " 1 1\n");
 }
 
+void Tests::searchHtmlItems()
+{
+    RUN("add" << "b" << "a", "");
+    RUN("write" << mimeHtml << "<b>bold</b> html", "");
+    RUN("write" << mimeText << "c", "");
+    RUN("keys" << ":bold html" << "TAB", "");
+    RUN("testSelected", QString(clipboardTabName) + " 1 1\n");
+}
+
+void Tests::searchHtmlItemsInLargeTab()
+{
+    const auto tab = QString(clipboardTabName);
+    RUN("config" << "maxitems" << "1000", "1000\n");
+
+    // Items below the top rows are filtered in background.
+    auto args = Args("add");
+    for (int i = 0; i < 300; ++i)
+        args << QString("item%1").arg(i);
+    RUN(args, "");
+    RUN("write" << "300" << mimeHtml << "<b>bold</b> html", "");
+
+    RUN("filter" << "bold html", "");
+    WAIT_ON_OUTPUT("testSelected", tab + " 300 300\n");
+
+    RUN("filter" << "", "");
+    RUN("config" << "filter_regular_expression" << "true", "true\n");
+    RUN("filter" << "b[o]ld\\s+html", "");
+    WAIT_ON_OUTPUT("testSelected", tab + " 300 300\n");
+}
+
+void Tests::searchItemsFuzzy()
+{
+    RUN("config" << "filter_fuzzy" << "true", "true\n");
+    RUN("add" << "abc" << "xaxbxc" << "zzz", "");
+
+    // Best match is selected even if it's not the first matching item.
+    RUN("keys" << ":abc" << "TAB", "");
+    RUN("testSelected", QString(clipboardTabName) + " 2 2\n");
+
+    // Down key selects the next best match.
+    RUN("keys" << clipboardBrowserId << "DOWN" << clipboardBrowserId, "");
+    RUN("testSelected", QString(clipboardTabName) + " 1 1\n");
+    RUN("keys" << clipboardBrowserId << "UP" << clipboardBrowserId, "");
+    RUN("testSelected", QString(clipboardTabName) + " 2 2\n");
+}
+
+void Tests::searchItemsFuzzyInLargeTab()
+{
+    const auto tab = QString(clipboardTabName);
+    RUN("config" << "maxitems" << "1000", "1000\n");
+    RUN("config" << "filter_fuzzy" << "true", "true\n");
+
+    // Items below the top rows are scored in background.
+    auto args = Args("add") << "abc";
+    for (int i = 0; i < 300; ++i)
+        args << QString("item%1").arg(i);
+    args << "xaxbxc";
+    RUN(args, "");
+
+    RUN("filter" << "abc", "");
+    WAIT_ON_OUTPUT("testSelected", tab + " 301 301\n");
+
+    RUN("keys" << clipboardBrowserId << "DOWN" << clipboardBrowserId, "");
+    RUN("testSelected", tab + " 0 0\n");
+}
+
 void Tests::searchItemsAndSelect()
 {
     RUN("add" << "xx2" << "a" << "xx" << "c", "");
@@ -2305,6 +2448,323 @@ void Tests::clipboardToItem()
     WAIT_ON_OUTPUT("read" << "0", bytes);
 }
 
+void Tests::clipboardToExistingItem()
+{
+    const Args args = Args("separator") << ",";
+
+    RUN("add" << "C" << "B" << "A", "");
+    RUN("remove" << "1", "");
+    RUN("insert" << "1" << "B", "");
+    RUN(args << "read" << "0" << "1" << "2", "A,B,C");
+
+    // Same data are moved to top instead of adding new item.
+    TEST( m_test->setClipboard("C") );
+    WAIT_ON_OUTPUT(args << "read" << "0" << "1" << "2" << "3", "C,A,B,");
+
+    TEST( m_test->setClipboard("B") );
+    WAIT_ON_OUTPUT(args << "read" << "0" << "1" << "2" << "3", "B,C,A,");
+}
+
+void Tests::clipboardItemListPerformance()
+{
+    // Compare with moving items in QList as ClipboardItemList did before.
+    const int itemCount = 50000;
+    const int moveCount = 5000;
+
+    QList<ClipboardItem> list;
+    ClipboardItemList chunkedList;
+    for (int i = 0; i < itemCount; ++i) {
+        const ClipboardItem item( createDataMap(mimeText, QString::number(i)) );
+        list.append(item);
+        chunkedList.insert(i, item);
+    }
+
+    QElapsedTimer timer;
+
+    // Move items to top and remove items from bottom as when adding new items.
+    timer.start();
+    for (int i = 0; i < moveCount; ++i) {
+        const int from = (i * 7919) % itemCount;
+        const ClipboardItem item = list[from];
+        list.removeAt(from);
+        list.insert(0, item);
+
+        list.insert(0, ClipboardItem());
+        list.removeLast();
+    }
+    const auto listElapsedMs = timer.elapsed();
+
+    timer.start();
+    for (int i = 0; i < moveCount; ++i) {
+        const int from = (i * 7919) % itemCount;
+        chunkedList.move(from, 0);
+
+        chunkedList.insert(0, ClipboardItem());
+        chunkedList.remove(chunkedList.size() - 1, 1);
+    }
+    const auto chunkedListElapsedMs = timer.elapsed();
+
+    qWarning() << "--- PERFORMANCE --- QList:" << listElapsedMs << "ms"
+               << "ClipboardItemList:" << chunkedListElapsedMs << "ms";
+
+    QCOMPARE( chunkedList.size(), list.size() );
+    for (int i = 0; i < itemCount; ++i)
+        QCOMPARE( chunkedList[i].dataHash(), list[i].dataHash() );
+}
+
+void Tests::literalSearchPerformance()
+{
+    // Compare matching decoded text with regular expression and matching UTF-8 text directly.
+    const int itemCount = 100000;
+    const auto text = QString::fromUtf8(
+                "Item %1: Lorem ipsum dolor sit amet, \xc5\xbelu\xc5\xa5ou\xc4\x8dk\xc3\xbd k\xc5\xaf\xc5\x88%2");
+
+    QVector<QByteArray> texts;
+    texts.reserve(itemCount);
+    for (int i = 0; i < itemCount; ++i)
+        texts.append( text.arg(i).arg(i % 100 == 0 ? " NeEdLe" : "").toUtf8() );
+
+    for ( const auto &pattern : {"needle", "ipsum.*needle", "k\xc5\xaf\xc5\x88 needle"} ) {
+        const QRegularExpression re(QString::fromUtf8(pattern), QRegularExpression::CaseInsensitiveOption);
+        const LiteralMatcher matcher(re);
+
+        QElapsedTimer timer;
+
+        timer.start();
+        int regExpMatches = 0;
+        for (const auto &itemText : texts) {
+            if ( getTextData(itemText).contains(re) )
+                ++regExpMatches;
+        }
+        const auto regExpElapsedMs = timer.elapsed();
+
+        timer.start();
+        int literalMatches = 0;
+        for (const auto &itemText : texts) {
+            if ( matcher.matches(itemText) )
+                ++literalMatches;
+        }
+        const auto literalElapsedMs = timer.elapsed();
+
+        qWarning() << "--- PERFORMANCE --- Search" << re.pattern()
+                   << "QRegularExpression:" << regExpElapsedMs << "ms"
+                   << "LiteralMatcher:" << literalElapsedMs << "ms";
+
+        QCOMPARE( literalMatches, itemCount / 100 );
+        QCOMPARE( literalMatches, regExpMatches );
+    }
+
+    // Case-insensitive matching is done on UTF-8 text only for ASCII patterns.
+    QVERIFY( LiteralMatcher(QRegularExpression("needle", QRegularExpression::CaseInsensitiveOption)).isValid() );
+    QVERIFY( !LiteralMatcher(QRegularExpression(QString::fromUtf8("k\xc5\xaf\xc5\x88"), QRegularExpression::CaseInsensitiveOption)).isValid() );
+    QVERIFY( LiteralMatcher(QRegularExpression(QString::fromUtf8("k\xc5\xaf\xc5\x88"))).isValid() );
+    QVERIFY( !LiteralMatcher(QRegularExpression("need.e")).isValid() );
+
+    // Parts separated with ".*" must be on the same line.
+    const LiteralMatcher matcher( QRegularExpression("a.*b") );
+    QVERIFY( matcher.matches("a b") );
+    QVERIFY( !matcher.matches("a\nb") );
+    QVERIFY( matcher.matches("a\nab") );
+    QVERIFY( !matcher.matches("b a") );
+}
+
+void Tests::nativeCommandPerformance()
+{
+    // Compare simple commands handled without and with script engine.
+    const Args args = Args("tab") << testTab(1);
+    RUN(args << "add" << "C" << "B\\nB" << "A", "");
+    RUN(args << "read" << "0" << "1" << "2", "A\nB\nB\nC");
+    RUN(args << "read" << "text/html" << "0" << "text/plain" << "2", "\nC");
+    RUN(args << "size", "3\n");
+
+    const int runCount = 20;
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int i = 0; i < runCount; ++i)
+        RUN(args << "size", "3\n");
+    const auto nativeElapsedMs = timer.elapsed();
+
+    timer.start();
+    for (int i = 0; i < runCount; ++i)
+        RUN(args << "eval" << "size()", "3\n");
+    const auto scriptElapsedMs = timer.elapsed();
+
+    qWarning() << "--- PERFORMANCE ---" << runCount << "client runs"
+               << "native:" << nativeElapsedMs << "ms"
+               << "script:" << scriptElapsedMs << "ms";
+
+    // Script commands can override the functions.
+    const auto script = R"(
+        setCommands([{
+            isScript: true,
+            cmd: 'global.size = function() { return "overridden"; }'
+        }])
+        )";
+    RUN(script, "");
+    RUN(args << "size", "overridden\n");
+}
+
+void Tests::clientSocketThroughput()
+{
+    const QString serverName = QString("copyq_test_socket_%1").arg(QCoreApplication::applicationPid());
+    QLocalServer::removeServer(serverName);
+    QLocalServer server;
+    QVERIFY( server.listen(serverName) );
+
+    ClientSocket sender(serverName);
+    QVERIFY( server.waitForNewConnection(4000) );
+    ClientSocket receiver( server.nextPendingConnection() );
+
+    QEventLoop loop;
+    int receivedCount = 0;
+    int expectedCount = 0;
+    QByteArray receivedMessage;
+    int receivedCode = 0;
+    connect( &receiver, &ClientSocket::messageReceived,
+             [&](const QByteArray &message, int messageCode, ClientSocketId) {
+                 receivedMessage = message;
+                 receivedCode = messageCode;
+                 if (++receivedCount == expectedCount)
+                     loop.quit();
+             } );
+
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    timeout.setInterval(60000);
+    connect( &timeout, &QTimer::timeout, &loop, &QEventLoop::quit );
+
+    QVERIFY( sender.start() );
+    QVERIFY( receiver.start() );
+
+    // On Linux, messages bigger than 1 MiB are passed in shared memory.
+    const int totalSize = 100 * 1024 * 1024;
+    for ( const int messageSize : {1024, 64 * 1024, 1024 * 1024, 10 * 1024 * 1024, totalSize} ) {
+        QByteArray message(messageSize, '\0');
+        for (int i = 0; i < messageSize; i += 4096)
+            message[i] = static_cast<char>(i / 4096);
+
+        receivedCount = 0;
+        expectedCount = qMax(1, totalSize / messageSize / 10);
+        receivedMessage.clear();
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < expectedCount; ++i)
+            sender.sendMessage(message, i);
+        timeout.start();
+        loop.exec();
+        timeout.stop();
+        const auto elapsedMs = timer.elapsed();
+
+        const qint64 totalBytes = static_cast<qint64>(messageSize) * expectedCount;
+        qWarning() << "--- PERFORMANCE ---" << expectedCount << "messages of" << messageSize << "bytes:"
+                   << elapsedMs << "ms"
+                   << totalBytes * 1000 / qMax(Q_INT64_C(1), elapsedMs) / 1024 / 1024 << "MiB/s";
+
+        QCOMPARE( receivedCount, expectedCount );
+        QCOMPARE( receivedCode, expectedCount - 1 );
+        QVERIFY( receivedMessage == message );
+    }
+}
+
+void Tests::clientSocketVersion1Peer()
+{
+    const QString serverName = QString("copyq_test_socket_%1").arg(QCoreApplication::applicationPid());
+    QLocalServer::removeServer(serverName);
+    QLocalServer server;
+    QVERIFY( server.listen(serverName) );
+
+    QLocalSocket peer;
+    peer.connectToServer(serverName);
+    QVERIFY( server.waitForNewConnection(4000) );
+    ClientSocket socket( server.nextPendingConnection() );
+
+    QVector<QPair<QByteArray, int>> received;
+    connect( &socket, &ClientSocket::messageReceived,
+             [&](const QByteArray &message, int messageCode, ClientSocketId) {
+                 received.append( qMakePair(message, messageCode) );
+             } );
+    QVERIFY( socket.start() );
+
+    // Server never sends shared memory frames to older clients.
+    QByteArray bigMessage(2 * 1024 * 1024, 'x');
+    bigMessage.append("END");
+    socket.sendMessage(bigMessage, 1);
+    quint32 version = 0;
+    qint32 code = 0;
+    QByteArray message;
+    QVERIFY( readSocketFrame(&peer, &version, &code, &message) );
+    QCOMPARE( version, 1U );
+    QCOMPARE( code, 1 );
+    QVERIFY( message == bigMessage );
+
+    peer.write( socketFrame(1, 2, "test") );
+    QTRY_COMPARE( received.size(), 1 );
+    QCOMPARE( received[0].second, 2 );
+    QCOMPARE( received[0].first, QByteArray("test") );
+}
+
+void Tests::clientSocketSharedMemoryFallback()
+{
+    const QString serverName = QString("copyq_test_socket_%1").arg(QCoreApplication::applicationPid());
+    QLocalServer::removeServer(serverName);
+    QLocalServer server;
+    QVERIFY( server.listen(serverName) );
+
+    ClientSocket socket(serverName);
+    QVERIFY( server.waitForNewConnection(4000) );
+    QLocalSocket *peer = server.nextPendingConnection();
+
+    QVector<QPair<QByteArray, int>> received;
+    connect( &socket, &ClientSocket::messageReceived,
+             [&](const QByteArray &message, int messageCode, ClientSocketId) {
+                 received.append( qMakePair(message, messageCode) );
+             } );
+    QVERIFY( socket.start() );
+
+    QByteArray bigMessage(2 * 1024 * 1024, 'x');
+    bigMessage.append("END");
+
+    // Peer does not probe shared memory so big messages are sent through socket.
+    // Client sends only protocol version 1 messages until probed (the first
+    // one can tell server that shared memory is supported).
+    socket.sendMessage(bigMessage, 1);
+    quint32 version = 0;
+    qint32 code = 0;
+    QByteArray message;
+    do {
+        QVERIFY( readSocketFrame(peer, &version, &code, &message) );
+        QCOMPARE( version, 1U );
+    } while (code < 0);
+    QCOMPARE( code, 1 );
+    QVERIFY( message == bigMessage );
+
+    // Message in shared memory which cannot be opened is requested again
+    // and messages keep their order.
+    const qint32 badFd = 1000000;
+    QByteArray sharedMemoryMessage;
+    {
+        QDataStream stream(&sharedMemoryMessage, QIODevice::WriteOnly);
+        stream << qint32(2) << static_cast<quint32>(bigMessage.size());
+    }
+    peer->write( socketFrame(4, badFd, sharedMemoryMessage) );
+    peer->write( socketFrame(1, 3, "after") );
+
+    QVERIFY( readSocketFrame(peer, &version, &code, &message) );
+    QCOMPARE( version, 6U );
+    QCOMPARE( code, badFd );
+    QVERIFY( received.isEmpty() );
+
+    peer->write( socketFrame(7, badFd, bigMessage) );
+    QTRY_COMPARE( received.size(), 2 );
+    QCOMPARE( received[0].second, 2 );
+    QVERIFY( received[0].first == bigMessage );
+    QCOMPARE( received[1].second, 3 );
+    QCOMPARE( received[1].first, QByteArray("after") );
+    QCOMPARE( peer->state(), QLocalSocket::ConnectedState );
+}
+
 void Tests::itemToClipboard()
 {
     RUN("add" << "TESTING2" << "TESTING1", "");
@@ -2425,6 +2885,100 @@ void Tests::insertRemoveItems()
     RUN(args << "read" << "0" << "1" << "2" << "3" << "4", "abc,ABC,ghi,,");
 }
 
+void Tests::journalItems()
+{
+    const auto tab = testTab(1);
+    const Args args = Args("tab") << tab << "separator" << ",";
+
+    RUN(args << "add" << "C" << "B" << "A", "");
+    RUN("unload" << tab, tab + "\n");
+    RUN(args << "read" << "0" << "1" << "2" << "3", "A,B,C,");
+
+    // Changes are appended to journal and applied when the tab is loaded again.
+    RUN(args << "add" << "D", "");
+    RUN(args << "change" << "1" << "text/plain" << "a", "");
+    RUN(args << "remove" << "2", "");
+    RUN(args << "insert" << "3" << "E", "");
+    RUN("unload" << tab, tab + "\n");
+    RUN(args << "read" << "0" << "1" << "2" << "3" << "4", "D,a,C,E,");
+
+    RUN(args << "remove" << "0", "");
+    RUN("unload" << tab, tab + "\n");
+    RUN(args << "read" << "0" << "1" << "2" << "3", "a,C,E,");
+}
+
+void Tests::reloadItemData()
+{
+    const auto tab = testTab(1);
+    const Args args = Args("tab") << tab << "separator" << ",";
+
+    RUN(args << "write"
+        << "text/plain" << "A"
+        << "text/html" << "<b>A</b>"
+        << COPYQ_MIME_PREFIX "test-data" << "DATA", "");
+    RUN(args << "add" << "B", "");
+    RUN("unload" << tab, tab + "\n");
+
+    // Formats are read from tab file only when needed.
+    RUN(args << "read" << COPYQ_MIME_PREFIX "test-data" << "1", "DATA");
+    RUN(args << "read" << "text/html" << "1", "<b>A</b>");
+    RUN(args << "read" << "0" << "1", "B,A");
+
+    RUN(args << "change" << "1" << "text/plain" << "C", "");
+    RUN("unload" << tab, tab + "\n");
+    RUN(args << "read" << COPYQ_MIME_PREFIX "test-data" << "1", "DATA");
+    RUN(args << "read" << "0" << "1", "B,C");
+}
+
+void Tests::reloadCompressedItemData()
+{
+    const auto tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    // Large HTML is compressed, small text is not.
+    const QString html = QString("<p>test</p>").repeated(1000);
+    RUN(args << "write" << "text/plain" << "test" << "text/html" << html, "");
+    RUN("unload" << tab, tab + "\n");
+    RUN(args << "read" << "text/html" << "0", html);
+    RUN(args << "read" << "text/plain" << "0", "test");
+}
+
+void Tests::shareItemBlobs()
+{
+    RUN("config" << "item_blob_min_size" << "100", "100\n");
+
+    const auto tab1 = testTab(1);
+    const auto tab2 = testTab(2);
+    const QString data = QString("DATA ").repeated(100);
+    RUN("tab" << tab1 << "write" << "text/plain" << data, "");
+    RUN("tab" << tab2 << "write" << "text/plain" << data, "");
+    RUN("unload" << tab1 << tab2, tab1 + "\n" + tab2 + "\n");
+    RUN("tab" << tab1 << "read" << "0", data);
+
+    // Blob is still used by the other tab.
+    RUN("removetab" << tab1, "");
+    RUN("unload" << tab2, tab2 + "\n");
+    RUN("tab" << tab2 << "read" << "0", data);
+}
+
+void Tests::saveItemsInBackground()
+{
+    const auto tab1 = testTab(1);
+    const auto tab2 = testTab(2);
+    const QString data = QString("DATA ").repeated(10000);
+    RUN("tab" << tab1 << "write" << "text/plain" << data, "");
+    RUN("tab" << tab1 << "add" << "B" << "A", "");
+
+    // All items are saved again after renaming the tab.
+    RUN("renametab" << tab1 << tab2, "");
+    RUN("tab" << tab2 << "add" << "C", "");
+
+    // Loading the tab waits for pending saves.
+    RUN("unload" << tab2, tab2 + "\n");
+    RUN("tab" << tab2 << "read" << "0" << "1" << "2" << "3", "C\nA\nB\n" + data);
+    RUN("tab" << tab2 << "size", "4\n");
+}
+
 void Tests::renameTab()
 {
     const QString tab1 = testTab(1);
@@ -2519,6 +3073,50 @@ void Tests::removeAllFoundItems()
     RUN("read" << "0" << "1" << "2", "b49\nb48\nb47");
 }
 
+void Tests::filterManyItems()
+{
+    const auto tab = QString(clipboardTabName);
+    RUN("config" << "maxitems" << "1000", "1000\n");
+
+    // Only top items are filtered immediately, others in background.
+    auto args = Args("add");
+    for (int i = 0; i < 1000; ++i)
+        args << (i == 399 ? QString("needle") : QString("item%1").arg(i));
+    RUN(args, "");
+    RUN("read" << "600", "needle");
+
+    RUN("filter" << "needle", "");
+    WAIT_ON_OUTPUT("testSelected", tab + " 600 600\n");
+
+    RUN("filter" << "item99", "");
+    WAIT_ON_OUTPUT("testSelected", tab + " 0 0\n");
+}
+
+void Tests::refineFilter()
+{
+    const auto tab = QString(clipboardTabName);
+    RUN("config" << "maxitems" << "1000", "1000\n");
+
+    auto args = Args("add");
+    for (int i = 0; i < 500; ++i)
+        args << QString("item%1").arg(i);
+    RUN(args, "");
+
+    RUN("filter" << "item1", "");
+    WAIT_ON_OUTPUT("testSelected", tab + " 300 300\n");
+
+    // Narrower filter tests only previously matching items.
+    RUN("filter" << "item12", "");
+    WAIT_ON_OUTPUT("testSelected", tab + " 370 370\n");
+
+    // Previous results are restored.
+    RUN("filter" << "item1", "");
+    RUN("testSelected", tab + " 300 300\n");
+
+    RUN("keys" << "CTRL+A" << m_test->shortcutToRemove(), "");
+    RUN("size", "389\n");
+}
+
 void Tests::nextPrevious()
 {
     const QString tab = testTab(1);
@@ -2766,6 +3364,22 @@ void Tests::traySearch()
     ACTIVATE_MENU_ITEM(trayMenuId, clipboardBrowserId, "B");
 }
 
+void Tests::traySearchAllTabs()
+{
+    const auto tab1 = testTab(1);
+    RUN("tab" << tab1 << "add" << "other needle", "");
+    RUN("add" << "C" << "B" << "A", "");
+    RUN("config" << "filter_all_tabs" << "true", "true\n");
+
+    // Unloaded tab is searched using index saved beside tab file.
+    RUN("unload" << tab1, tab1 + "\n");
+
+    RUN("keys" << clipboardBrowserId, "");
+    RUN("menu", "");
+    RUN("keys" << trayMenuId << ":needle", "");
+    ACTIVATE_MENU_ITEM(trayMenuId, clipboardBrowserId, "other needle");
+}
+
 void Tests::trayPaste()
 {
     RUN("config" << "tray_tab_is_current" << "false", "false\n");
@@ -2968,6 +3582,33 @@ void Tests::shortcutCommandMatchCmd()
     WAIT_ON_OUTPUT(args << "keys('Ctrl+F1'); read(0)", "test2");
 }
 
+void Tests::shortcutCommandMatchCmdProcess()
+{
+    const auto tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    // Filters with pipes run in separate processes (in parallel).
+    const auto script = R"(
+        function cmd(name) {
+          return {
+            name: name,
+            inMenu: true,
+            shortcuts: ['Ctrl+F1'],
+            matchCmd: 'copyq eval -- "print(input())" | copyq eval -- "str(input()) == \'' + name + '\' || fail()"',
+            cmd: 'copyq tab )" + tab + R"( add ' + name
+          }
+        }
+        setCommands([ cmd('test1'), cmd('test2'), cmd('test3') ])
+        )";
+    RUN(script, "");
+
+    RUN("add" << "test1", "");
+    WAIT_ON_OUTPUT(args << "keys('Ctrl+F1'); read(0)", "test1");
+
+    RUN("add" << "test2", "");
+    WAIT_ON_OUTPUT(args << "keys('Ctrl+F1'); read(0)", "test2");
+}
+
 void Tests::shortcutCommandSelectedItemData()
 {
     const auto tab1 = testTab(1);
@@ -3185,6 +3826,51 @@ void Tests::automaticCommandRegExp()
     RUN("read" << "0", "SHOULD NOT BE CHANGED");
 }
 
+void Tests::automaticCommandNoMatch()
+{
+    // Back-references cannot be part of combined pattern.
+    Command command1;
+    command1.re = QRegularExpression("^(x)\\1");
+    Command command2;
+    command2.re = QRegularExpression("y$");
+    Command command3;
+    command3.input = "DATA";
+    const CommandMatcher matcher( QVector<Command>() << command1 << command2 << command3 );
+    QVERIFY( matcher.matchesAny(createDataMap(mimeText, QString("xx"))) );
+    QVERIFY( matcher.matchesAny(createDataMap(mimeText, QString("xy"))) );
+    QVERIFY( !matcher.matchesAny(createDataMap(mimeText, QString("xz"))) );
+    QVERIFY( matcher.matchesAny(createDataMap("DATA", QString())) );
+
+    // Subroutine calls and conditionals cannot be part of combined pattern.
+    QVector<Command> commands;
+    for ( const auto pattern : {"^(z)$", "^(a)(?1)$", "^(b)(?-1)$", "^(c)(?+1)(d)$",
+                                "^(e)?(?(1)f|g)$", "^(?<h>h)?(?(<h>)i|j)$", "^(k)(?R)?$"} )
+    {
+        Command command;
+        command.re = QRegularExpression(pattern);
+        commands.append(command);
+    }
+    const CommandMatcher matcher2(commands);
+    for ( const auto text : {"z", "aa", "bb", "cdd", "ef", "hi", "k"} )
+        QVERIFY2( matcher2.matchesAny(createDataMap(mimeText, QString(text))), text );
+    QVERIFY( !matcher2.matchesAny(createDataMap(mimeText, QString("eg"))) );
+
+    // Clipboard is stored even if it's handled without running any script.
+    const auto script = R"(
+        setCommands([
+            { automatic: true, re: '^MATCH', cmd: 'copyq: setData("text/plain", "CHANGED")' },
+            { automatic: true, input: 'DATA', cmd: 'copyq: setData("text/plain", "CHANGED")' },
+        ])
+        )";
+    RUN(script, "");
+
+    TEST( m_test->setClipboard("NO MATCH") );
+    WAIT_ON_OUTPUT("read" << "0", "NO MATCH");
+
+    TEST( m_test->setClipboard("MATCH") );
+    WAIT_ON_OUTPUT("read" << "0", "CHANGED");
+}
+
 void Tests::automaticCommandSetData()
 {
     const auto script = R"(
@@ -3233,6 +3919,38 @@ void Tests::automaticCommandChaining()
     WAIT_ON_OUTPUT("read" << "0", "123");
 }
 
+void Tests::automaticCommandScriptWorkerRecycling()
+{
+    RUN("config" << "script_worker_max_jobs" << "1", "1\n");
+    const auto script = R"(
+        setCommands([{automatic: true, cmd: 'copyq: setData(mimeText, "OK:" + str(data(mimeText)))'}])
+        )";
+    RUN(script, "");
+
+    for (const auto &text : {"TEST1", "TEST2", "TEST3"}) {
+        TEST( m_test->setClipboard(text) );
+        WAIT_ON_OUTPUT("read" << "0", QByteArray("OK:") + text);
+    }
+}
+
+void Tests::automaticCommandScriptWorkerIsolation()
+{
+    // Environment changed by a job in script worker is not visible in next jobs.
+    RUN("config" << "script_workers" << "1", "1\n");
+    const auto script = R"(
+        setCommands([{
+            automatic: true,
+            cmd: 'copyq: var leaked = str(env("COPYQ_TEST_LEAK")); setEnv("COPYQ_TEST_LEAK", "LEAKED"); setData(mimeText, str(data(mimeText)) + ":" + leaked)'
+        }])
+        )";
+    RUN(script, "");
+
+    for (const auto &text : {"TEST1", "TEST2"}) {
+        TEST( m_test->setClipboard(text) );
+        WAIT_ON_OUTPUT("read" << "0", QByteArray(text) + ":");
+    }
+}
+
 void Tests::automaticCommandCopyToTab()
 {
     const auto tab1 = testTab(1);
@@ -3312,6 +4030,24 @@ void Tests::scriptCommandOverrideFunction()
     RUN("popup" << "test" << "xxx", "test");
 }
 
+void Tests::scriptCommandChange()
+{
+    const auto script = R"(
+        setCommands([
+            { isScript: true, cmd: 'global.testValue = function() { return "%1"; }' },
+            { automatic: true, cmd: 'copyq: setData(mimeText, testValue())' }
+        ])
+        )";
+
+    RUN(QString(script).arg("A"), "");
+    TEST( m_test->setClipboard("TEST1") );
+    WAIT_ON_OUTPUT("read" << "0", "A");
+
+    RUN(QString(script).arg("B"), "");
+    TEST( m_test->setClipboard("TEST2") );
+    WAIT_ON_OUTPUT("read" << "0", "B");
+}
+
 void Tests::displayCommand()
 {
     const auto testMime = COPYQ_MIME_PREFIX "test";
@@ -3343,6 +4079,33 @@ void Tests::displayCommand()
                 .toUtf8() );
 }
 
+void Tests::displayCommandCache()
+{
+    const auto testMime = COPYQ_MIME_PREFIX "test";
+    const auto logTab = testTab(1);
+    const auto script = QString(R"(
+        setCommands([{
+            display: true,
+            input: '%1',
+            cmd: 'copyq:'
+               + 'text = str(data(mimeText));'
+               + 'tab("%2");'
+               + 'add(text);'
+        }])
+        )").arg(testMime, logTab);
+
+    RUN(script, "");
+
+    const Args logArgs = Args("tab") << logTab;
+    RUN("write" << "0" << testMime << "" << mimeText << "a", "");
+    WAIT_ON_OUTPUT(logArgs << "read" << "0" << "1", "a\n");
+
+    // Display commands are not run again for same item data.
+    RUN("write" << "0" << testMime << "" << mimeText << "a", "");
+    RUN("write" << "0" << testMime << "" << mimeText << "b", "");
+    WAIT_ON_OUTPUT(logArgs << "read" << "0" << "1" << "2", "b\na\n");
+}
+
 void Tests::queryKeyboardModifiersCommand()
 {
     RUN("queryKeyboardModifiers()", "");
@@ -86,6 +86,7 @@ private slots:
     void commandsPackUnpack();
     void commandsBase64();
     void commandsGetSetItem();
+    void commandsGetChangeItems();
 
     void commandsChecksums();
 
@@ -161,8 +162,13 @@ private slots:
     void selectItems();
 
     void moveItems();
+    void sortAndReverseItems();
     void deleteItems();
     void searchItems();
+    void searchHtmlItems();
+    void searchHtmlItemsInLargeTab();
+    void searchItemsFuzzy();
+    void searchItemsFuzzyInLargeTab();
     void searchItemsAndSelect();
     void searchRowNumber();
     void copyItems();
@@ -178,16 +184,30 @@ private slots:
     void toggleClipboardMonitoring();
 
     void clipboardToItem();
+    void clipboardToExistingItem();
+    void clipboardItemListPerformance();
+    void literalSearchPerformance();
+    void nativeCommandPerformance();
+    void clientSocketThroughput();
+    void clientSocketVersion1Peer();
+    void clientSocketSharedMemoryFallback();
     void itemToClipboard();
     void tabAdd();
     void tabRemove();
     void tabIcon();
     void action();
     void insertRemoveItems();
+    void journalItems();
+    void reloadItemData();
+    void reloadCompressedItemData();
+    void shareItemBlobs();
+    void saveItemsInBackground();
     void renameTab();
     void importExportTab();
 
     void removeAllFoundItems();
+    void filterManyItems();
+    void refineFilter();
 
     void nextPrevious();
 
@@ -205,6 +225,7 @@ private slots:
     void menu();
 
     void traySearch();
+    void traySearchAllTabs();
     void trayPaste();
 
     // Options for tray menu.
@@ -220,6 +241,7 @@ private slots:
     void shortcutCommandOverrideEnter();
     void shortcutCommandMatchInput();
     void shortcutCommandMatchCmd();
+    void shortcutCommandMatchCmdProcess();
 
     void shortcutCommandSelectedItemData();
     void shortcutCommandSetSelectedItemData();
@@ -232,10 +254,13 @@ private slots:
     void automaticCommandRemove();
     void automaticCommandInput();
     void automaticCommandRegExp();
+    void automaticCommandNoMatch();
     void automaticCommandSetData();
     void automaticCommandOutputTab();
     void automaticCommandNoOutputTab();
     void automaticCommandChaining();
+    void automaticCommandScriptWorkerRecycling();
+    void automaticCommandScriptWorkerIsolation();
     void automaticCommandCopyToTab();
     void automaticCommandStoreSpecialFormat();
     void automaticCommandIgnoreSpecialFormat();
@@ -243,7 +268,9 @@ private slots:
     void scriptCommandLoaded();
     void scriptCommandAddFunction();
     void scriptCommandOverrideFunction();
+    void scriptCommandChange();
     void displayCommand();
+    void displayCommandCache();
 
     void queryKeyboardModifiersCommand();
     void pointerPositionCommand();